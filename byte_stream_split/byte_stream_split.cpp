@@ -0,0 +1,2022 @@
+#include "byte_stream_split.h"
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define AVX512_TARGET __attribute__((target("avx512f,avx512bw")))
+#define AVX512_VBMI_TARGET __attribute__((target("avx512f,avx512bw,avx512vbmi")))
+
+#define _mm256_unpacklo_epi128(a, b) _mm256_permute2x128_si256(a, b, 2 << 4)
+#define _mm256_unpackhi_epi128(a, b) _mm256_permute2x128_si256(a, b, 1 | (3 << 4))
+
+/********* BEGIN SSE AND AVX2 KERNELS ***************/
+
+void encode_simd_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 16UL * 16UL;
+    __m128i s[4];
+    __m128i p[4];
+    for (size_t i = begin * 4UL; i < num_blocked_elements * 4UL; i += 64UL) {
+        s[0] = _mm_loadu_si128((__m128i*)(input_data + i));
+        s[1] = _mm_loadu_si128((__m128i*)(input_data + i + 16UL));
+        s[2] = _mm_loadu_si128((__m128i*)(input_data + i + 32UL));
+        s[3] = _mm_loadu_si128((__m128i*)(input_data + i + 48UL));
+
+        p[0] = _mm_unpacklo_epi8(s[0], s[1]);
+        p[1] = _mm_unpackhi_epi8(s[0], s[1]);
+        p[2] = _mm_unpacklo_epi8(s[2], s[3]);
+        p[3] = _mm_unpackhi_epi8(s[2], s[3]);
+
+        s[0] = _mm_unpacklo_epi8(p[0], p[1]);
+        s[1] = _mm_unpackhi_epi8(p[0], p[1]);
+        s[2] = _mm_unpacklo_epi8(p[2], p[3]);
+        s[3] = _mm_unpackhi_epi8(p[2], p[3]);
+
+        p[0] = _mm_unpacklo_epi8(s[0], s[1]);
+        p[1] = _mm_unpackhi_epi8(s[0], s[1]);
+        p[2] = _mm_unpacklo_epi8(s[2], s[3]);
+        p[3] = _mm_unpackhi_epi8(s[2], s[3]);
+
+        s[0] = _mm_unpacklo_epi64(p[0], p[2]);
+        s[1] = _mm_unpackhi_epi64(p[0], p[2]);
+        s[2] = _mm_unpacklo_epi64(p[1], p[3]);
+        s[3] = _mm_unpackhi_epi64(p[1], p[3]);
+
+        size_t off = i / 4UL;
+        _mm_storeu_si128((__m128i*)(output_data + off), s[0]);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements + off), s[1]);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements*2 + off), s[2]);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements*3 + off), s[3]);
+    }
+    encode_scalar_range<4>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_simd_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_simd_float_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+void decode_simd_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 16UL * 16UL;
+    __m128i s[4];
+    __m128i p[4];
+    for (size_t i = begin; i < num_blocked_elements; i += 16UL) {
+        s[0] = _mm_loadu_si128((__m128i*)(input_data + i));
+        s[1] = _mm_loadu_si128((__m128i*)(input_data + num_elements + i));
+        s[2] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 2UL + i));
+        s[3] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 3UL + i));
+
+        p[0] = _mm_unpacklo_epi8(s[0], s[2]);
+        p[1] = _mm_unpackhi_epi8(s[0], s[2]);
+        p[2] = _mm_unpacklo_epi8(s[1], s[3]);
+        p[3] = _mm_unpackhi_epi8(s[1], s[3]);
+
+        s[0] = _mm_unpacklo_epi8(p[0], p[2]);
+        s[1] = _mm_unpackhi_epi8(p[0], p[2]);
+        s[2] = _mm_unpacklo_epi8(p[1], p[3]);
+        s[3] = _mm_unpackhi_epi8(p[1], p[3]);
+
+        size_t off = i * 4UL;
+        _mm_storeu_si128((__m128i*)(output_data + off), s[0]);
+        _mm_storeu_si128((__m128i*)(output_data + off + 16UL), s[1]);
+        _mm_storeu_si128((__m128i*)(output_data + off + 32UL), s[2]);
+        _mm_storeu_si128((__m128i*)(output_data + off + 48UL), s[3]);
+    }
+    decode_scalar_range<4>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_simd_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_simd_float_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+void encode_simd_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 16UL * 16UL;
+    __m128i s[8];
+    __m128i p[8];
+    for (size_t i = begin * 8UL; i < num_blocked_elements * 8UL; i += 128UL) {
+        s[0] = _mm_loadu_si128((__m128i*)(input_data + i));
+        s[1] = _mm_loadu_si128((__m128i*)(input_data + i + 16UL));
+        s[2] = _mm_loadu_si128((__m128i*)(input_data + i + 32UL));
+        s[3] = _mm_loadu_si128((__m128i*)(input_data + i + 48UL));
+        s[4] = _mm_loadu_si128((__m128i*)(input_data + i + 64UL));
+        s[5] = _mm_loadu_si128((__m128i*)(input_data + i + 80UL));
+        s[6] = _mm_loadu_si128((__m128i*)(input_data + i + 96UL));
+        s[7] = _mm_loadu_si128((__m128i*)(input_data + i + 112UL));
+
+        p[0] = _mm_unpacklo_epi8(s[0], s[1]);
+        p[1] = _mm_unpackhi_epi8(s[0], s[1]);
+        p[2] = _mm_unpacklo_epi8(s[2], s[3]);
+        p[3] = _mm_unpackhi_epi8(s[2], s[3]);
+        p[4] = _mm_unpacklo_epi8(s[4], s[5]);
+        p[5] = _mm_unpackhi_epi8(s[4], s[5]);
+        p[6] = _mm_unpacklo_epi8(s[6], s[7]);
+        p[7] = _mm_unpackhi_epi8(s[6], s[7]);
+
+        s[0] = _mm_unpacklo_epi8(p[0], p[1]);
+        s[1] = _mm_unpackhi_epi8(p[0], p[1]);
+        s[2] = _mm_unpacklo_epi8(p[2], p[3]);
+        s[3] = _mm_unpackhi_epi8(p[2], p[3]);
+        s[4] = _mm_unpacklo_epi8(p[4], p[5]);
+        s[5] = _mm_unpackhi_epi8(p[4], p[5]);
+        s[6] = _mm_unpacklo_epi8(p[6], p[7]);
+        s[7] = _mm_unpackhi_epi8(p[6], p[7]);
+
+        p[0] = _mm_unpacklo_epi32(s[0], s[4]);
+        p[1] = _mm_unpackhi_epi32(s[0], s[4]);
+        p[2] = _mm_unpacklo_epi32(s[1], s[5]);
+        p[3] = _mm_unpackhi_epi32(s[1], s[5]);
+        p[4] = _mm_unpacklo_epi32(s[2], s[6]);
+        p[5] = _mm_unpackhi_epi32(s[2], s[6]);
+        p[6] = _mm_unpacklo_epi32(s[3], s[7]);
+        p[7] = _mm_unpackhi_epi32(s[3], s[7]);
+
+        s[0] = _mm_unpacklo_epi32(p[0], p[4]);
+        s[1] = _mm_unpackhi_epi32(p[0], p[4]);
+        s[2] = _mm_unpacklo_epi32(p[1], p[5]);
+        s[3] = _mm_unpackhi_epi32(p[1], p[5]);
+        s[4] = _mm_unpacklo_epi32(p[2], p[6]);
+        s[5] = _mm_unpackhi_epi32(p[2], p[6]);
+        s[6] = _mm_unpacklo_epi32(p[3], p[7]);
+        s[7] = _mm_unpackhi_epi32(p[3], p[7]);
+
+        size_t off = i / 8UL;
+        _mm_storeu_si128((__m128i*)(output_data + off), s[0]);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements + off), s[1]);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements*2 + off), s[2]);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements*3 + off), s[3]);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements*4 + off), s[4]);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements*5 + off), s[5]);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements*6 + off), s[6]);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements*7 + off), s[7]);
+    }
+    encode_scalar_range<8>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_simd_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_simd_double_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+void decode_simd_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 16UL * 16UL;
+    __m128i s[8];
+    __m128i p[8];
+    for (size_t i = begin; i < num_blocked_elements; i += 16UL) {
+        s[0] = _mm_loadu_si128((__m128i*)(input_data + i));
+        s[1] = _mm_loadu_si128((__m128i*)(input_data + num_elements + i));
+        s[2] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 2UL + i));
+        s[3] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 3UL + i));
+        s[4] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 4UL + i));
+        s[5] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 5UL + i));
+        s[6] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 6UL + i));
+        s[7] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 7UL + i));
+
+        p[0] = _mm_unpacklo_epi8(s[0], s[4]);
+        p[1] = _mm_unpackhi_epi8(s[0], s[4]);
+        p[2] = _mm_unpacklo_epi8(s[1], s[5]);
+        p[3] = _mm_unpackhi_epi8(s[1], s[5]);
+        p[4] = _mm_unpacklo_epi8(s[2], s[6]);
+        p[5] = _mm_unpackhi_epi8(s[2], s[6]);
+        p[6] = _mm_unpacklo_epi8(s[3], s[7]);
+        p[7] = _mm_unpackhi_epi8(s[3], s[7]);
+
+        s[0] = _mm_unpacklo_epi8(p[0], p[4]);
+        s[1] = _mm_unpackhi_epi8(p[0], p[4]);
+        s[2] = _mm_unpacklo_epi8(p[1], p[5]);
+        s[3] = _mm_unpackhi_epi8(p[1], p[5]);
+        s[4] = _mm_unpacklo_epi8(p[2], p[6]);
+        s[5] = _mm_unpackhi_epi8(p[2], p[6]);
+        s[6] = _mm_unpacklo_epi8(p[3], p[7]);
+        s[7] = _mm_unpackhi_epi8(p[3], p[7]);
+
+        p[0] = _mm_unpacklo_epi8(s[0], s[4]);
+        p[1] = _mm_unpackhi_epi8(s[0], s[4]);
+        p[2] = _mm_unpacklo_epi8(s[1], s[5]);
+        p[3] = _mm_unpackhi_epi8(s[1], s[5]);
+        p[4] = _mm_unpacklo_epi8(s[2], s[6]);
+        p[5] = _mm_unpackhi_epi8(s[2], s[6]);
+        p[6] = _mm_unpacklo_epi8(s[3], s[7]);
+        p[7] = _mm_unpackhi_epi8(s[3], s[7]);
+
+        size_t off = i * 8UL;
+        _mm_storeu_si128((__m128i*)(output_data + off), p[0]);
+        _mm_storeu_si128((__m128i*)(output_data + off + 16UL), p[1]);
+        _mm_storeu_si128((__m128i*)(output_data + off + 32UL), p[2]);
+        _mm_storeu_si128((__m128i*)(output_data + off + 48UL), p[3]);
+        _mm_storeu_si128((__m128i*)(output_data + off + 64UL), p[4]);
+        _mm_storeu_si128((__m128i*)(output_data + off + 80UL), p[5]);
+        _mm_storeu_si128((__m128i*)(output_data + off + 96UL), p[6]);
+        _mm_storeu_si128((__m128i*)(output_data + off + 112UL), p[7]);
+    }
+    decode_scalar_range<8>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_simd_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_simd_double_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX2_TARGET
+void encode_avx2_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 32UL * 32UL;
+    __m256i s[4];
+    __m256i p[4];
+    for (size_t i = begin * 4UL; i < num_blocked_elements * 4UL; i += 128UL) {
+        s[0] = _mm256_loadu_si256((__m256i*)(input_data + i));
+        s[1] = _mm256_loadu_si256((__m256i*)(input_data + i + 32UL));
+        s[2] = _mm256_loadu_si256((__m256i*)(input_data + i + 64UL));
+        s[3] = _mm256_loadu_si256((__m256i*)(input_data + i + 96UL));
+
+        p[0] = _mm256_unpacklo_epi8(s[0], s[1]);
+        p[1] = _mm256_unpackhi_epi8(s[0], s[1]);
+        p[2] = _mm256_unpacklo_epi8(s[2], s[3]);
+        p[3] = _mm256_unpackhi_epi8(s[2], s[3]);
+
+        s[0] = _mm256_unpacklo_epi8(p[0], p[1]);
+        s[1] = _mm256_unpackhi_epi8(p[0], p[1]);
+        s[2] = _mm256_unpacklo_epi8(p[2], p[3]);
+        s[3] = _mm256_unpackhi_epi8(p[2], p[3]);
+
+        p[0] = _mm256_unpacklo_epi8(s[0], s[1]);
+        p[1] = _mm256_unpackhi_epi8(s[0], s[1]);
+        p[2] = _mm256_unpacklo_epi8(s[2], s[3]);
+        p[3] = _mm256_unpackhi_epi8(s[2], s[3]);
+
+        s[0] = _mm256_unpacklo_epi128(p[0], p[2]);
+        s[1] = _mm256_unpackhi_epi128(p[0], p[2]);
+        s[2] = _mm256_unpacklo_epi128(p[1], p[3]);
+        s[3] = _mm256_unpackhi_epi128(p[1], p[3]);
+
+        p[0] = _mm256_unpacklo_epi32(s[0], s[1]);
+        p[1] = _mm256_unpackhi_epi32(s[0], s[1]);
+        p[2] = _mm256_unpacklo_epi32(s[2], s[3]);
+        p[3] = _mm256_unpackhi_epi32(s[2], s[3]);
+
+        size_t off = i / 4UL;
+        _mm256_storeu_si256((__m256i*)(output_data + off), p[0]);
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements + off), p[1]);
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements*2 + off), p[2]);
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements*3 + off), p[3]);
+    }
+    encode_scalar_range<4>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_avx2_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_avx2_float_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX2_TARGET
+void decode_avx2_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 32UL * 32UL;
+    __m256i s[4];
+    __m256i p[4];
+    for (size_t i = begin; i < num_blocked_elements; i += 32UL) {
+        s[0] = _mm256_loadu_si256((__m256i*)(input_data + i));
+        s[1] = _mm256_loadu_si256((__m256i*)(input_data + num_elements + i));
+        s[2] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 2UL + i));
+        s[3] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 3UL + i));
+
+        p[0] = _mm256_unpacklo_epi8(s[0], s[1]);
+        p[1] = _mm256_unpackhi_epi8(s[0], s[1]);
+        p[2] = _mm256_unpacklo_epi8(s[2], s[3]);
+        p[3] = _mm256_unpackhi_epi8(s[2], s[3]);
+
+        s[0] = _mm256_unpacklo_epi64(p[0], p[1]);
+        s[1] = _mm256_unpackhi_epi64(p[0], p[1]);
+        s[2] = _mm256_unpacklo_epi64(p[2], p[3]);
+        s[3] = _mm256_unpackhi_epi64(p[2], p[3]);
+
+        p[0] = _mm256_unpacklo_epi128(s[0], s[1]);
+        p[1] = _mm256_unpackhi_epi128(s[0], s[1]);
+        p[2] = _mm256_unpacklo_epi128(s[2], s[3]);
+        p[3] = _mm256_unpackhi_epi128(s[2], s[3]);
+
+        s[0] = _mm256_unpacklo_epi16(p[0], p[2]);
+        s[1] = _mm256_unpackhi_epi16(p[0], p[2]);
+        s[2] = _mm256_unpacklo_epi16(p[1], p[3]);
+        s[3] = _mm256_unpackhi_epi16(p[1], p[3]);
+
+        size_t off = i * 4UL;
+        _mm256_storeu_si256((__m256i*)(output_data + off), s[0]);
+        _mm256_storeu_si256((__m256i*)(output_data + off + 32UL), s[1]);
+        _mm256_storeu_si256((__m256i*)(output_data + off + 64UL), s[2]);
+        _mm256_storeu_si256((__m256i*)(output_data + off + 96UL), s[3]);
+    }
+    decode_scalar_range<4>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_avx2_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_avx2_float_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX2_TARGET
+void encode_avx2_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 32UL * 32UL;
+    __m256i s[8];
+    __m256i p[8];
+    for (size_t i = begin * 8UL; i < num_blocked_elements * 8UL; i += 256UL) {
+        s[0] = _mm256_loadu_si256((__m256i*)(input_data + i));
+        s[1] = _mm256_loadu_si256((__m256i*)(input_data + i + 32UL));
+        s[2] = _mm256_loadu_si256((__m256i*)(input_data + i + 64UL));
+        s[3] = _mm256_loadu_si256((__m256i*)(input_data + i + 96UL));
+        s[4] = _mm256_loadu_si256((__m256i*)(input_data + i + 128UL));
+        s[5] = _mm256_loadu_si256((__m256i*)(input_data + i + 160UL));
+        s[6] = _mm256_loadu_si256((__m256i*)(input_data + i + 192UL));
+        s[7] = _mm256_loadu_si256((__m256i*)(input_data + i + 224UL));
+
+        p[0] = _mm256_unpacklo_epi128(s[0], s[4]);
+        p[1] = _mm256_unpackhi_epi128(s[0], s[4]);
+        p[2] = _mm256_unpacklo_epi128(s[1], s[5]);
+        p[3] = _mm256_unpackhi_epi128(s[1], s[5]);
+        p[4] = _mm256_unpacklo_epi128(s[2], s[6]);
+        p[5] = _mm256_unpackhi_epi128(s[2], s[6]);
+        p[6] = _mm256_unpacklo_epi128(s[3], s[7]);
+        p[7] = _mm256_unpackhi_epi128(s[3], s[7]);
+
+        s[0] = _mm256_unpacklo_epi8(p[0], p[4]);
+        s[1] = _mm256_unpackhi_epi8(p[0], p[4]);
+        s[2] = _mm256_unpacklo_epi8(p[1], p[5]);
+        s[3] = _mm256_unpackhi_epi8(p[1], p[5]);
+        s[4] = _mm256_unpacklo_epi8(p[2], p[6]);
+        s[5] = _mm256_unpackhi_epi8(p[2], p[6]);
+        s[6] = _mm256_unpacklo_epi8(p[3], p[7]);
+        s[7] = _mm256_unpackhi_epi8(p[3], p[7]);
+
+        p[0] = _mm256_unpacklo_epi8(s[0], s[4]);
+        p[1] = _mm256_unpackhi_epi8(s[0], s[4]);
+        p[2] = _mm256_unpacklo_epi8(s[1], s[5]);
+        p[3] = _mm256_unpackhi_epi8(s[1], s[5]);
+        p[4] = _mm256_unpacklo_epi8(s[2], s[6]);
+        p[5] = _mm256_unpackhi_epi8(s[2], s[6]);
+        p[6] = _mm256_unpacklo_epi8(s[3], s[7]);
+        p[7] = _mm256_unpackhi_epi8(s[3], s[7]);
+
+        s[0] = _mm256_unpacklo_epi8(p[0], p[4]);
+        s[1] = _mm256_unpackhi_epi8(p[0], p[4]);
+        s[2] = _mm256_unpacklo_epi8(p[1], p[5]);
+        s[3] = _mm256_unpackhi_epi8(p[1], p[5]);
+        s[4] = _mm256_unpacklo_epi8(p[2], p[6]);
+        s[5] = _mm256_unpackhi_epi8(p[2], p[6]);
+        s[6] = _mm256_unpacklo_epi8(p[3], p[7]);
+        s[7] = _mm256_unpackhi_epi8(p[3], p[7]);
+
+        p[0] = _mm256_unpacklo_epi8(s[0], s[4]);
+        p[1] = _mm256_unpackhi_epi8(s[0], s[4]);
+        p[2] = _mm256_unpacklo_epi8(s[1], s[5]);
+        p[3] = _mm256_unpackhi_epi8(s[1], s[5]);
+        p[4] = _mm256_unpacklo_epi8(s[2], s[6]);
+        p[5] = _mm256_unpackhi_epi8(s[2], s[6]);
+        p[6] = _mm256_unpacklo_epi8(s[3], s[7]);
+        p[7] = _mm256_unpackhi_epi8(s[3], s[7]);
+
+        size_t off = i / 8UL;
+        _mm256_storeu_si256((__m256i*)(output_data + off), p[0]);
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements + off), p[1]);
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements*2 + off), p[2]);
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements*3 + off), p[3]);
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements*4 + off), p[4]);
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements*5 + off), p[5]);
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements*6 + off), p[6]);
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements*7 + off), p[7]);
+    }
+    encode_scalar_range<8>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_avx2_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_avx2_double_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX2_TARGET
+void decode_avx2_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 32UL * 32UL;
+    __m256i s[8];
+    __m256i p[8];
+    const int permute_mask = (3U << 6) | (1U << 4) | (2U << 2) | (0U << 0);
+    for (size_t i = begin; i < num_blocked_elements; i += 32UL) {
+        s[0] = _mm256_loadu_si256((__m256i*)(input_data + i));
+        s[1] = _mm256_loadu_si256((__m256i*)(input_data + num_elements + i));
+        s[2] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 2UL + i));
+        s[3] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 3UL + i));
+        s[4] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 4UL + i));
+        s[5] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 5UL + i));
+        s[6] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 6UL + i));
+        s[7] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 7UL + i));
+
+        for (int i = 0; i < 4; ++i) {
+            p[2*i] = _mm256_unpacklo_epi128(s[i], s[i+4]);
+            p[2*i+1] = _mm256_unpackhi_epi128(s[i], s[i+4]);
+        }
+        for (int i = 0; i < 4; ++i) {
+            s[2*i] = _mm256_unpacklo_epi8(p[i], p[i+4]);
+            s[2*i+1] = _mm256_unpackhi_epi8(p[i], p[i+4]);
+        }
+        for (int i = 0; i < 4; ++i) {
+            p[2*i] = _mm256_unpacklo_epi8(s[i], s[i+4]);
+            p[2*i+1] = _mm256_unpackhi_epi8(s[i], s[i+4]);
+        }
+        for (int i = 0; i < 8; ++i) {
+            s[i] = _mm256_permute4x64_epi64(p[i], permute_mask);
+        }
+        for (int i = 0; i < 8; ++i) {
+            p[i] = _mm256_shuffle_epi32(s[i], permute_mask);
+        }
+
+        size_t off = i * 8UL;
+        _mm256_storeu_si256((__m256i*)(output_data + off), p[0]);
+        _mm256_storeu_si256((__m256i*)(output_data + off + 32UL), p[1]);
+        _mm256_storeu_si256((__m256i*)(output_data + off + 64UL), p[2]);
+        _mm256_storeu_si256((__m256i*)(output_data + off + 96UL), p[3]);
+        _mm256_storeu_si256((__m256i*)(output_data + off + 128UL), p[4]);
+        _mm256_storeu_si256((__m256i*)(output_data + off + 160UL), p[5]);
+        _mm256_storeu_si256((__m256i*)(output_data + off + 192UL), p[6]);
+        _mm256_storeu_si256((__m256i*)(output_data + off + 224UL), p[7]);
+    }
+    decode_scalar_range<8>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_avx2_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_avx2_double_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+// The 2-byte kernels separate the low and high bytes of every 16-bit word with a mask and a
+// shift and pack them with the saturating word to byte pack, which cannot saturate here.
+void encode_simd_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 16UL * 16UL;
+    const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+    for (size_t i = begin; i < num_blocked_elements; i += 16UL) {
+        const __m128i a = _mm_loadu_si128((__m128i*)(input_data + i * 2UL));
+        const __m128i b = _mm_loadu_si128((__m128i*)(input_data + i * 2UL + 16UL));
+        const __m128i low = _mm_packus_epi16(_mm_and_si128(a, low_bytes), _mm_and_si128(b, low_bytes));
+        const __m128i high = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+        _mm_storeu_si128((__m128i*)(output_data + i), low);
+        _mm_storeu_si128((__m128i*)(output_data + num_elements + i), high);
+    }
+    encode_scalar_range<2>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_simd_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_simd_half_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+void decode_simd_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 16UL * 16UL;
+    for (size_t i = begin; i < num_blocked_elements; i += 16UL) {
+        const __m128i low = _mm_loadu_si128((__m128i*)(input_data + i));
+        const __m128i high = _mm_loadu_si128((__m128i*)(input_data + num_elements + i));
+        _mm_storeu_si128((__m128i*)(output_data + i * 2UL), _mm_unpacklo_epi8(low, high));
+        _mm_storeu_si128((__m128i*)(output_data + i * 2UL + 16UL), _mm_unpackhi_epi8(low, high));
+    }
+    decode_scalar_range<2>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_simd_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_simd_half_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+// The pack works within the 128-bit lanes, which leaves the qwords of the two inputs interleaved.
+AVX2_TARGET
+void encode_avx2_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 32UL * 32UL;
+    const __m256i low_bytes = _mm256_set1_epi16(0x00FF);
+    for (size_t i = begin; i < num_blocked_elements; i += 32UL) {
+        const __m256i a = _mm256_loadu_si256((__m256i*)(input_data + i * 2UL));
+        const __m256i b = _mm256_loadu_si256((__m256i*)(input_data + i * 2UL + 32UL));
+        const __m256i low = _mm256_packus_epi16(_mm256_and_si256(a, low_bytes), _mm256_and_si256(b, low_bytes));
+        const __m256i high = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        _mm256_storeu_si256((__m256i*)(output_data + i), _mm256_permute4x64_epi64(low, 0xD8));
+        _mm256_storeu_si256((__m256i*)(output_data + num_elements + i), _mm256_permute4x64_epi64(high, 0xD8));
+    }
+    encode_scalar_range<2>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_avx2_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_avx2_half_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+// The qwords are reordered first, so that the unpacks within the lanes give the values in order.
+AVX2_TARGET
+void decode_avx2_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 32UL * 32UL;
+    for (size_t i = begin; i < num_blocked_elements; i += 32UL) {
+        const __m256i low = _mm256_permute4x64_epi64(_mm256_loadu_si256((__m256i*)(input_data + i)), 0xD8);
+        const __m256i high = _mm256_permute4x64_epi64(_mm256_loadu_si256((__m256i*)(input_data + num_elements + i)), 0xD8);
+        _mm256_storeu_si256((__m256i*)(output_data + i * 2UL), _mm256_unpacklo_epi8(low, high));
+        _mm256_storeu_si256((__m256i*)(output_data + i * 2UL + 32UL), _mm256_unpackhi_epi8(low, high));
+    }
+    decode_scalar_range<2>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_avx2_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_avx2_half_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+// Every 128-bit lane handles 16 3-byte values, i.e. 48 bytes in three registers. Every stream
+// is gathered from the three registers with one vpshufb each, the bytes from the other registers
+// are zeroed by the shuffles and the three parts are ORed together.
+//
+// Byte j of the shuffle which picks the bytes of stream k out of the r-th 16 bytes.
+static inline __m128i make_int24_encode_shuffle(size_t k, size_t r) {
+    uint8_t shuffle[16];
+    for (size_t j = 0; j < 16; ++j) {
+        const size_t byte = j * 3 + k;
+        shuffle[j] = byte / 16 == r ? (uint8_t)(byte % 16) : 0x80;
+    }
+    return _mm_loadu_si128((__m128i*)shuffle);
+}
+
+// Byte j of the shuffle which picks the bytes of the r-th 16 output bytes out of stream k.
+static inline __m128i make_int24_decode_shuffle(size_t k, size_t r) {
+    uint8_t shuffle[16];
+    for (size_t j = 0; j < 16; ++j) {
+        const size_t byte = r * 16 + j;
+        shuffle[j] = byte % 3 == k ? (uint8_t)(byte / 3) : 0x80;
+    }
+    return _mm_loadu_si128((__m128i*)shuffle);
+}
+
+AVX2_TARGET
+static inline __m256i load_lanes(const uint8_t *low, const uint8_t *high) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((__m128i*)low)),
+                                   _mm_loadu_si128((__m128i*)high), 1);
+}
+
+AVX2_TARGET
+static inline void store_lanes(uint8_t *low, uint8_t *high, __m256i v) {
+    _mm_storeu_si128((__m128i*)low, _mm256_castsi256_si128(v));
+    _mm_storeu_si128((__m128i*)high, _mm256_extracti128_si256(v, 1));
+}
+
+AVX2_TARGET
+void encode_avx2_int24_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 32UL * 32UL;
+    __m256i shuffles[3][3];
+    for (size_t k = 0; k < 3; ++k) {
+        for (size_t r = 0; r < 3; ++r) {
+            shuffles[k][r] = _mm256_broadcastsi128_si256(make_int24_encode_shuffle(k, r));
+        }
+    }
+    __m256i s[3];
+    for (size_t i = begin; i < num_blocked_elements; i += 32UL) {
+        // The low lanes hold values i to i + 15, the high lanes values i + 16 to i + 31.
+        const uint8_t *block = input_data + i * 3UL;
+        for (size_t r = 0; r < 3; ++r) {
+            s[r] = load_lanes(block + r * 16UL, block + 48UL + r * 16UL);
+        }
+        for (size_t k = 0; k < 3; ++k) {
+            const __m256i stream = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(s[0], shuffles[k][0]),
+                                                                   _mm256_shuffle_epi8(s[1], shuffles[k][1])),
+                                                   _mm256_shuffle_epi8(s[2], shuffles[k][2]));
+            _mm256_storeu_si256((__m256i*)(output_data + num_elements * k + i), stream);
+        }
+    }
+    encode_scalar_range<3>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_avx2_int24(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_avx2_int24_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX2_TARGET
+void decode_avx2_int24_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 32UL * 32UL;
+    __m256i shuffles[3][3];
+    for (size_t k = 0; k < 3; ++k) {
+        for (size_t r = 0; r < 3; ++r) {
+            shuffles[k][r] = _mm256_broadcastsi128_si256(make_int24_decode_shuffle(k, r));
+        }
+    }
+    __m256i s[3];
+    for (size_t i = begin; i < num_blocked_elements; i += 32UL) {
+        for (size_t k = 0; k < 3; ++k) {
+            s[k] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * k + i));
+        }
+        uint8_t *block = output_data + i * 3UL;
+        for (size_t r = 0; r < 3; ++r) {
+            const __m256i out = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(s[0], shuffles[0][r]),
+                                                                _mm256_shuffle_epi8(s[1], shuffles[1][r])),
+                                                _mm256_shuffle_epi8(s[2], shuffles[2][r]));
+            store_lanes(block + r * 16UL, block + 48UL + r * 16UL, out);
+        }
+    }
+    decode_scalar_range<3>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_avx2_int24(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_avx2_int24_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+/********* END SSE AND AVX2 KERNELS ***************/
+
+/********* BEGIN AVX-512 KERNELS ***************/
+
+// Without VBMI there is no byte permute across the 128-bit lanes. The kernels transpose
+// the bytes within every lane with vpshufb, transpose the lanes of the 4 (or 8) registers
+// with unpacks and fix the order of the dwords (or words) with vpermd (or vpermw).
+
+// Byte j of every lane is byte (j % num_groups) * group_size + j / num_groups of the lane.
+AVX512_TARGET
+static inline __m512i make_lane_shuffle(size_t group_size, size_t num_groups) {
+    alignas(64) uint8_t indices[64];
+    for (size_t j = 0; j < 64; ++j) {
+        const size_t k = j % 16;
+        indices[j] = (uint8_t)((k % num_groups) * group_size + k / num_groups);
+    }
+    return _mm512_load_si512(indices);
+}
+
+// Element m of the result is element (m % num_groups) * group_size + m / num_groups.
+AVX512_TARGET
+static inline __m512i make_dword_permute(size_t group_size, size_t num_groups) {
+    alignas(64) uint32_t indices[16];
+    for (size_t m = 0; m < 16; ++m) {
+        indices[m] = (uint32_t)((m % num_groups) * group_size + m / num_groups);
+    }
+    return _mm512_load_si512(indices);
+}
+
+AVX512_TARGET
+static inline __m512i make_word_permute(size_t group_size, size_t num_groups) {
+    alignas(64) uint16_t indices[32];
+    for (size_t m = 0; m < 32; ++m) {
+        indices[m] = (uint16_t)((m % num_groups) * group_size + m / num_groups);
+    }
+    return _mm512_load_si512(indices);
+}
+
+// Transposes the 4x4 dwords of every lane across the 4 registers.
+AVX512_TARGET
+static inline void transpose_4x4_dwords(__m512i v[4]) {
+    const __m512i a0 = _mm512_unpacklo_epi32(v[0], v[1]);
+    const __m512i a1 = _mm512_unpackhi_epi32(v[0], v[1]);
+    const __m512i a2 = _mm512_unpacklo_epi32(v[2], v[3]);
+    const __m512i a3 = _mm512_unpackhi_epi32(v[2], v[3]);
+    v[0] = _mm512_unpacklo_epi64(a0, a2);
+    v[1] = _mm512_unpackhi_epi64(a0, a2);
+    v[2] = _mm512_unpacklo_epi64(a1, a3);
+    v[3] = _mm512_unpackhi_epi64(a1, a3);
+}
+
+// Transposes the 8x8 words of every lane across the 8 registers.
+AVX512_TARGET
+static inline void transpose_8x8_words(__m512i v[8]) {
+    __m512i a[8];
+    __m512i b[8];
+    for (size_t i = 0; i < 4; ++i) {
+        a[i * 2] = _mm512_unpacklo_epi16(v[i * 2], v[i * 2 + 1]);
+        a[i * 2 + 1] = _mm512_unpackhi_epi16(v[i * 2], v[i * 2 + 1]);
+    }
+    for (size_t i = 0; i < 8; i += 4) {
+        for (size_t j = 0; j < 2; ++j) {
+            b[i + j * 2] = _mm512_unpacklo_epi32(a[i + j], a[i + j + 2]);
+            b[i + j * 2 + 1] = _mm512_unpackhi_epi32(a[i + j], a[i + j + 2]);
+        }
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        v[i * 2] = _mm512_unpacklo_epi64(b[i], b[i + 4]);
+        v[i * 2 + 1] = _mm512_unpackhi_epi64(b[i], b[i + 4]);
+    }
+}
+
+AVX512_TARGET
+void encode_avx512_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    // Group the 4 bytes of each stream of 4 floats in a dword.
+    const __m512i gather_streams = make_lane_shuffle(4, 4);
+    // Dword k of lane l moves to lane k, dword l.
+    const __m512i transpose_lanes = make_dword_permute(4, 4);
+    __m512i v[4];
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        for (size_t j = 0; j < 4; ++j) {
+            v[j] = _mm512_loadu_si512(input_data + i * 4UL + j * 64UL);
+            v[j] = _mm512_shuffle_epi8(v[j], gather_streams);
+        }
+        transpose_4x4_dwords(v);
+        for (size_t j = 0; j < 4; ++j) {
+            v[j] = _mm512_permutexvar_epi32(transpose_lanes, v[j]);
+            _mm512_storeu_si512(output_data + num_elements * j + i, v[j]);
+        }
+    }
+    encode_scalar_range<4>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_avx512_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_avx512_float_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX512_TARGET
+void decode_avx512_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    // All three steps of the encoder are their own inverse.
+    const __m512i scatter_streams = make_lane_shuffle(4, 4);
+    const __m512i transpose_lanes = make_dword_permute(4, 4);
+    __m512i v[4];
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        for (size_t j = 0; j < 4; ++j) {
+            v[j] = _mm512_loadu_si512(input_data + num_elements * j + i);
+            v[j] = _mm512_permutexvar_epi32(transpose_lanes, v[j]);
+        }
+        transpose_4x4_dwords(v);
+        for (size_t j = 0; j < 4; ++j) {
+            v[j] = _mm512_shuffle_epi8(v[j], scatter_streams);
+            _mm512_storeu_si512(output_data + i * 4UL + j * 64UL, v[j]);
+        }
+    }
+    decode_scalar_range<4>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_avx512_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_avx512_float_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX512_TARGET
+void encode_avx512_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    // Group the 2 bytes of each stream of 2 doubles in a word.
+    const __m512i gather_streams = make_lane_shuffle(8, 2);
+    // After the transpose word r of lane l holds elements of register r, so word m of
+    // the result is word (m % 4) * 8 + m / 4.
+    const __m512i transpose_lanes = make_word_permute(8, 4);
+    __m512i v[8];
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        for (size_t j = 0; j < 8; ++j) {
+            v[j] = _mm512_loadu_si512(input_data + i * 8UL + j * 64UL);
+            v[j] = _mm512_shuffle_epi8(v[j], gather_streams);
+        }
+        transpose_8x8_words(v);
+        for (size_t j = 0; j < 8; ++j) {
+            v[j] = _mm512_permutexvar_epi16(transpose_lanes, v[j]);
+            _mm512_storeu_si512(output_data + num_elements * j + i, v[j]);
+        }
+    }
+    encode_scalar_range<8>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_avx512_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_avx512_double_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX512_TARGET
+void decode_avx512_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    const __m512i scatter_streams = make_lane_shuffle(2, 8);
+    const __m512i transpose_lanes = make_word_permute(4, 8);
+    __m512i v[8];
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        for (size_t j = 0; j < 8; ++j) {
+            v[j] = _mm512_loadu_si512(input_data + num_elements * j + i);
+            v[j] = _mm512_permutexvar_epi16(transpose_lanes, v[j]);
+        }
+        transpose_8x8_words(v);
+        for (size_t j = 0; j < 8; ++j) {
+            v[j] = _mm512_shuffle_epi8(v[j], scatter_streams);
+            _mm512_storeu_si512(output_data + i * 8UL + j * 64UL, v[j]);
+        }
+    }
+    decode_scalar_range<8>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_avx512_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_avx512_double_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+// The 2-byte kernels work like the AVX2 ones, vpermq fixes the order of the qwords across the lanes.
+AVX512_TARGET
+void encode_avx512_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    const __m512i low_bytes = _mm512_set1_epi16(0x00FF);
+    const __m512i qword_order = _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0);
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        const __m512i a = _mm512_loadu_si512((void*)(input_data + i * 2UL));
+        const __m512i b = _mm512_loadu_si512((void*)(input_data + i * 2UL + 64UL));
+        const __m512i low = _mm512_packus_epi16(_mm512_and_si512(a, low_bytes), _mm512_and_si512(b, low_bytes));
+        const __m512i high = _mm512_packus_epi16(_mm512_srli_epi16(a, 8), _mm512_srli_epi16(b, 8));
+        _mm512_storeu_si512((void*)(output_data + i), _mm512_permutexvar_epi64(qword_order, low));
+        _mm512_storeu_si512((void*)(output_data + num_elements + i), _mm512_permutexvar_epi64(qword_order, high));
+    }
+    encode_scalar_range<2>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_avx512_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_avx512_half_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX512_TARGET
+void decode_avx512_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    const __m512i qword_order = _mm512_set_epi64(7, 3, 6, 2, 5, 1, 4, 0);
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        const __m512i low = _mm512_permutexvar_epi64(qword_order, _mm512_loadu_si512((void*)(input_data + i)));
+        const __m512i high = _mm512_permutexvar_epi64(qword_order, _mm512_loadu_si512((void*)(input_data + num_elements + i)));
+        _mm512_storeu_si512((void*)(output_data + i * 2UL), _mm512_unpacklo_epi8(low, high));
+        _mm512_storeu_si512((void*)(output_data + i * 2UL + 64UL), _mm512_unpackhi_epi8(low, high));
+    }
+    decode_scalar_range<2>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_avx512_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_avx512_half_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+/********* END AVX-512 KERNELS ***************/
+
+/********* BEGIN AVX-512 VBMI KERNELS ***************/
+
+// The AVX-512 kernels first gather the bytes of each stream inside a register with vpermb
+// and then transpose the 128-bit (float) or 64-bit (double) groups across the registers.
+
+// Transposes the 4x4 matrix of 128-bit lanes in v.
+AVX512_VBMI_TARGET
+static inline void transpose_4x4_lanes(__m512i v[4]) {
+    const __m512i t0 = _mm512_shuffle_i64x2(v[0], v[1], 0x44);
+    const __m512i t1 = _mm512_shuffle_i64x2(v[2], v[3], 0x44);
+    const __m512i t2 = _mm512_shuffle_i64x2(v[0], v[1], 0xEE);
+    const __m512i t3 = _mm512_shuffle_i64x2(v[2], v[3], 0xEE);
+    v[0] = _mm512_shuffle_i64x2(t0, t1, 0x88);
+    v[1] = _mm512_shuffle_i64x2(t0, t1, 0xDD);
+    v[2] = _mm512_shuffle_i64x2(t2, t3, 0x88);
+    v[3] = _mm512_shuffle_i64x2(t2, t3, 0xDD);
+}
+
+// Transposes the 8x8 matrix of 64-bit elements in v.
+AVX512_VBMI_TARGET
+static inline void transpose_8x8_qwords(__m512i v[8]) {
+    const __m512i idx_lo = _mm512_set_epi64(13, 12, 5, 4, 9, 8, 1, 0);
+    const __m512i idx_hi = _mm512_set_epi64(15, 14, 7, 6, 11, 10, 3, 2);
+    __m512i t[8];
+    for (size_t i = 0; i < 4; ++i) {
+        t[i] = _mm512_shuffle_i64x2(v[i], v[i + 4], 0x44);
+        t[i + 4] = _mm512_shuffle_i64x2(v[i], v[i + 4], 0xEE);
+    }
+    for (size_t i = 0; i < 8; i += 4) {
+        for (size_t j = 0; j < 2; ++j) {
+            v[i + j] = _mm512_permutex2var_epi64(t[i + j], idx_lo, t[i + j + 2]);
+            v[i + j + 2] = _mm512_permutex2var_epi64(t[i + j], idx_hi, t[i + j + 2]);
+        }
+    }
+    for (size_t i = 0; i < 8; i += 2) {
+        t[i] = _mm512_unpacklo_epi64(v[i], v[i + 1]);
+        t[i + 1] = _mm512_unpackhi_epi64(v[i], v[i + 1]);
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        v[i] = t[i];
+    }
+}
+
+// Byte j of the result is byte (j % num_groups) * group_size + j / num_groups of the source.
+AVX512_VBMI_TARGET
+static inline __m512i make_permute_indices(size_t group_size, size_t num_groups) {
+    alignas(64) uint8_t indices[64];
+    for (size_t j = 0; j < 64; ++j) {
+        indices[j] = (uint8_t)((j % num_groups) * group_size + j / num_groups);
+    }
+    return _mm512_load_si512(indices);
+}
+
+AVX512_VBMI_TARGET
+void encode_avx512_vbmi_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    // Group the 16 bytes of each stream of 16 floats together.
+    const __m512i gather_streams = make_permute_indices(4, 16);
+    __m512i v[4];
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        for (size_t j = 0; j < 4; ++j) {
+            v[j] = _mm512_loadu_si512(input_data + i * 4UL + j * 64UL);
+            v[j] = _mm512_permutexvar_epi8(gather_streams, v[j]);
+        }
+        transpose_4x4_lanes(v);
+        for (size_t j = 0; j < 4; ++j) {
+            _mm512_storeu_si512(output_data + num_elements * j + i, v[j]);
+        }
+    }
+    encode_scalar_range<4>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_avx512_vbmi_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_avx512_vbmi_float_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX512_VBMI_TARGET
+void decode_avx512_vbmi_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    // Interleave the 4 groups of 16 stream bytes back into 16 floats.
+    const __m512i scatter_streams = make_permute_indices(16, 4);
+    __m512i v[4];
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        for (size_t j = 0; j < 4; ++j) {
+            v[j] = _mm512_loadu_si512(input_data + num_elements * j + i);
+        }
+        transpose_4x4_lanes(v);
+        for (size_t j = 0; j < 4; ++j) {
+            v[j] = _mm512_permutexvar_epi8(scatter_streams, v[j]);
+            _mm512_storeu_si512(output_data + i * 4UL + j * 64UL, v[j]);
+        }
+    }
+    decode_scalar_range<4>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_avx512_vbmi_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_avx512_vbmi_float_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX512_VBMI_TARGET
+void encode_avx512_vbmi_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    // Group the 8 bytes of each stream of 8 doubles together.
+    // The permutation is its own inverse, so the decoder uses it as well.
+    const __m512i gather_streams = make_permute_indices(8, 8);
+    __m512i v[8];
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        for (size_t j = 0; j < 8; ++j) {
+            v[j] = _mm512_loadu_si512(input_data + i * 8UL + j * 64UL);
+            v[j] = _mm512_permutexvar_epi8(gather_streams, v[j]);
+        }
+        transpose_8x8_qwords(v);
+        for (size_t j = 0; j < 8; ++j) {
+            _mm512_storeu_si512(output_data + num_elements * j + i, v[j]);
+        }
+    }
+    encode_scalar_range<8>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_avx512_vbmi_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_avx512_vbmi_double_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX512_VBMI_TARGET
+void decode_avx512_vbmi_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    const __m512i scatter_streams = make_permute_indices(8, 8);
+    __m512i v[8];
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        for (size_t j = 0; j < 8; ++j) {
+            v[j] = _mm512_loadu_si512(input_data + num_elements * j + i);
+        }
+        transpose_8x8_qwords(v);
+        for (size_t j = 0; j < 8; ++j) {
+            v[j] = _mm512_permutexvar_epi8(scatter_streams, v[j]);
+            _mm512_storeu_si512(output_data + i * 8UL + j * 64UL, v[j]);
+        }
+    }
+    decode_scalar_range<8>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_avx512_vbmi_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_avx512_vbmi_double_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+// The 3-byte kernels handle 64 values, i.e. three registers, at a time. vpermt2b gathers a stream
+// (or 64 output bytes) from the first two registers and a masked vpermb merges in the bytes of the
+// third one. Both use the same indices, vpermb only looks at their low 6 bits.
+// Returns the mask of the bytes from the third register.
+static uint64_t make_int24_permute(size_t k, bool is_encode, uint8_t indices[64]) {
+    uint64_t third = 0;
+    for (size_t j = 0; j < 64; ++j) {
+        // Byte of the 192 encode input bytes, or byte of the three 64-byte streams for decode.
+        const size_t byte = is_encode ? j * 3 + k : (k * 64 + j) % 3 * 64 + (k * 64 + j) / 3;
+        indices[j] = (uint8_t)(byte % 128);
+        third |= (uint64_t)(byte >= 128) << j;
+    }
+    return third;
+}
+
+AVX512_VBMI_TARGET
+void encode_avx512_vbmi_int24_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    __m512i indices[3];
+    __mmask64 third[3];
+    for (size_t k = 0; k < 3; ++k) {
+        uint8_t raw_indices[64];
+        third[k] = make_int24_permute(k, true, raw_indices);
+        indices[k] = _mm512_loadu_si512((void*)raw_indices);
+    }
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        const uint8_t *block = input_data + i * 3UL;
+        const __m512i a = _mm512_loadu_si512((void*)block);
+        const __m512i b = _mm512_loadu_si512((void*)(block + 64UL));
+        const __m512i c = _mm512_loadu_si512((void*)(block + 128UL));
+        for (size_t k = 0; k < 3; ++k) {
+            __m512i stream = _mm512_permutex2var_epi8(a, indices[k], b);
+            stream = _mm512_mask_permutexvar_epi8(stream, third[k], indices[k], c);
+            _mm512_storeu_si512((void*)(output_data + num_elements * k + i), stream);
+        }
+    }
+    encode_scalar_range<3>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void encode_avx512_vbmi_int24(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_avx512_vbmi_int24_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+AVX512_VBMI_TARGET
+void decode_avx512_vbmi_int24_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    const size_t num_blocked_elements = begin + (end - begin) / 64UL * 64UL;
+    __m512i indices[3];
+    __mmask64 third[3];
+    for (size_t r = 0; r < 3; ++r) {
+        uint8_t raw_indices[64];
+        third[r] = make_int24_permute(r, false, raw_indices);
+        indices[r] = _mm512_loadu_si512((void*)raw_indices);
+    }
+    for (size_t i = begin; i < num_blocked_elements; i += 64UL) {
+        const __m512i s0 = _mm512_loadu_si512((void*)(input_data + i));
+        const __m512i s1 = _mm512_loadu_si512((void*)(input_data + num_elements + i));
+        const __m512i s2 = _mm512_loadu_si512((void*)(input_data + num_elements * 2UL + i));
+        uint8_t *block = output_data + i * 3UL;
+        for (size_t r = 0; r < 3; ++r) {
+            __m512i out = _mm512_permutex2var_epi8(s0, indices[r], s1);
+            out = _mm512_mask_permutexvar_epi8(out, third[r], indices[r], s2);
+            _mm512_storeu_si512((void*)(block + r * 64UL), out);
+        }
+    }
+    decode_scalar_range<3>(input_data, num_elements, num_blocked_elements, end, output_data);
+}
+
+void decode_avx512_vbmi_int24(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_avx512_vbmi_int24_range(input_data, num_elements, 0, num_elements, output_data);
+}
+
+/********* END AVX-512 VBMI KERNELS ***************/
+
+/********* BEGIN DISPATCH ***************/
+
+static SimdLevel detect_simd_level() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vbmi")) {
+        return SimdAVX512;
+    }
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return SimdAVX512BW;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdAVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdSSE;
+    }
+    return SimdScalar;
+}
+
+SimdLevel get_simd_level() {
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+const char *simd_level_to_string(SimdLevel level) {
+    switch (level) {
+        case SimdScalar:
+            return "scalar";
+        case SimdSSE:
+            return "sse";
+        case SimdAVX2:
+            return "avx2";
+        case SimdAVX512BW:
+            return "avx512bw";
+        case SimdAVX512:
+            return "avx512_vbmi";
+        default:
+            return "unknown";
+    }
+}
+
+SplitKernel get_encode_kernel(size_t type_size, SimdLevel level) {
+    if (type_size == 2) {
+        switch (level) {
+            case SimdScalar: return encode_scalar<2>;
+            case SimdSSE: return encode_simd_half;
+            case SimdAVX2: return encode_avx2_half;
+            case SimdAVX512BW:
+            case SimdAVX512: return encode_avx512_half;
+        }
+    } else if (type_size == 3) {
+        // vpshufb needs SSSE3, which SimdSSE does not imply.
+        switch (level) {
+            case SimdScalar:
+            case SimdSSE: return encode_scalar<3>;
+            case SimdAVX2:
+            case SimdAVX512BW: return encode_avx2_int24;
+            case SimdAVX512: return encode_avx512_vbmi_int24;
+        }
+    } else if (type_size == 4) {
+        switch (level) {
+            case SimdScalar: return encode_scalar<4>;
+            case SimdSSE: return encode_simd_float;
+            case SimdAVX2: return encode_avx2_float;
+            case SimdAVX512BW: return encode_avx512_float;
+            case SimdAVX512: return encode_avx512_vbmi_float;
+        }
+    } else if (type_size == 8) {
+        switch (level) {
+            case SimdScalar: return encode_scalar<8>;
+            case SimdSSE: return encode_simd_double;
+            case SimdAVX2: return encode_avx2_double;
+            case SimdAVX512BW: return encode_avx512_double;
+            case SimdAVX512: return encode_avx512_vbmi_double;
+        }
+    }
+    return NULL;
+}
+
+SplitKernel get_decode_kernel(size_t type_size, SimdLevel level) {
+    if (type_size == 2) {
+        switch (level) {
+            case SimdScalar: return decode_scalar<2>;
+            case SimdSSE: return decode_simd_half;
+            case SimdAVX2: return decode_avx2_half;
+            case SimdAVX512BW:
+            case SimdAVX512: return decode_avx512_half;
+        }
+    } else if (type_size == 3) {
+        // vpshufb needs SSSE3, which SimdSSE does not imply.
+        switch (level) {
+            case SimdScalar:
+            case SimdSSE: return decode_scalar<3>;
+            case SimdAVX2:
+            case SimdAVX512BW: return decode_avx2_int24;
+            case SimdAVX512: return decode_avx512_vbmi_int24;
+        }
+    } else if (type_size == 4) {
+        switch (level) {
+            case SimdScalar: return decode_scalar<4>;
+            case SimdSSE: return decode_simd_float;
+            case SimdAVX2: return decode_avx2_float;
+            case SimdAVX512BW: return decode_avx512_float;
+            case SimdAVX512: return decode_avx512_vbmi_float;
+        }
+    } else if (type_size == 8) {
+        switch (level) {
+            case SimdScalar: return decode_scalar<8>;
+            case SimdSSE: return decode_simd_double;
+            case SimdAVX2: return decode_avx2_double;
+            case SimdAVX512BW: return decode_avx512_double;
+            case SimdAVX512: return decode_avx512_vbmi_double;
+        }
+    }
+    return NULL;
+}
+
+SplitRangeKernel get_encode_range_kernel(size_t type_size, SimdLevel level) {
+    if (type_size == 2) {
+        switch (level) {
+            case SimdScalar: return encode_scalar_range<2>;
+            case SimdSSE: return encode_simd_half_range;
+            case SimdAVX2: return encode_avx2_half_range;
+            case SimdAVX512BW:
+            case SimdAVX512: return encode_avx512_half_range;
+        }
+    } else if (type_size == 3) {
+        // vpshufb needs SSSE3, which SimdSSE does not imply.
+        switch (level) {
+            case SimdScalar:
+            case SimdSSE: return encode_scalar_range<3>;
+            case SimdAVX2:
+            case SimdAVX512BW: return encode_avx2_int24_range;
+            case SimdAVX512: return encode_avx512_vbmi_int24_range;
+        }
+    } else if (type_size == 4) {
+        switch (level) {
+            case SimdScalar: return encode_scalar_range<4>;
+            case SimdSSE: return encode_simd_float_range;
+            case SimdAVX2: return encode_avx2_float_range;
+            case SimdAVX512BW: return encode_avx512_float_range;
+            case SimdAVX512: return encode_avx512_vbmi_float_range;
+        }
+    } else if (type_size == 8) {
+        switch (level) {
+            case SimdScalar: return encode_scalar_range<8>;
+            case SimdSSE: return encode_simd_double_range;
+            case SimdAVX2: return encode_avx2_double_range;
+            case SimdAVX512BW: return encode_avx512_double_range;
+            case SimdAVX512: return encode_avx512_vbmi_double_range;
+        }
+    }
+    return NULL;
+}
+
+SplitRangeKernel get_decode_range_kernel(size_t type_size, SimdLevel level) {
+    if (type_size == 2) {
+        switch (level) {
+            case SimdScalar: return decode_scalar_range<2>;
+            case SimdSSE: return decode_simd_half_range;
+            case SimdAVX2: return decode_avx2_half_range;
+            case SimdAVX512BW:
+            case SimdAVX512: return decode_avx512_half_range;
+        }
+    } else if (type_size == 3) {
+        // vpshufb needs SSSE3, which SimdSSE does not imply.
+        switch (level) {
+            case SimdScalar:
+            case SimdSSE: return decode_scalar_range<3>;
+            case SimdAVX2:
+            case SimdAVX512BW: return decode_avx2_int24_range;
+            case SimdAVX512: return decode_avx512_vbmi_int24_range;
+        }
+    } else if (type_size == 4) {
+        switch (level) {
+            case SimdScalar: return decode_scalar_range<4>;
+            case SimdSSE: return decode_simd_float_range;
+            case SimdAVX2: return decode_avx2_float_range;
+            case SimdAVX512BW: return decode_avx512_float_range;
+            case SimdAVX512: return decode_avx512_vbmi_float_range;
+        }
+    } else if (type_size == 8) {
+        switch (level) {
+            case SimdScalar: return decode_scalar_range<8>;
+            case SimdSSE: return decode_simd_double_range;
+            case SimdAVX2: return decode_avx2_double_range;
+            case SimdAVX512BW: return decode_avx512_double_range;
+            case SimdAVX512: return decode_avx512_vbmi_double_range;
+        }
+    }
+    return NULL;
+}
+
+void byte_stream_split_encode(const uint8_t *input_data, size_t num_elements, size_t type_size, uint8_t *output_data) {
+    static const SplitKernel half_kernel = get_encode_kernel(2, get_simd_level());
+    static const SplitKernel int24_kernel = get_encode_kernel(3, get_simd_level());
+    static const SplitKernel float_kernel = get_encode_kernel(4, get_simd_level());
+    static const SplitKernel double_kernel = get_encode_kernel(8, get_simd_level());
+    if (type_size == 2) {
+        half_kernel(input_data, num_elements, output_data);
+    } else if (type_size == 3) {
+        int24_kernel(input_data, num_elements, output_data);
+    } else if (type_size == 4) {
+        float_kernel(input_data, num_elements, output_data);
+    } else if (type_size == 8) {
+        double_kernel(input_data, num_elements, output_data);
+    } else {
+        for (size_t i = 0; i < num_elements; ++i) {
+            for (size_t k = 0; k < type_size; ++k) {
+                output_data[k * num_elements + i] = input_data[i * type_size + k];
+            }
+        }
+    }
+}
+
+void byte_stream_split_decode(const uint8_t *input_data, size_t num_elements, size_t type_size, uint8_t *output_data) {
+    static const SplitKernel half_kernel = get_decode_kernel(2, get_simd_level());
+    static const SplitKernel int24_kernel = get_decode_kernel(3, get_simd_level());
+    static const SplitKernel float_kernel = get_decode_kernel(4, get_simd_level());
+    static const SplitKernel double_kernel = get_decode_kernel(8, get_simd_level());
+    if (type_size == 2) {
+        half_kernel(input_data, num_elements, output_data);
+    } else if (type_size == 3) {
+        int24_kernel(input_data, num_elements, output_data);
+    } else if (type_size == 4) {
+        float_kernel(input_data, num_elements, output_data);
+    } else if (type_size == 8) {
+        double_kernel(input_data, num_elements, output_data);
+    } else {
+        for (size_t i = 0; i < num_elements; ++i) {
+            for (size_t k = 0; k < type_size; ++k) {
+                output_data[i * type_size + k] = input_data[k * num_elements + i];
+            }
+        }
+    }
+}
+
+/********* END DISPATCH ***************/
+
+/********* BEGIN PARALLEL ***************/
+
+// The ranges of the threads are multiples of this many elements. Only the last range has
+// a scalar tail, and two threads never write to the same page of the first stream.
+static const size_t kParallelGrain = 4096;
+
+static void get_thread_range(size_t num_elements, size_t num_threads, size_t thread_id, size_t &begin, size_t &end) {
+    const size_t num_grains = (num_elements + kParallelGrain - 1) / kParallelGrain;
+    const size_t grains_per_thread = num_grains / num_threads;
+    const size_t num_extra_grains = num_grains % num_threads;
+    begin = (thread_id * grains_per_thread + std::min(thread_id, num_extra_grains)) * kParallelGrain;
+    end = begin + (grains_per_thread + (thread_id < num_extra_grains ? 1 : 0)) * kParallelGrain;
+    begin = std::min(begin, num_elements);
+    end = std::min(end, num_elements);
+}
+
+// Pins the calling thread to the (thread_id % count)-th CPU the process may run on.
+// Linux places a page on the NUMA node of the CPU which touches it first.
+static void pin_current_thread(const cpu_set_t &allowed, size_t thread_id) {
+    const size_t num_cpus = CPU_COUNT(&allowed);
+    if (num_cpus == 0) {
+        return;
+    }
+    size_t target = thread_id % num_cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        if (target == 0) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(cpu, &cpuset);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+            return;
+        }
+        --target;
+    }
+}
+
+// Runs work(begin, end) for the range of every thread and waits for all of them.
+template<typename Work>
+static void run_partitioned(size_t num_elements, size_t num_threads, const Work &work) {
+    if (num_threads <= 1 || num_elements < 2 * kParallelGrain) {
+        work(0, num_elements);
+        return;
+    }
+    // The affinity mask of the caller, read before any worker changes its own.
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool can_pin = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads);
+    for (size_t t = 0; t < num_threads; ++t) {
+        size_t begin, end;
+        get_thread_range(num_elements, num_threads, t, begin, end);
+        threads.push_back(std::thread([&work, &allowed, can_pin, t, begin, end]() {
+            if (can_pin) {
+                pin_current_thread(allowed, t);
+            }
+            work(begin, end);
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+}
+
+void byte_stream_split_encode_parallel(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                       uint8_t *output_data, size_t num_threads) {
+    const SplitRangeKernel kernel = get_encode_range_kernel(type_size, get_simd_level());
+    run_partitioned(num_elements, num_threads, [&](size_t begin, size_t end) {
+        if (kernel != NULL) {
+            kernel(input_data, num_elements, begin, end, output_data);
+            return;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            for (size_t k = 0; k < type_size; ++k) {
+                output_data[k * num_elements + i] = input_data[i * type_size + k];
+            }
+        }
+    });
+}
+
+void byte_stream_split_decode_parallel(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                       uint8_t *output_data, size_t num_threads) {
+    const SplitRangeKernel kernel = get_decode_range_kernel(type_size, get_simd_level());
+    run_partitioned(num_elements, num_threads, [&](size_t begin, size_t end) {
+        if (kernel != NULL) {
+            kernel(input_data, num_elements, begin, end, output_data);
+            return;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            for (size_t k = 0; k < type_size; ++k) {
+                output_data[i * type_size + k] = input_data[k * num_elements + i];
+            }
+        }
+    });
+}
+
+void byte_stream_split_first_touch(uint8_t *data, size_t num_elements, size_t type_size,
+                                   bool is_split_layout, size_t num_threads) {
+    run_partitioned(num_elements, num_threads, [&](size_t begin, size_t end) {
+        if (is_split_layout) {
+            for (size_t k = 0; k < type_size; ++k) {
+                memset(data + k * num_elements + begin, 0, end - begin);
+            }
+        } else {
+            memset(data + begin * type_size, 0, (end - begin) * type_size);
+        }
+    });
+}
+
+/********* END PARALLEL ***************/
+
+/********* BEGIN TILED ***************/
+
+// Bytes of one tile. The input and the output of a tile fit into L2 together.
+static const size_t kTileBytes = 128 * 1024;
+
+// Copies num_bytes with non-temporal stores, so the destination does not evict the tiles
+// from the cache and is not read before it is written.
+AVX2_TARGET
+static void stream_copy_avx2(uint8_t *dst, const uint8_t *src, size_t num_bytes) {
+    const size_t head = std::min(num_bytes, (size_t)((32 - ((uintptr_t)dst & 31)) & 31));
+    memcpy(dst, src, head);
+    size_t i = head;
+    for (; i + 32 <= num_bytes; i += 32) {
+        _mm256_stream_si256((__m256i*)(dst + i), _mm256_loadu_si256((const __m256i*)(src + i)));
+    }
+    memcpy(dst + i, src + i, num_bytes - i);
+}
+
+static void stream_copy_sse(uint8_t *dst, const uint8_t *src, size_t num_bytes) {
+    const size_t head = std::min(num_bytes, (size_t)((16 - ((uintptr_t)dst & 15)) & 15));
+    memcpy(dst, src, head);
+    size_t i = head;
+    for (; i + 16 <= num_bytes; i += 16) {
+        _mm_stream_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+    }
+    memcpy(dst + i, src + i, num_bytes - i);
+}
+
+static void stream_copy(uint8_t *dst, const uint8_t *src, size_t num_bytes) {
+    if (get_simd_level() >= SimdAVX2) {
+        stream_copy_avx2(dst, src, num_bytes);
+    } else {
+        stream_copy_sse(dst, src, num_bytes);
+    }
+}
+
+static uint8_t *get_tile_buffer() {
+    static thread_local std::vector<uint8_t> buffer(2 * kTileBytes);
+    return buffer.data();
+}
+
+void byte_stream_split_encode_tiled(const uint8_t *input_data, size_t num_elements, size_t type_size, uint8_t *output_data) {
+    const size_t tile_elements = kTileBytes / type_size;
+    const SplitKernel kernel = get_encode_kernel(type_size, get_simd_level());
+    uint8_t *tile = get_tile_buffer();
+    for (size_t begin = 0; begin < num_elements; begin += tile_elements) {
+        const size_t length = std::min(tile_elements, num_elements - begin);
+        const uint8_t *tile_input = input_data + begin * type_size;
+        // Split the tile in the cache, then write out one stream slice after the other.
+        if (kernel != NULL) {
+            kernel(tile_input, length, tile);
+        } else {
+            for (size_t i = 0; i < length; ++i) {
+                for (size_t k = 0; k < type_size; ++k) {
+                    tile[k * length + i] = tile_input[i * type_size + k];
+                }
+            }
+        }
+        for (size_t k = 0; k < type_size; ++k) {
+            stream_copy(output_data + k * num_elements + begin, tile + k * length, length);
+        }
+    }
+    _mm_sfence();
+}
+
+void byte_stream_split_decode_tiled(const uint8_t *input_data, size_t num_elements, size_t type_size, uint8_t *output_data) {
+    const size_t tile_elements = kTileBytes / type_size;
+    const SplitKernel kernel = get_decode_kernel(type_size, get_simd_level());
+    uint8_t *tile_input = get_tile_buffer();
+    uint8_t *tile_output = tile_input + kTileBytes;
+    for (size_t begin = 0; begin < num_elements; begin += tile_elements) {
+        const size_t length = std::min(tile_elements, num_elements - begin);
+        // Gather the stream slices of the tile, so the kernel reads them from the cache.
+        for (size_t k = 0; k < type_size; ++k) {
+            memcpy(tile_input + k * length, input_data + k * num_elements + begin, length);
+        }
+        if (kernel != NULL) {
+            kernel(tile_input, length, tile_output);
+        } else {
+            for (size_t i = 0; i < length; ++i) {
+                for (size_t k = 0; k < type_size; ++k) {
+                    tile_output[i * type_size + k] = tile_input[k * length + i];
+                }
+            }
+        }
+        stream_copy(output_data + begin * type_size, tile_output, length * type_size);
+    }
+    _mm_sfence();
+}
+
+/********* END TILED ***************/
+
+/********* BEGIN DELTA ***************/
+
+// The delta kernels transform num_elements values. previous points to the value before
+// the first one, or is NULL at the start of a buffer, where the predecessor is zero.
+typedef void (*DeltaKernel)(const uint8_t *input_data, size_t num_elements, const uint8_t *previous,
+                            uint8_t *output_data);
+
+// Forward and inverse operations of the transforms. The inverse operation is associative,
+// so the decoders compute it as a prefix scan in a vector.
+template<size_t type_size> struct DeltaType;
+template<> struct DeltaType<4> { typedef uint32_t T; };
+template<> struct DeltaType<8> { typedef uint64_t T; };
+
+template<size_t type_size>
+struct XorOp {
+    typedef typename DeltaType<type_size>::T T;
+    static T forward(T value, T previous) { return value ^ previous; }
+    static T inverse(T delta, T previous) { return delta ^ previous; }
+    AVX2_TARGET static __m256i forward256(__m256i value, __m256i previous) { return _mm256_xor_si256(value, previous); }
+    AVX2_TARGET static __m256i inverse256(__m256i delta, __m256i previous) { return _mm256_xor_si256(delta, previous); }
+    AVX512_TARGET static __m512i forward512(__m512i value, __m512i previous) { return _mm512_xor_si512(value, previous); }
+    AVX512_TARGET static __m512i inverse512(__m512i delta, __m512i previous) { return _mm512_xor_si512(delta, previous); }
+};
+
+template<size_t type_size> struct SubOp;
+
+template<>
+struct SubOp<4> {
+    typedef uint32_t T;
+    static T forward(T value, T previous) { return value - previous; }
+    static T inverse(T delta, T previous) { return delta + previous; }
+    AVX2_TARGET static __m256i forward256(__m256i value, __m256i previous) { return _mm256_sub_epi32(value, previous); }
+    AVX2_TARGET static __m256i inverse256(__m256i delta, __m256i previous) { return _mm256_add_epi32(delta, previous); }
+    AVX512_TARGET static __m512i forward512(__m512i value, __m512i previous) { return _mm512_sub_epi32(value, previous); }
+    AVX512_TARGET static __m512i inverse512(__m512i delta, __m512i previous) { return _mm512_add_epi32(delta, previous); }
+};
+
+template<>
+struct SubOp<8> {
+    typedef uint64_t T;
+    static T forward(T value, T previous) { return value - previous; }
+    static T inverse(T delta, T previous) { return delta + previous; }
+    AVX2_TARGET static __m256i forward256(__m256i value, __m256i previous) { return _mm256_sub_epi64(value, previous); }
+    AVX2_TARGET static __m256i inverse256(__m256i delta, __m256i previous) { return _mm256_add_epi64(delta, previous); }
+    AVX512_TARGET static __m512i forward512(__m512i value, __m512i previous) { return _mm512_sub_epi64(value, previous); }
+    AVX512_TARGET static __m512i inverse512(__m512i delta, __m512i previous) { return _mm512_add_epi64(delta, previous); }
+};
+
+// Inclusive prefix scan of the inverse operation within a vector, and the broadcast of the
+// last element which carries the scan into the next vector.
+template<size_t type_size> struct DeltaScan;
+
+template<>
+struct DeltaScan<4> {
+    template<typename Op>
+    AVX2_TARGET static __m256i scan256(__m256i x) {
+        x = Op::inverse256(x, _mm256_slli_si256(x, 4));
+        x = Op::inverse256(x, _mm256_slli_si256(x, 8));
+        // Carry the last element of the low 128-bit lane into the high lane.
+        const __m256i low = _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(3));
+        return Op::inverse256(x, _mm256_blend_epi32(_mm256_setzero_si256(), low, 0xF0));
+    }
+    AVX2_TARGET static __m256i broadcast_last256(__m256i x) {
+        return _mm256_permutevar8x32_epi32(x, _mm256_set1_epi32(7));
+    }
+    AVX2_TARGET static __m256i broadcast256(uint32_t value) {
+        return _mm256_set1_epi32((int)value);
+    }
+    template<typename Op>
+    AVX512_TARGET static __m512i scan512(__m512i x) {
+        const __m512i zero = _mm512_setzero_si512();
+        x = Op::inverse512(x, _mm512_alignr_epi32(x, zero, 15));
+        x = Op::inverse512(x, _mm512_alignr_epi32(x, zero, 14));
+        x = Op::inverse512(x, _mm512_alignr_epi32(x, zero, 12));
+        return Op::inverse512(x, _mm512_alignr_epi32(x, zero, 8));
+    }
+    AVX512_TARGET static __m512i broadcast_last512(__m512i x) {
+        return _mm512_permutexvar_epi32(_mm512_set1_epi32(15), x);
+    }
+    AVX512_TARGET static __m512i broadcast512(uint32_t value) {
+        return _mm512_set1_epi32((int)value);
+    }
+};
+
+template<>
+struct DeltaScan<8> {
+    template<typename Op>
+    AVX2_TARGET static __m256i scan256(__m256i x) {
+        x = Op::inverse256(x, _mm256_slli_si256(x, 8));
+        const __m256i low = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 1, 1, 1));
+        return Op::inverse256(x, _mm256_blend_epi32(_mm256_setzero_si256(), low, 0xF0));
+    }
+    AVX2_TARGET static __m256i broadcast_last256(__m256i x) {
+        return _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    AVX2_TARGET static __m256i broadcast256(uint64_t value) {
+        return _mm256_set1_epi64x((long long)value);
+    }
+    template<typename Op>
+    AVX512_TARGET static __m512i scan512(__m512i x) {
+        const __m512i zero = _mm512_setzero_si512();
+        x = Op::inverse512(x, _mm512_alignr_epi64(x, zero, 7));
+        x = Op::inverse512(x, _mm512_alignr_epi64(x, zero, 6));
+        return Op::inverse512(x, _mm512_alignr_epi64(x, zero, 4));
+    }
+    AVX512_TARGET static __m512i broadcast_last512(__m512i x) {
+        return _mm512_permutexvar_epi64(_mm512_set1_epi64(7), x);
+    }
+    AVX512_TARGET static __m512i broadcast512(uint64_t value) {
+        return _mm512_set1_epi64((long long)value);
+    }
+};
+
+template<size_t type_size, typename Op>
+static typename Op::T load_previous(const uint8_t *previous) {
+    typename Op::T value = 0;
+    if (previous != NULL) {
+        memcpy(&value, previous, type_size);
+    }
+    return value;
+}
+
+template<size_t type_size, typename Op>
+static void delta_encode_scalar(const uint8_t *input_data, size_t num_elements, const uint8_t *previous,
+                                uint8_t *output_data) {
+    typedef typename Op::T T;
+    const T *input = (const T*)input_data;
+    T *output = (T*)output_data;
+    T prev = load_previous<type_size, Op>(previous);
+    for (size_t i = 0; i < num_elements; ++i) {
+        output[i] = Op::forward(input[i], prev);
+        prev = input[i];
+    }
+}
+
+template<size_t type_size, typename Op>
+static void delta_decode_scalar(const uint8_t *input_data, size_t num_elements, const uint8_t *previous,
+                                uint8_t *output_data) {
+    typedef typename Op::T T;
+    const T *input = (const T*)input_data;
+    T *output = (T*)output_data;
+    T prev = load_previous<type_size, Op>(previous);
+    for (size_t i = 0; i < num_elements; ++i) {
+        prev = Op::inverse(input[i], prev);
+        output[i] = prev;
+    }
+}
+
+template<size_t type_size, typename Op>
+AVX2_TARGET
+static void delta_encode_avx2(const uint8_t *input_data, size_t num_elements, const uint8_t *previous,
+                              uint8_t *output_data) {
+    if (num_elements == 0) {
+        return;
+    }
+    typedef typename Op::T T;
+    const T *input = (const T*)input_data;
+    T *output = (T*)output_data;
+    output[0] = Op::forward(input[0], load_previous<type_size, Op>(previous));
+    const size_t block = 32 / type_size;
+    size_t i = 1;
+    // The predecessors are the same values, loaded one element earlier.
+    for (; i + block <= num_elements; i += block) {
+        const __m256i value = _mm256_loadu_si256((const __m256i*)(input + i));
+        const __m256i prev = _mm256_loadu_si256((const __m256i*)(input + i - 1));
+        _mm256_storeu_si256((__m256i*)(output + i), Op::forward256(value, prev));
+    }
+    for (; i < num_elements; ++i) {
+        output[i] = Op::forward(input[i], input[i - 1]);
+    }
+}
+
+template<size_t type_size, typename Op>
+AVX2_TARGET
+static void delta_decode_avx2(const uint8_t *input_data, size_t num_elements, const uint8_t *previous,
+                              uint8_t *output_data) {
+    typedef typename Op::T T;
+    const T *input = (const T*)input_data;
+    T *output = (T*)output_data;
+    const size_t block = 32 / type_size;
+    __m256i carry = DeltaScan<type_size>::broadcast256(load_previous<type_size, Op>(previous));
+    size_t i = 0;
+    for (; i + block <= num_elements; i += block) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(input + i));
+        x = Op::inverse256(DeltaScan<type_size>::template scan256<Op>(x), carry);
+        _mm256_storeu_si256((__m256i*)(output + i), x);
+        carry = DeltaScan<type_size>::broadcast_last256(x);
+    }
+    delta_decode_scalar<type_size, Op>(input_data + i * type_size, num_elements - i,
+                                       i > 0 ? output_data + (i - 1) * type_size : previous,
+                                       output_data + i * type_size);
+}
+
+template<size_t type_size, typename Op>
+AVX512_TARGET
+static void delta_encode_avx512(const uint8_t *input_data, size_t num_elements, const uint8_t *previous,
+                                uint8_t *output_data) {
+    if (num_elements == 0) {
+        return;
+    }
+    typedef typename Op::T T;
+    const T *input = (const T*)input_data;
+    T *output = (T*)output_data;
+    output[0] = Op::forward(input[0], load_previous<type_size, Op>(previous));
+    const size_t block = 64 / type_size;
+    size_t i = 1;
+    for (; i + block <= num_elements; i += block) {
+        const __m512i value = _mm512_loadu_si512((const void*)(input + i));
+        const __m512i prev = _mm512_loadu_si512((const void*)(input + i - 1));
+        _mm512_storeu_si512((void*)(output + i), Op::forward512(value, prev));
+    }
+    for (; i < num_elements; ++i) {
+        output[i] = Op::forward(input[i], input[i - 1]);
+    }
+}
+
+template<size_t type_size, typename Op>
+AVX512_TARGET
+static void delta_decode_avx512(const uint8_t *input_data, size_t num_elements, const uint8_t *previous,
+                                uint8_t *output_data) {
+    typedef typename Op::T T;
+    const T *input = (const T*)input_data;
+    T *output = (T*)output_data;
+    const size_t block = 64 / type_size;
+    __m512i carry = DeltaScan<type_size>::broadcast512(load_previous<type_size, Op>(previous));
+    size_t i = 0;
+    for (; i + block <= num_elements; i += block) {
+        __m512i x = _mm512_loadu_si512((const void*)(input + i));
+        x = Op::inverse512(DeltaScan<type_size>::template scan512<Op>(x), carry);
+        _mm512_storeu_si512((void*)(output + i), x);
+        carry = DeltaScan<type_size>::broadcast_last512(x);
+    }
+    delta_decode_scalar<type_size, Op>(input_data + i * type_size, num_elements - i,
+                                       i > 0 ? output_data + (i - 1) * type_size : previous,
+                                       output_data + i * type_size);
+}
+
+template<size_t type_size, typename Op>
+static DeltaKernel get_delta_kernel_for_op(bool is_encode, SimdLevel level) {
+    if (level >= SimdAVX512BW) {
+        return is_encode ? delta_encode_avx512<type_size, Op> : delta_decode_avx512<type_size, Op>;
+    }
+    if (level >= SimdAVX2) {
+        return is_encode ? delta_encode_avx2<type_size, Op> : delta_decode_avx2<type_size, Op>;
+    }
+    return is_encode ? delta_encode_scalar<type_size, Op> : delta_decode_scalar<type_size, Op>;
+}
+
+template<size_t type_size>
+static DeltaKernel get_delta_kernel_for_size(DeltaTransform transform, bool is_encode, SimdLevel level) {
+    switch (transform) {
+        case DeltaXor:
+            return get_delta_kernel_for_op<type_size, XorOp<type_size> >(is_encode, level);
+        case DeltaSub:
+            return get_delta_kernel_for_op<type_size, SubOp<type_size> >(is_encode, level);
+        default:
+            return NULL;
+    }
+}
+
+// Returns the fastest kernel for the host, or NULL for the type sizes without one.
+static DeltaKernel get_delta_kernel(size_t type_size, DeltaTransform transform, bool is_encode) {
+    const SimdLevel level = get_simd_level();
+    if (type_size == 4) {
+        return get_delta_kernel_for_size<4>(transform, is_encode, level);
+    } else if (type_size == 8) {
+        return get_delta_kernel_for_size<8>(transform, is_encode, level);
+    }
+    return NULL;
+}
+
+// Byte-wise transform of values of any size. The subtraction propagates the borrow from
+// the low to the high bytes, so it matches the SIMD kernels.
+static void delta_scalar_bytes(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                               DeltaTransform transform, bool is_encode, const uint8_t *previous,
+                               uint8_t *output_data) {
+    for (size_t i = 0; i < num_elements; ++i) {
+        const uint8_t *value = input_data + i * type_size;
+        uint8_t *out = output_data + i * type_size;
+        const uint8_t *prev = i > 0 ? (is_encode ? value - type_size : out - type_size) : previous;
+        int carry = 0;
+        for (size_t k = 0; k < type_size; ++k) {
+            const int p = prev != NULL ? prev[k] : 0;
+            if (transform == DeltaXor) {
+                out[k] = value[k] ^ p;
+            } else if (is_encode) {
+                const int diff = value[k] - p - carry;
+                out[k] = (uint8_t)diff;
+                carry = diff < 0;
+            } else {
+                const int sum = value[k] + p + carry;
+                out[k] = (uint8_t)sum;
+                carry = sum > 0xFF;
+            }
+        }
+    }
+}
+
+static void delta_transform(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                            DeltaTransform transform, bool is_encode, const uint8_t *previous,
+                            uint8_t *output_data) {
+    if (transform == DeltaNone) {
+        memcpy(output_data, input_data, num_elements * type_size);
+        return;
+    }
+    const DeltaKernel kernel = get_delta_kernel(type_size, transform, is_encode);
+    if (kernel != NULL) {
+        kernel(input_data, num_elements, previous, output_data);
+    } else {
+        delta_scalar_bytes(input_data, num_elements, type_size, transform, is_encode, previous, output_data);
+    }
+}
+
+const char *delta_transform_to_string(DeltaTransform transform) {
+    switch (transform) {
+        case DeltaNone:
+            return "none";
+        case DeltaXor:
+            return "xor";
+        case DeltaSub:
+            return "sub";
+    }
+    return "unknown";
+}
+
+void delta_encode(const uint8_t *input_data, size_t num_elements, size_t type_size, DeltaTransform transform,
+                  uint8_t *output_data) {
+    delta_transform(input_data, num_elements, type_size, transform, true, NULL, output_data);
+}
+
+void delta_decode(const uint8_t *input_data, size_t num_elements, size_t type_size, DeltaTransform transform,
+                  uint8_t *output_data) {
+    delta_transform(input_data, num_elements, type_size, transform, false, NULL, output_data);
+}
+
+// Bytes of one tile of the delta kernels. Both intermediate buffers of a tile stay in L1.
+static const size_t kDeltaTileBytes = 16 * 1024;
+
+void byte_stream_split_encode_delta(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                    DeltaTransform transform, uint8_t *output_data) {
+    const size_t tile_elements = kDeltaTileBytes / type_size;
+    const SplitRangeKernel kernel = get_encode_range_kernel(type_size, get_simd_level());
+    uint8_t *tile = get_tile_buffer();
+    for (size_t begin = 0; begin < num_elements; begin += tile_elements) {
+        const size_t end = std::min(num_elements, begin + tile_elements);
+        const uint8_t *tile_input = input_data + begin * type_size;
+        delta_transform(tile_input, end - begin, type_size, transform, true,
+                        begin > 0 ? tile_input - type_size : NULL, tile);
+        // The range kernels index the input with the element number, so the tile is passed
+        // as if it were at its place in the whole buffer.
+        const uint8_t *tile_base = tile - begin * type_size;
+        if (kernel != NULL) {
+            kernel(tile_base, num_elements, begin, end, output_data);
+        } else {
+            for (size_t i = begin; i < end; ++i) {
+                for (size_t k = 0; k < type_size; ++k) {
+                    output_data[k * num_elements + i] = tile_base[i * type_size + k];
+                }
+            }
+        }
+    }
+}
+
+void byte_stream_split_decode_delta(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                    DeltaTransform transform, uint8_t *output_data) {
+    const size_t tile_elements = kDeltaTileBytes / type_size;
+    const SplitRangeKernel kernel = get_decode_range_kernel(type_size, get_simd_level());
+    for (size_t begin = 0; begin < num_elements; begin += tile_elements) {
+        const size_t end = std::min(num_elements, begin + tile_elements);
+        uint8_t *tile_output = output_data + begin * type_size;
+        // Merge the streams into the output, then revert the transform in place while the tile is in L1.
+        if (kernel != NULL) {
+            kernel(input_data, num_elements, begin, end, output_data);
+        } else {
+            for (size_t i = begin; i < end; ++i) {
+                for (size_t k = 0; k < type_size; ++k) {
+                    output_data[i * type_size + k] = input_data[k * num_elements + i];
+                }
+            }
+        }
+        // The scan continues from the last value of the previous tile.
+        delta_transform(tile_output, end - begin, type_size, transform, false,
+                        begin > 0 ? tile_output - type_size : NULL, tile_output);
+    }
+}
+
+/********* END DELTA ***************/
+
+/********* BEGIN ADAPTIVE ***************/
+
+// The SIMD classifiers look at one vector out of this many, so that classifying costs
+// a small fraction of the split. The ratios of the counts are all the decision needs.
+static const size_t kClassifierSampleStride = 4;
+
+// Counts of the bytes and of the whole values which equal the ones of the preceding value.
+struct RepeatCounts {
+    size_t equal_bytes;
+    size_t equal_values;
+};
+
+// Bits at the first byte of every value in a mask with one bit per byte.
+template<size_t type_size>
+static uint64_t value_start_bits() {
+    return type_size == 4 ? 0x1111111111111111ULL : 0x0101010101010101ULL;
+}
+
+// Collapses the bits of every value in mask onto its first bit, which stays set only if
+// all bytes of the value are set.
+template<size_t type_size>
+static inline uint64_t all_bytes_equal(uint64_t mask) {
+    for (size_t shift = 1; shift < type_size; shift <<= 1) {
+        mask &= mask >> shift;
+    }
+    return mask & value_start_bits<type_size>();
+}
+
+static RepeatCounts count_repeats_scalar(const uint8_t *input_data, size_t num_bytes, size_t type_size) {
+    RepeatCounts counts = {0, 0};
+    for (size_t j = type_size; j < num_bytes; j += type_size) {
+        size_t equal = 0;
+        for (size_t k = 0; k < type_size; ++k) {
+            equal += input_data[j + k] == input_data[j + k - type_size];
+        }
+        counts.equal_bytes += equal;
+        counts.equal_values += equal == type_size;
+    }
+    return counts;
+}
+
+// popcnt comes with every AVX2 host. Without it, the counts become calls into libgcc.
+template<size_t type_size>
+__attribute__((target("avx2,popcnt")))
+static RepeatCounts count_repeats_avx2(const uint8_t *input_data, size_t num_bytes) {
+    RepeatCounts counts = {0, 0};
+    size_t j = type_size;
+    for (; j + 32 <= num_bytes; j += 32 * kClassifierSampleStride) {
+        const __m256i value = _mm256_loadu_si256((const __m256i*)(input_data + j));
+        const __m256i previous = _mm256_loadu_si256((const __m256i*)(input_data + j - type_size));
+        const uint64_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(value, previous));
+        counts.equal_bytes += __builtin_popcountll(mask);
+        counts.equal_values += __builtin_popcountll(all_bytes_equal<type_size>(mask));
+    }
+    if (j == type_size) {
+        // The block is shorter than a vector.
+        counts = count_repeats_scalar(input_data, num_bytes, type_size);
+    }
+    return counts;
+}
+
+template<size_t type_size>
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static RepeatCounts count_repeats_avx512(const uint8_t *input_data, size_t num_bytes) {
+    RepeatCounts counts = {0, 0};
+    size_t j = type_size;
+    for (; j + 64 <= num_bytes; j += 64 * kClassifierSampleStride) {
+        const __m512i value = _mm512_loadu_si512((const void*)(input_data + j));
+        const __m512i previous = _mm512_loadu_si512((const void*)(input_data + j - type_size));
+        const uint64_t mask = _mm512_cmpeq_epi8_mask(value, previous);
+        counts.equal_bytes += __builtin_popcountll(mask);
+        counts.equal_values += __builtin_popcountll(all_bytes_equal<type_size>(mask));
+    }
+    if (j == type_size) {
+        // The block is shorter than a vector.
+        counts = count_repeats_scalar(input_data, num_bytes, type_size);
+    }
+    return counts;
+}
+
+bool adaptive_byte_stream_split_classify(const uint8_t *input_data, size_t num_elements, size_t type_size) {
+    const size_t num_bytes = num_elements * type_size;
+    RepeatCounts counts;
+    if (type_size != 4 && type_size != 8) {
+        counts = count_repeats_scalar(input_data, num_bytes, type_size);
+    } else if (get_simd_level() >= SimdAVX512BW) {
+        counts = type_size == 4 ? count_repeats_avx512<4>(input_data, num_bytes)
+                                : count_repeats_avx512<8>(input_data, num_bytes);
+    } else if (get_simd_level() >= SimdAVX2) {
+        counts = type_size == 4 ? count_repeats_avx2<4>(input_data, num_bytes)
+                                : count_repeats_avx2<8>(input_data, num_bytes);
+    } else {
+        counts = count_repeats_scalar(input_data, num_bytes, type_size);
+    }
+    // Split unless the fraction of repeated values is at least half the fraction of repeated bytes.
+    return 2 * counts.equal_values * type_size <= counts.equal_bytes;
+}
+
+static size_t adaptive_num_blocks(size_t num_elements, size_t block_size) {
+    return (num_elements + block_size - 1) / block_size;
+}
+
+size_t adaptive_byte_stream_split_encoded_size(size_t num_elements, size_t type_size, size_t block_size) {
+    return (adaptive_num_blocks(num_elements, block_size) + 7) / 8 + num_elements * type_size;
+}
+
+void adaptive_byte_stream_split_encode(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                       size_t block_size, uint8_t *output_data) {
+    const size_t num_blocks = adaptive_num_blocks(num_elements, block_size);
+    uint8_t *block_types = output_data;
+    uint8_t *blocks = output_data + (num_blocks + 7) / 8;
+    memset(block_types, 0, (num_blocks + 7) / 8);
+    for (size_t b = 0; b < num_blocks; ++b) {
+        const size_t begin = b * block_size;
+        const size_t length = std::min(block_size, num_elements - begin);
+        const uint8_t *block_input = input_data + begin * type_size;
+        uint8_t *block_output = blocks + begin * type_size;
+        if (adaptive_byte_stream_split_classify(block_input, length, type_size)) {
+            block_types[b / 8] |= (uint8_t)(1 << (b % 8));
+            byte_stream_split_encode(block_input, length, type_size, block_output);
+        } else {
+            memcpy(block_output, block_input, length * type_size);
+        }
+    }
+}
+
+void adaptive_byte_stream_split_decode(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                       size_t block_size, uint8_t *output_data) {
+    const size_t num_blocks = adaptive_num_blocks(num_elements, block_size);
+    const uint8_t *block_types = input_data;
+    const uint8_t *blocks = input_data + (num_blocks + 7) / 8;
+    for (size_t b = 0; b < num_blocks; ++b) {
+        const size_t begin = b * block_size;
+        const size_t length = std::min(block_size, num_elements - begin);
+        const uint8_t *block_input = blocks + begin * type_size;
+        uint8_t *block_output = output_data + begin * type_size;
+        if (block_types[b / 8] & (1 << (b % 8))) {
+            byte_stream_split_decode(block_input, length, type_size, block_output);
+        } else {
+            memcpy(block_output, block_input, length * type_size);
+        }
+    }
+}
+
+/********* END ADAPTIVE ***************/
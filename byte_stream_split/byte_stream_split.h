@@ -0,0 +1,203 @@
+#ifndef BYTE_STREAM_SPLIT_H
+#define BYTE_STREAM_SPLIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// BYTE_STREAM_SPLIT kernels for 2-byte (half, bfloat16 and 16-bit integers), 3-byte (24-bit
+// integers), 4-byte (float) and 8-byte (double) values.
+//
+// Encoding scatters byte k of element i to output_data[k * num_elements + i].
+// Decoding is the inverse operation.
+// Every kernel accepts an arbitrary number of elements. The elements which do not
+// fill a whole SIMD block are handled by the scalar path.
+//
+// The SIMD kernels are compiled with per-function target attributes, so the library
+// does not need -march and can be used on any x86-64 host. Call the SIMD kernels
+// directly only if get_simd_level() reports support for them. Otherwise use
+// byte_stream_split_encode/byte_stream_split_decode which dispatch to the fastest
+// kernel supported by the host.
+
+enum SimdLevel {
+    SimdScalar = 0,
+    SimdSSE,
+    SimdAVX2,
+    // AVX-512 F and BW.
+    SimdAVX512BW,
+    // AVX-512 with VBMI for the vpermb byte permute.
+    SimdAVX512,
+};
+
+typedef void (*SplitKernel)(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+// Transforms only the elements in [begin, end) of a buffer with num_elements elements.
+typedef void (*SplitRangeKernel)(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+
+// Detects the instruction set of the host with CPUID. The result is cached.
+SimdLevel get_simd_level();
+
+const char *simd_level_to_string(SimdLevel level);
+
+// Returns the kernel for the given type size (2, 3, 4 or 8) and level, or NULL if there is none.
+SplitKernel get_encode_kernel(size_t type_size, SimdLevel level);
+SplitKernel get_decode_kernel(size_t type_size, SimdLevel level);
+SplitRangeKernel get_encode_range_kernel(size_t type_size, SimdLevel level);
+SplitRangeKernel get_decode_range_kernel(size_t type_size, SimdLevel level);
+
+// Dispatch to the fastest kernel for the host. Type sizes other than 2, 3, 4 and 8 use a scalar loop.
+void byte_stream_split_encode(const uint8_t *input_data, size_t num_elements, size_t type_size, uint8_t *output_data);
+void byte_stream_split_decode(const uint8_t *input_data, size_t num_elements, size_t type_size, uint8_t *output_data);
+
+// Multi-threaded variants for large buffers. The element range is partitioned across
+// num_threads threads and each thread writes its slice of every stream in place.
+// Thread t is pinned to the t-th CPU of the process affinity mask.
+void byte_stream_split_encode_parallel(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                       uint8_t *output_data, size_t num_threads);
+void byte_stream_split_decode_parallel(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                       uint8_t *output_data, size_t num_threads);
+
+// Writes zeros to a freshly allocated buffer with the partition and pinning of the
+// parallel kernels, so that the first touch places every page on the NUMA node of the
+// thread which will later write it. Use is_split_layout for the output of the encoder.
+void byte_stream_split_first_touch(uint8_t *data, size_t num_elements, size_t type_size,
+                                   bool is_split_layout, size_t num_threads);
+
+// Tiled variants for buffers much larger than the caches. Every tile of 128 KiB is
+// transformed in a scratch buffer which stays in L2, and is then written to the output
+// with non-temporal stores. The output is thus not read before it is written and does not
+// evict the input from the cache, but a later read of the output misses the cache.
+void byte_stream_split_encode_tiled(const uint8_t *input_data, size_t num_elements, size_t type_size, uint8_t *output_data);
+void byte_stream_split_decode_tiled(const uint8_t *input_data, size_t num_elements, size_t type_size, uint8_t *output_data);
+
+// Pre-transforms which make the byte streams of slowly changing values more compressible.
+// The first value is kept as it is.
+enum DeltaTransform {
+    DeltaNone = 0,
+    // Every value is XORed with its predecessor.
+    DeltaXor,
+    // The predecessor is subtracted from every value. The bits are treated as unsigned
+    // little-endian integers, so the subtraction wraps around and is lossless.
+    DeltaSub,
+};
+
+const char *delta_transform_to_string(DeltaTransform transform);
+
+// Applies or reverts the transform on num_elements values. The buffers must not overlap.
+// Type sizes 4 and 8 use SIMD kernels, other type sizes a scalar loop.
+void delta_encode(const uint8_t *input_data, size_t num_elements, size_t type_size, DeltaTransform transform,
+                  uint8_t *output_data);
+void delta_decode(const uint8_t *input_data, size_t num_elements, size_t type_size, DeltaTransform transform,
+                  uint8_t *output_data);
+
+// The transform followed by BYTE_STREAM_SPLIT, and the inverse. Both are done tile by tile,
+// so the intermediate values stay in L1 and the memory traffic is the same as for the split alone.
+void byte_stream_split_encode_delta(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                    DeltaTransform transform, uint8_t *output_data);
+void byte_stream_split_decode_delta(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                    DeltaTransform transform, uint8_t *output_data);
+
+// ADAPTIVE_BYTE_STREAM_SPLIT divides the values into blocks of block_size values and stores
+// every block either as it is (PLAIN) or split into streams of the block's values.
+// The encoded data starts with a bitmap with one bit per block, set for the split blocks,
+// followed by the blocks in order. Only the bitmap adds to the size of the values.
+size_t adaptive_byte_stream_split_encoded_size(size_t num_elements, size_t type_size, size_t block_size);
+
+// Returns true if the block should be split. The classifier compares sampled bytes with the same
+// byte of the preceding value with SIMD compares. A block stays PLAIN if whole values repeat about
+// as often as single bytes do, since then a codec finds the repeats in the plain values.
+bool adaptive_byte_stream_split_classify(const uint8_t *input_data, size_t num_elements, size_t type_size);
+
+// output_data must have room for adaptive_byte_stream_split_encoded_size bytes.
+void adaptive_byte_stream_split_encode(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                       size_t block_size, uint8_t *output_data);
+void adaptive_byte_stream_split_decode(const uint8_t *input_data, size_t num_elements, size_t type_size,
+                                       size_t block_size, uint8_t *output_data);
+
+template<size_t type_size>
+void encode_scalar_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    for (size_t i = begin; i < end; ++i) {
+        for (size_t k = 0; k < type_size; ++k) {
+            output_data[k * num_elements + i] = input_data[i * type_size + k];
+        }
+    }
+}
+
+template<size_t type_size>
+void decode_scalar_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data) {
+    for (size_t i = begin; i < end; ++i) {
+        for (size_t k = 0; k < type_size; ++k) {
+            output_data[i * type_size + k] = input_data[k * num_elements + i];
+        }
+    }
+}
+
+template<size_t type_size>
+void encode_scalar(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    encode_scalar_range<type_size>(input_data, num_elements, 0, num_elements, output_data);
+}
+
+template<size_t type_size>
+void decode_scalar(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
+    decode_scalar_range<type_size>(input_data, num_elements, 0, num_elements, output_data);
+}
+
+void encode_simd_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_simd_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_simd_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_simd_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void encode_simd_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_simd_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_simd_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_simd_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+
+void encode_simd_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_simd_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_simd_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_simd_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+
+void encode_avx2_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_avx2_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_avx2_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_avx2_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void encode_avx2_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_avx2_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_avx2_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_avx2_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+
+void encode_avx2_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_avx2_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_avx2_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_avx2_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void encode_avx2_int24(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_avx2_int24_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_avx2_int24(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_avx2_int24_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+
+void encode_avx512_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_avx512_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_avx512_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_avx512_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void encode_avx512_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_avx512_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_avx512_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_avx512_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+
+void encode_avx512_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_avx512_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_avx512_half(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_avx512_half_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+
+void encode_avx512_vbmi_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_avx512_vbmi_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_avx512_vbmi_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_avx512_vbmi_float_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void encode_avx512_vbmi_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_avx512_vbmi_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_avx512_vbmi_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_avx512_vbmi_double_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+
+void encode_avx512_vbmi_int24(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void encode_avx512_vbmi_int24_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+void decode_avx512_vbmi_int24(const uint8_t *input_data, size_t num_elements, uint8_t *output_data);
+void decode_avx512_vbmi_int24_range(const uint8_t *input_data, size_t num_elements, size_t begin, size_t end, uint8_t *output_data);
+
+#endif // BYTE_STREAM_SPLIT_H
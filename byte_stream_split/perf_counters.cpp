@@ -0,0 +1,136 @@
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// The value, the time enabled and the time running.
+static bool read_event(int fd, uint64_t data[3]) {
+    return read(fd, data, 3 * sizeof(uint64_t)) == (ssize_t)(3 * sizeof(uint64_t));
+}
+
+static int open_event(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // The calling thread on any CPU.
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+const char *perf_event_to_string(PerfEvent event) {
+    switch (event) {
+        case PerfCycles:
+            return "cycles";
+        case PerfInstructions:
+            return "instructions";
+        case PerfL1DMisses:
+            return "l1d_misses";
+        case PerfLLCMisses:
+            return "llc_misses";
+        default:
+            return "unknown";
+    }
+}
+
+bool perf_counters_open(PerfCounters *counters) {
+    counters->fds[PerfCycles] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counters->fds[PerfInstructions] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counters->fds[PerfL1DMisses] = open_event(PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    counters->fds[PerfLLCMisses] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    for (size_t i = 0; i < PerfNumEvents; ++i) {
+        if (counters->fds[i] >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void perf_counters_close(PerfCounters *counters) {
+    for (size_t i = 0; i < PerfNumEvents; ++i) {
+        if (counters->fds[i] >= 0) {
+            close(counters->fds[i]);
+            counters->fds[i] = -1;
+        }
+    }
+}
+
+void perf_counters_clear(PerfCounterValues *values) {
+    for (size_t i = 0; i < PerfNumEvents; ++i) {
+        values->counts[i] = 0;
+        values->is_valid[i] = false;
+    }
+}
+
+void perf_counters_start(PerfCounters *counters) {
+    for (size_t i = 0; i < PerfNumEvents; ++i) {
+        if (counters->fds[i] >= 0) {
+            uint64_t data[3] = {0, 0, 0};
+            ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+            read_event(counters->fds[i], data);
+            counters->time_enabled[i] = data[1];
+            counters->time_running[i] = data[2];
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void perf_counters_stop(PerfCounters *counters, PerfCounterValues *values) {
+    for (size_t i = 0; i < PerfNumEvents; ++i) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (size_t i = 0; i < PerfNumEvents; ++i) {
+        if (counters->fds[i] < 0) {
+            continue;
+        }
+        uint64_t data[3];
+        if (!read_event(counters->fds[i], data)) {
+            continue;
+        }
+        const uint64_t time_enabled = data[1] - counters->time_enabled[i];
+        const uint64_t time_running = data[2] - counters->time_running[i];
+        if (time_running == 0) {
+            continue;
+        }
+        uint64_t count = data[0];
+        if (time_running < time_enabled) {
+            count = (uint64_t)((double)count * time_enabled / time_running);
+        }
+        values->counts[i] += count;
+        values->is_valid[i] = true;
+    }
+}
+
+void perf_counters_format(const PerfCounterValues *values, uint64_t num_bytes, char *buf, size_t buf_size) {
+    char fields[PerfNumEvents][32];
+    for (size_t i = 0; i < PerfNumEvents; ++i) {
+        if (values->is_valid[i]) {
+            snprintf(fields[i], sizeof(fields[i]), "%llu", (unsigned long long)values->counts[i]);
+        } else {
+            snprintf(fields[i], sizeof(fields[i]), "n/a");
+        }
+    }
+    char ipc[32] = "n/a";
+    char bytes_per_cycle[32] = "n/a";
+    if (values->is_valid[PerfCycles] && values->counts[PerfCycles] > 0) {
+        const double cycles = (double)values->counts[PerfCycles];
+        if (values->is_valid[PerfInstructions]) {
+            snprintf(ipc, sizeof(ipc), "%.2f", values->counts[PerfInstructions] / cycles);
+        }
+        snprintf(bytes_per_cycle, sizeof(bytes_per_cycle), "%.2f", num_bytes / cycles);
+    }
+    snprintf(buf, buf_size, "cycles %s, instructions %s, IPC %s, L1D misses %s, LLC misses %s, bytes/cycle %s",
+             fields[PerfCycles], fields[PerfInstructions], ipc, fields[PerfL1DMisses], fields[PerfLLCMisses],
+             bytes_per_cycle);
+}
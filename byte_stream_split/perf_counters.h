@@ -0,0 +1,54 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Hardware performance counters of the calling thread, read with perf_event_open.
+//
+// Only user space is counted, which perf_event_paranoid up to 2 allows without privileges.
+// Every event is opened on its own, so an event which the host (or the hypervisor) does not
+// provide only leaves its value invalid. When the kernel multiplexes the counters, the counts
+// are scaled by the fraction of time the event was running.
+
+enum PerfEvent {
+    PerfCycles = 0,
+    PerfInstructions,
+    // Loads which miss the L1 data cache.
+    PerfL1DMisses,
+    // References which miss the last level cache.
+    PerfLLCMisses,
+    PerfNumEvents,
+};
+
+struct PerfCounters {
+    // -1 for the events which could not be opened.
+    int fds[PerfNumEvents];
+    // Time enabled and running at perf_counters_start. Resetting an event clears only its count,
+    // so the scaling uses the times since then.
+    uint64_t time_enabled[PerfNumEvents];
+    uint64_t time_running[PerfNumEvents];
+};
+
+struct PerfCounterValues {
+    uint64_t counts[PerfNumEvents];
+    bool is_valid[PerfNumEvents];
+};
+
+const char *perf_event_to_string(PerfEvent event);
+
+// Returns false if no event could be opened, e.g. in a container without access to the PMU.
+// The counters are closed in that case and perf_counters_start/stop do nothing.
+bool perf_counters_open(PerfCounters *counters);
+void perf_counters_close(PerfCounters *counters);
+
+void perf_counters_clear(PerfCounterValues *values);
+// Counts between start and stop are added to values, so a measurement can span several runs.
+void perf_counters_start(PerfCounters *counters);
+void perf_counters_stop(PerfCounters *counters, PerfCounterValues *values);
+
+// Formats cycles, instructions, IPC, L1D and LLC misses and the bytes per cycle for num_bytes
+// processed bytes, with n/a for the invalid values.
+void perf_counters_format(const PerfCounterValues *values, uint64_t num_bytes, char *buf, size_t buf_size);
+
+#endif
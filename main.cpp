@@ -3,13 +3,30 @@
 #include "arrow/table.h"
 #include "arrow/type.h"
 #include "arrow/io/file.h"
+#include "arrow/io/memory.h"
+#include "arrow/memory_pool.h"
+#include "arrow/record_batch.h"
+#include "arrow/util/checked_cast.h"
+#include "arrow/type_traits.h"
 #include "arrow/pretty_print.h"
 #include "arrow/util/compression.h"
+#include "arrow/util/config.h"
+#include "arrow/util/thread_pool.h"
 #include <parquet/arrow/writer.h>
 #include <parquet/arrow/reader.h>
 #include <parquet/properties.h>
 #include <parquet/types.h>
 #include <parquet/file_reader.h>
+#include <parquet/column_reader.h>
+#include <parquet/metadata.h>
+#include <parquet/statistics.h>
+#if ARROW_VERSION_MAJOR >= 12
+#include <parquet/page_index.h>
+#endif
+#include <parquet/encoding.h>
+#include <parquet/schema.h>
+#include "byte_stream_split/byte_stream_split.h"
+#include "byte_stream_split/perf_counters.h"
 
 #include <unordered_map>
 #include <unordered_set>
@@ -18,8 +35,18 @@
 #include <tuple>
 #include <sys/time.h>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <random>
 #include <unistd.h>
 #include <libgen.h>
+#include <pthread.h>
+#include <sched.h>
 
 namespace
 {
@@ -29,19 +56,377 @@ struct TestResult {
     std::string compression_name;
     std::string encoding_name;
     int32_t compression_level;
-    uint64_t original_size;
+    // Uncompressed bytes of the column values.
+    uint64_t logical_size;
+    // Bytes of the Parquet file, i.e. what was written to the output stream.
     uint64_t compressed_size;
+    // Bytes read back from the Parquet file.
+    uint64_t bytes_read;
+    // Share of logical_size in the columns and row groups which were read, which the read speeds refer to.
+    uint64_t read_logical_size = 0;
     double write_time_in_s;
     double read_time_in_s;
+    // Time of every measured run. write_time_in_s and read_time_in_s are their means.
+    std::vector<double> write_times_in_s;
+    std::vector<double> read_times_in_s;
+    // Writer configuration the result was measured with.
+    int64_t data_page_size = 0;
+    int64_t row_group_size = 0;
+    int64_t dictionary_page_size = 0;
+    int64_t write_batch_size = 0;
+    // Reader configuration. 0 read threads is the serial reader.
+    int64_t read_threads = 0;
+    bool pre_buffer = false;
+    int64_t batch_size = 0;
+    int64_t io_threads = 0;
+    int64_t columns_read = 0;
+    int64_t row_groups_read = 0;
+    // Only tracked in streaming mode.
+    int64_t peak_memory_in_bytes = 0;
+    // Hardware counters of WriteTable and ReadTable summed over the measured runs, only with -perf.
+    PerfCounterValues write_counters = {};
+    PerfCounterValues read_counters = {};
+    // Mean time of every stage, only with -mode codec and -mode pushdown.
+    std::vector<std::pair<std::string, double> > stage_times_in_s;
+    bool statistics = true;
+    bool page_index = false;
+    // Data pages of the FP columns, the pages and column chunks the pushdown scan skipped and the
+    // values within the range, only with -mode pushdown.
+    bool has_pushdown = false;
+    int64_t pages = 0;
+    int64_t pages_skipped = 0;
+    int64_t column_chunks_skipped = 0;
+    int64_t matches = 0;
 };
 
-void print_result(const TestResult &result) {
-    const double compression_ratio = (double)result.original_size / result.compressed_size;
-    const double compression_speed = ((double)result.original_size / (1024*1024)) / result.write_time_in_s;
-    const double decompression_speed = ((double)result.original_size / (1024*1024)) / result.read_time_in_s;
+bool hasPerfCounters(const PerfCounterValues &values)
+{
+    for (size_t i = 0; i < PerfNumEvents; ++i) {
+        if (values.is_valid[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+enum class OutputFormat
+{
+    Text,
+    Json,
+    Csv
+};
+
+// What -mode measures for every job.
+enum class BenchmarkMode
+{
+    Parquet,
+    Codec,
+    Pushdown
+};
+
+// Describes the machine and the run, so that results from different hosts can be merged.
+struct RunMetadata
+{
+    std::string host_name;
+    std::string cpu_model;
+    std::string arrow_version;
+    size_t num_threads;
+    size_t num_warmup_runs;
+    // Text results print the writer and reader properties only when they are set.
+    bool writer_sweep;
+    bool reader_options;
+};
+
+std::string readCpuModel()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            const size_t colon = line.find(':');
+            if (colon != std::string::npos && colon + 2 <= line.size()) {
+                return line.substr(colon + 2);
+            }
+        }
+    }
+    return "unknown";
+}
+
+RunMetadata collectRunMetadata(size_t num_threads, size_t num_warmup_runs, bool writer_sweep, bool reader_options)
+{
+    RunMetadata metadata;
+    char host_name[256] = {0};
+    if (gethostname(host_name, sizeof(host_name) - 1) != 0) {
+        strcpy(host_name, "unknown");
+    }
+    metadata.host_name = host_name;
+    metadata.cpu_model = readCpuModel();
+    metadata.arrow_version = ARROW_VERSION_STRING;
+    metadata.num_threads = num_threads;
+    metadata.num_warmup_runs = num_warmup_runs;
+    metadata.writer_sweep = writer_sweep;
+    metadata.reader_options = reader_options;
+    return metadata;
+}
+
+struct RunStatistics {
+    double mean;
+    double min;
+    double median;
+    double p95;
+    double stddev;
+};
+
+RunStatistics computeStatistics(std::vector<double> samples) {
+    RunStatistics stats = {.0, .0, .0, .0, .0};
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+    stats.mean = std::accumulate(samples.begin(), samples.end(), .0) / n;
+    stats.min = samples.front();
+    stats.median = (n % 2 == 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2.0;
+    // Nearest-rank percentile.
+    stats.p95 = samples[(size_t)std::ceil(0.95 * n) - 1];
+    double sum_sq = .0;
+    for (double sample : samples) {
+        sum_sq += (sample - stats.mean) * (sample - stats.mean);
+    }
+    stats.stddev = n > 1 ? std::sqrt(sum_sq / (n - 1)) : .0;
+    return stats;
+}
+
+// Prints: file codec encoding level ratio write_MB/s read_MB/s physical_write_MB/s physical_read_MB/s,
+// then min, median, p95 and stddev of the write time and of the read time in seconds,
+// and the peak memory in bytes when it was tracked.
+void print_text_result(const TestResult &result, const RunMetadata &metadata) {
+    const double compression_ratio = (double)result.logical_size / result.compressed_size;
+    const double compression_speed = ((double)result.logical_size / (1024*1024)) / result.write_time_in_s;
+    const double decompression_speed = ((double)result.read_logical_size / (1024*1024)) / result.read_time_in_s;
+    const double physical_write_speed = ((double)result.compressed_size / (1024*1024)) / result.write_time_in_s;
+    const double physical_read_speed = ((double)result.bytes_read / (1024*1024)) / result.read_time_in_s;
+    const RunStatistics write_stats = computeStatistics(result.write_times_in_s);
+    const RunStatistics read_stats = computeStatistics(result.read_times_in_s);
     std::cout << result.file_name << " " << result.compression_name << " "
               << result.encoding_name << " " << result.compression_level << " "
-              << compression_ratio << " " << compression_speed << " " << decompression_speed << std::endl;
+              << compression_ratio << " " << compression_speed << " " << decompression_speed << " "
+              << physical_write_speed << " " << physical_read_speed << " "
+              << write_stats.min << " " << write_stats.median << " " << write_stats.p95 << " " << write_stats.stddev << " "
+              << read_stats.min << " " << read_stats.median << " " << read_stats.p95 << " " << read_stats.stddev;
+    if (result.peak_memory_in_bytes > 0) {
+        std::cout << " " << result.peak_memory_in_bytes;
+    }
+    std::cout << std::endl;
+    if (metadata.writer_sweep) {
+        std::cout << "  writer: data_page_size " << result.data_page_size << " row_group_size " << result.row_group_size
+                  << " dictionary_page_size " << result.dictionary_page_size
+                  << " write_batch_size " << result.write_batch_size
+                  << " statistics " << result.statistics << " page_index " << result.page_index << std::endl;
+    }
+    if (metadata.reader_options) {
+        std::cout << "  reader: read_threads " << result.read_threads << " pre_buffer " << result.pre_buffer
+                  << " batch_size " << result.batch_size << " io_threads " << result.io_threads
+                  << " columns_read " << result.columns_read << " row_groups_read " << result.row_groups_read
+                  << " bytes_read " << result.bytes_read << std::endl;
+    }
+    if (!result.stage_times_in_s.empty()) {
+        std::cout << "  stages:";
+        for (const auto &stage : result.stage_times_in_s) {
+            std::cout << " " << stage.first << " " << stage.second;
+        }
+        std::cout << std::endl;
+    }
+    if (result.has_pushdown) {
+        std::cout << "  pushdown: pages " << result.pages << " pages_skipped " << result.pages_skipped
+                  << " column_chunks_skipped " << result.column_chunks_skipped
+                  << " matches " << result.matches << std::endl;
+    }
+    // The bytes per cycle refer to the logical size written and read in all measured runs.
+    char counters[256];
+    if (hasPerfCounters(result.write_counters)) {
+        perf_counters_format(&result.write_counters, result.logical_size * result.write_times_in_s.size(),
+                             counters, sizeof(counters));
+        std::cout << "  write: " << counters << std::endl;
+    }
+    if (hasPerfCounters(result.read_counters)) {
+        perf_counters_format(&result.read_counters, result.read_logical_size * result.read_times_in_s.size(),
+                             counters, sizeof(counters));
+        std::cout << "  read: " << counters << std::endl;
+    }
+}
+
+std::string escapeJson(const std::string &value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            escaped += buf;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// Quotes the value if it contains a separator.
+std::string escapeCsv(const std::string &value) {
+    if (value.find_first_of(",\"\n") == std::string::npos) {
+        return value;
+    }
+    std::string escaped = "\"";
+    for (char c : value) {
+        if (c == '"') {
+            escaped += '"';
+        }
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+void print_json_samples(const char *name, const std::vector<double> &samples) {
+    std::cout << "\"" << name << "\":[";
+    for (size_t i = 0; i < samples.size(); ++i) {
+        std::cout << (i == 0 ? "" : ",") << samples[i];
+    }
+    std::cout << "]";
+}
+
+void print_json_statistics(const char *name, const RunStatistics &stats) {
+    std::cout << "\"" << name << "\":{\"mean\":" << stats.mean << ",\"min\":" << stats.min
+              << ",\"median\":" << stats.median << ",\"p95\":" << stats.p95
+              << ",\"stddev\":" << stats.stddev << "}";
+}
+
+// Only the valid counters are printed.
+void print_json_counters(const char *name, const PerfCounterValues &values) {
+    std::cout << "\"" << name << "\":{";
+    bool is_first = true;
+    for (size_t i = 0; i < PerfNumEvents; ++i) {
+        if (values.is_valid[i]) {
+            std::cout << (is_first ? "" : ",") << "\"" << perf_event_to_string((PerfEvent)i) << "\":" << values.counts[i];
+            is_first = false;
+        }
+    }
+    std::cout << "}";
+}
+
+// Prints one JSON object per line.
+void print_json_result(const TestResult &result, const RunMetadata &metadata) {
+    std::cout << "{\"file\":\"" << escapeJson(result.file_name) << "\""
+              << ",\"codec\":\"" << result.compression_name << "\""
+              << ",\"encoding\":\"" << result.encoding_name << "\""
+              << ",\"compression_level\":" << result.compression_level
+              << ",\"logical_size\":" << result.logical_size
+              << ",\"compressed_size\":" << result.compressed_size
+              << ",\"bytes_read\":" << result.bytes_read
+              << ",\"read_logical_size\":" << result.read_logical_size
+              << ",\"data_page_size\":" << result.data_page_size
+              << ",\"row_group_size\":" << result.row_group_size
+              << ",\"dictionary_page_size\":" << result.dictionary_page_size
+              << ",\"write_batch_size\":" << result.write_batch_size
+              << ",\"statistics\":" << (result.statistics ? "true" : "false")
+              << ",\"page_index\":" << (result.page_index ? "true" : "false")
+              << ",\"read_threads\":" << result.read_threads
+              << ",\"pre_buffer\":" << (result.pre_buffer ? "true" : "false")
+              << ",\"batch_size\":" << result.batch_size
+              << ",\"io_threads\":" << result.io_threads
+              << ",\"columns_read\":" << result.columns_read
+              << ",\"row_groups_read\":" << result.row_groups_read
+              << ",\"peak_memory\":" << result.peak_memory_in_bytes
+              << ",";
+    print_json_statistics("write_time_in_s", computeStatistics(result.write_times_in_s));
+    std::cout << ",";
+    print_json_statistics("read_time_in_s", computeStatistics(result.read_times_in_s));
+    std::cout << ",";
+    print_json_samples("write_times_in_s", result.write_times_in_s);
+    std::cout << ",";
+    print_json_samples("read_times_in_s", result.read_times_in_s);
+    if (!result.stage_times_in_s.empty()) {
+        std::cout << ",\"stage_times_in_s\":{";
+        for (size_t i = 0; i < result.stage_times_in_s.size(); ++i) {
+            std::cout << (i == 0 ? "" : ",") << "\"" << result.stage_times_in_s[i].first << "\":"
+                      << result.stage_times_in_s[i].second;
+        }
+        std::cout << "}";
+    }
+    if (result.has_pushdown) {
+        std::cout << ",\"pages\":" << result.pages << ",\"pages_skipped\":" << result.pages_skipped
+                  << ",\"column_chunks_skipped\":" << result.column_chunks_skipped
+                  << ",\"matches\":" << result.matches;
+    }
+    if (hasPerfCounters(result.write_counters) || hasPerfCounters(result.read_counters)) {
+        std::cout << ",";
+        print_json_counters("write_counters", result.write_counters);
+        std::cout << ",";
+        print_json_counters("read_counters", result.read_counters);
+    }
+    std::cout << ",\"host\":\"" << escapeJson(metadata.host_name) << "\""
+              << ",\"cpu_model\":\"" << escapeJson(metadata.cpu_model) << "\""
+              << ",\"arrow_version\":\"" << metadata.arrow_version << "\""
+              << ",\"num_threads\":" << metadata.num_threads
+              << ",\"num_warmup_runs\":" << metadata.num_warmup_runs
+              << "}" << std::endl;
+}
+
+void print_csv_header() {
+    std::cout << "file,codec,encoding,compression_level,logical_size,compressed_size,bytes_read,read_logical_size,"
+              << "data_page_size,row_group_size,dictionary_page_size,write_batch_size,statistics,page_index,"
+              << "read_threads,pre_buffer,batch_size,io_threads,columns_read,row_groups_read,peak_memory,"
+              << "pages,pages_skipped,column_chunks_skipped,matches,"
+              << "write_mean,write_min,write_median,write_p95,write_stddev,"
+              << "read_mean,read_min,read_median,read_p95,read_stddev,"
+              << "write_times,read_times,host,cpu_model,arrow_version,num_threads,num_warmup_runs" << std::endl;
+}
+
+// The per-run samples are joined with ';' so that they fit into a single field.
+void print_csv_result(const TestResult &result, const RunMetadata &metadata) {
+    const RunStatistics write_stats = computeStatistics(result.write_times_in_s);
+    const RunStatistics read_stats = computeStatistics(result.read_times_in_s);
+    std::cout << escapeCsv(result.file_name) << "," << result.compression_name << ","
+              << result.encoding_name << "," << result.compression_level << ","
+              << result.logical_size << "," << result.compressed_size << "," << result.bytes_read << ","
+              << result.read_logical_size << ","
+              << result.data_page_size << "," << result.row_group_size << ","
+              << result.dictionary_page_size << "," << result.write_batch_size << ","
+              << result.statistics << "," << result.page_index << ","
+              << result.read_threads << "," << result.pre_buffer << "," << result.batch_size << ","
+              << result.io_threads << "," << result.columns_read << "," << result.row_groups_read << ","
+              << result.peak_memory_in_bytes << ","
+              << result.pages << "," << result.pages_skipped << ","
+              << result.column_chunks_skipped << "," << result.matches << ","
+              << write_stats.mean << "," << write_stats.min << "," << write_stats.median << ","
+              << write_stats.p95 << "," << write_stats.stddev << ","
+              << read_stats.mean << "," << read_stats.min << "," << read_stats.median << ","
+              << read_stats.p95 << "," << read_stats.stddev << ",";
+    for (size_t i = 0; i < result.write_times_in_s.size(); ++i) {
+        std::cout << (i == 0 ? "" : ";") << result.write_times_in_s[i];
+    }
+    std::cout << ",";
+    for (size_t i = 0; i < result.read_times_in_s.size(); ++i) {
+        std::cout << (i == 0 ? "" : ";") << result.read_times_in_s[i];
+    }
+    std::cout << "," << escapeCsv(metadata.host_name) << "," << escapeCsv(metadata.cpu_model) << ","
+              << metadata.arrow_version << "," << metadata.num_threads << ","
+              << metadata.num_warmup_runs << std::endl;
+}
+
+void print_result(const TestResult &result, OutputFormat format, const RunMetadata &metadata) {
+    switch (format) {
+        case OutputFormat::Text:
+            print_text_result(result, metadata);
+            break;
+        case OutputFormat::Json:
+            print_json_result(result, metadata);
+            break;
+        case OutputFormat::Csv:
+            print_csv_result(result, metadata);
+            break;
+    }
 }
 
 inline double gettime() {
@@ -51,8 +436,103 @@ inline double gettime() {
     return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
 }
 
+// Forwards all calls to the wrapped file and counts how many bytes were read from it.
+class CountingRandomAccessFile : public arrow::io::RandomAccessFile
+{
+public:
+    explicit CountingRandomAccessFile(std::shared_ptr<arrow::io::RandomAccessFile> file)
+        : file_(std::move(file)), bytes_read_(0)
+    {
+    }
+
+    uint64_t bytes_read() const
+    {
+        return bytes_read_.load();
+    }
+
+    arrow::Status Close() override { return file_->Close(); }
+    bool closed() const override { return file_->closed(); }
+    arrow::Result<int64_t> Tell() const override { return file_->Tell(); }
+    arrow::Status Seek(int64_t position) override { return file_->Seek(position); }
+    arrow::Result<int64_t> GetSize() override { return file_->GetSize(); }
+
+    arrow::Result<int64_t> Read(int64_t nbytes, void *out) override
+    {
+        return count(file_->Read(nbytes, out));
+    }
+
+    arrow::Result<std::shared_ptr<arrow::Buffer>> Read(int64_t nbytes) override
+    {
+        return count(file_->Read(nbytes));
+    }
+
+    arrow::Result<int64_t> ReadAt(int64_t position, int64_t nbytes, void *out) override
+    {
+        return count(file_->ReadAt(position, nbytes, out));
+    }
+
+    arrow::Result<std::shared_ptr<arrow::Buffer>> ReadAt(int64_t position, int64_t nbytes) override
+    {
+        return count(file_->ReadAt(position, nbytes));
+    }
+
+private:
+    arrow::Result<int64_t> count(arrow::Result<int64_t> result)
+    {
+        if (result.ok()) {
+            bytes_read_ += *result;
+        }
+        return result;
+    }
+
+    arrow::Result<std::shared_ptr<arrow::Buffer>> count(arrow::Result<std::shared_ptr<arrow::Buffer>> result)
+    {
+        if (result.ok()) {
+            bytes_read_ += (*result)->size();
+        }
+        return result;
+    }
+
+    std::shared_ptr<arrow::io::RandomAccessFile> file_;
+    std::atomic<uint64_t> bytes_read_;
+};
+
+// Sums up the uncompressed size of all column chunks.
+uint64_t getUncompressedSize(const parquet::FileMetaData &metadata)
+{
+    uint64_t size = 0;
+    for (int i = 0; i < metadata.num_row_groups(); ++i) {
+        const auto row_group = metadata.RowGroup(i);
+        for (int j = 0; j < row_group->num_columns(); ++j) {
+            size += row_group->ColumnChunk(j)->total_uncompressed_size();
+        }
+    }
+    return size;
+}
+
+// Scales logical_size down to the share of the given column chunks in the uncompressed size of the file.
+// Reading all of them gives logical_size.
+uint64_t getReadLogicalSize(const parquet::FileMetaData &metadata,
+                            const std::vector<int> &column_indices,
+                            const std::vector<int> &row_groups,
+                            uint64_t logical_size)
+{
+    const uint64_t total_size = getUncompressedSize(metadata);
+    uint64_t size = 0;
+    for (const int row_group : row_groups) {
+        for (const int column : column_indices) {
+            size += metadata.RowGroup(row_group)->ColumnChunk(column)->total_uncompressed_size();
+        }
+    }
+    if (size == total_size || total_size == 0) {
+        return logical_size;
+    }
+    return (uint64_t)((double)logical_size * size / total_size);
+}
+
 // Reads a parquet file and returns an arrow::Table object.
-auto readParquetFile(const std::string &fname)
+// logical_size is set to the uncompressed size of all column chunks as recorded in the file metadata.
+auto readParquetFile(const std::string &fname, uint64_t &logical_size)
 {
     arrow::Result<std::shared_ptr<arrow::io::ReadableFile> > infile = arrow::io::ReadableFile::Open(
       fname, arrow::default_memory_pool());
@@ -66,97 +546,109 @@ auto readParquetFile(const std::string &fname)
           parquet::arrow::OpenFile(*infile, arrow::default_memory_pool(), &reader));
     std::shared_ptr<arrow::Table> table;
     PARQUET_THROW_NOT_OK(reader->ReadTable(&table));
+    logical_size = getUncompressedSize(*reader->parquet_reader()->metadata());
 
     return std::move(table);
 }
 
-template<typename T>
-auto transformRawVectorToArrowTable(const std::vector<T> &data)
-{
-    std::cerr << "This should not be reachable" << std::endl;
-}
-
-template<>
-auto transformRawVectorToArrowTable<float>(const std::vector<float> &data)
+// Maps a raw binary file of FP values and wraps the mapping as the values buffer of an array.
+// No copy of the data is made. The mapping is kept alive for as long as the table references it,
+// so the resident size is a single copy of the file and loading is bound by page faults.
+template<typename ArrowType>
+std::shared_ptr<arrow::Table> mapRawFileToArrowTable(const std::string &fname, uint64_t &file_size)
 {
-    arrow::FloatBuilder builder;
-    PARQUET_THROW_NOT_OK(builder.AppendValues(data));
-    std::shared_ptr<arrow::Array> array;
-    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+    using ArrayType = typename arrow::TypeTraits<ArrowType>::ArrayType;
+    using CType = typename ArrowType::c_type;
 
-    std::shared_ptr<arrow::Schema> schema = arrow::schema(
-        {arrow::field("values", arrow::float32())});
-
-    return arrow::Table::Make(schema, {array});
-}
+    arrow::Result<std::shared_ptr<arrow::io::MemoryMappedFile> > mapped_file =
+        arrow::io::MemoryMappedFile::Open(fname, arrow::io::FileMode::READ);
+    if (!mapped_file.ok()) {
+        std::cerr << "Couldn't map file " << fname << std::endl;
+        exit(-1);
+    }
+    const int64_t num_elements = *(*mapped_file)->GetSize() / sizeof(CType);
+    file_size = num_elements * sizeof(CType);
 
-template<>
-auto transformRawVectorToArrowTable<double>(const std::vector<double> &data)
-{
-    arrow::DoubleBuilder builder;
-    PARQUET_THROW_NOT_OK(builder.AppendValues(data));
-    std::shared_ptr<arrow::Array> array;
-    PARQUET_THROW_NOT_OK(builder.Finish(&array));
+    // ReadAt on a memory mapped file returns a zero-copy slice of the mapping.
+    std::shared_ptr<arrow::Buffer> values;
+    PARQUET_ASSIGN_OR_THROW(values, (*mapped_file)->ReadAt(0, file_size));
+    auto array = std::make_shared<ArrayType>(num_elements, values);
 
     std::shared_ptr<arrow::Schema> schema = arrow::schema(
-        {arrow::field("values", arrow::float64())});
+        {arrow::field("values", arrow::TypeTraits<ArrowType>::type_singleton())});
 
     return arrow::Table::Make(schema, {array});
 }
 
-template<typename T>
-auto readBinaryFile(const std::string &fname)
-{
-    std::vector<T> data;
-
-    std::ifstream input(fname, std::ifstream::in | std::ifstream::binary);
-
-    input.seekg(0, input.end);
-    size_t fileSize = input.tellg();
-    input.seekg(0, input.beg);
-
-    data.resize(fileSize / sizeof(T));
-
-    input.read(reinterpret_cast<char*>(data.data()), fileSize);
+const int64_t kDataPageSize = 1024 * 1024 * 16;
 
-    input.close();
-
-    return data;
-}
+// Writer properties which can be swept, see -page_size and the following options.
+struct WriterSettings
+{
+    int64_t data_page_size = kDataPageSize;
+    // Rows per row group. 0 writes every table, or every chunk when streaming, as one row group.
+    int64_t row_group_size = 0;
+    // Parquet falls back to the plain encoding once the dictionary grows beyond this size.
+    int64_t dictionary_page_size = parquet::DEFAULT_DICTIONARY_PAGE_SIZE_LIMIT;
+    // Values which the column writers take at once.
+    int64_t write_batch_size = parquet::DEFAULT_WRITE_BATCH_SIZE;
+    // Min/max statistics of the column chunks and the data page headers.
+    bool statistics = true;
+    // Column and offset indexes after the row groups, which carry the min/max of every page.
+    bool page_index = false;
+};
 
-// Saves the table using the specified compression algorithm, FP encoding and dictionary encoding.
-void runTest(const std::string &fileName,
-             const std::shared_ptr<arrow::Table> &table,
-             uint64_t original_size,
-             parquet::Compression::type compression,
-             parquet::Encoding::type encodingType,
-             int32_t compressionLevel,
-             size_t numRuns,
-             bool use_io,
-             TestResult &result)
+std::string getEncodingName(parquet::Encoding::type encodingType)
 {
-    std::string compression_name = arrow::util::Codec::GetCodecAsString(compression);
-    std::string encoding_name;
     switch(encodingType)
     {
         case parquet::Encoding::type::BYTE_STREAM_SPLIT:
-            encoding_name += "BYTE_STREAM_SPLIT";
-            break;
+            return "BYTE_STREAM_SPLIT";
         case parquet::Encoding::type::RLE_DICTIONARY:
-            encoding_name += "RLE_DICTIONARY";
-            break;
+            return "RLE_DICTIONARY";
         case parquet::Encoding::type::PLAIN:
-            encoding_name += "PLAIN";
-            break;
+            return "PLAIN";
         default:
             std::cerr << "We cannot have both dictionary and fp" << std::endl;
             exit(-1);
     }
+}
 
+// Builds the writer properties which apply the codec and encoding to all FP columns of the schema.
+// The row group size of the settings must already be resolved to a number of rows.
+std::shared_ptr<parquet::WriterProperties> buildWriterProperties(const std::shared_ptr<arrow::Schema> &schema,
+                                                                 parquet::Compression::type compression,
+                                                                 parquet::Encoding::type encodingType,
+                                                                 int32_t compressionLevel,
+                                                                 const WriterSettings &writer)
+{
     parquet::WriterProperties::Builder props_builder;
-    props_builder.data_pagesize(1024 * 1024 * 16);
+    props_builder.data_pagesize(writer.data_page_size);
+    props_builder.max_row_group_length(writer.row_group_size);
+    props_builder.dictionary_pagesize_limit(writer.dictionary_page_size);
+    props_builder.write_batch_size(writer.write_batch_size);
+    if (!writer.statistics)
+    {
+        props_builder.disable_statistics();
+    }
+#if ARROW_VERSION_MAJOR >= 12
+    // Set it either way, the default differs between Arrow versions.
+    if (writer.page_index)
+    {
+        props_builder.enable_write_page_index();
+    }
+    else
+    {
+        props_builder.disable_write_page_index();
+    }
+#else
+    if (writer.page_index)
+    {
+        std::cerr << "Writing the page index needs Arrow 12 or later." << std::endl;
+        exit(-1);
+    }
+#endif
 
-    const auto &schema = table->schema();
     const auto &fields = schema->fields();
     for (const auto &field : fields)
     {
@@ -170,6 +662,16 @@ void runTest(const std::string &fileName,
             }
             else
             {
+#if ARROW_VERSION_MAJOR < 16
+                // HALF_FLOAT columns are written as FIXED_LEN_BYTE_ARRAY, see toParquetTable.
+                if (field->type()->id() == arrow::Type::HALF_FLOAT &&
+                    encodingType == parquet::Encoding::type::BYTE_STREAM_SPLIT)
+                {
+                    std::cerr << "BYTE_STREAM_SPLIT of FIXED_LEN_BYTE_ARRAY needs Arrow 16 or later. "
+                              << "Use -fused or an experimental encoding for 2-byte values." << std::endl;
+                    exit(-1);
+                }
+#endif
                 props_builder.disable_dictionary(field->name());
                 props_builder.encoding(field->name(), encodingType);
             }
@@ -181,119 +683,486 @@ void runTest(const std::string &fileName,
     }
     props_builder.compression(compression);
 
-    auto props = props_builder.build();
-    double totalTime = .0;
-    double totalDecompressTime = .0;
-    int64_t sz;
-    std::shared_ptr<arrow::io::FileOutputStream> file_output_stream;
-    for (size_t i = 0; i < numRuns; ++i)
-    {
-        if (use_io) {
-            const std::string save_file_name = "/tmp/tmp_arrow_file.txt";
-            auto result = arrow::io::FileOutputStream::Open(save_file_name);
-            if (!result.ok()) {
-                std::cerr << "Couldn't create an output stream" << std::endl;
-                exit(-1);
-            }
-            std::shared_ptr<arrow::io::FileOutputStream> file_output_stream = *result;
-            arrow::Status status;
-            sync();
-            double t1 = gettime();
-            status = parquet::arrow::WriteTable(*table, ::arrow::default_memory_pool(),
-               file_output_stream, table->num_rows(), props);
-                file_output_stream->Flush();
-                file_output_stream->Close();
-            sync();
-            double t2 = gettime();
-            totalTime += (t2-t1);
-            if (!status.ok()) {
-                std::cerr << "Failed to write parquet: " << status.message() << std::endl;
-            }
-
-            std::unique_ptr<parquet::arrow::FileReader> reader;
-            parquet::arrow::FileReaderBuilder builder;
-
-            arrow::Result<std::shared_ptr<arrow::io::ReadableFile> > infile = arrow::io::ReadableFile::Open(
-                  save_file_name, arrow::default_memory_pool());
-            builder.Open(*infile);
-
-            // Clear caches
-            system("sudo /sbin/sysctl -w vm.drop_caches=3 > /dev/null");
+    return props_builder.build();
+}
 
-            builder.properties(parquet::default_arrow_reader_properties())->Build(&reader);
-            t1 = gettime();
-            std::shared_ptr<arrow::Table> out;
-            status = reader->ReadTable(&out);
-            t2 = gettime();
-            totalDecompressTime += (t2-t1);
-            if (!status.ok()) {
-                std::cerr << "Failed to read parquet " << status.message() << std::endl;
-            }
-            if (!table->Equals(*out, false)) {
-                std::cerr << "Table after decompression differs" << std::endl;
-            }
+// Reader properties, see -use_threads and the following options.
+struct ReaderSettings
+{
+    // Decode the columns in parallel on Arrow's CPU thread pool.
+    bool use_threads = false;
+    // Coalesce the reads of the column chunks and issue them up-front on the I/O thread pool.
+    bool pre_buffer = false;
+    int64_t batch_size = parquet::kArrowDefaultBatchSize;
+    // Capacity of the CPU thread pool. 0 keeps Arrow's default of one thread per core.
+    int64_t cpu_threads = 0;
+    // Capacity of the I/O thread pool, set once for the process. 0 keeps Arrow's default.
+    int64_t io_threads = 0;
+    // Names of the columns to read. All columns are read if it is empty.
+    std::vector<std::string> columns;
+    // Indices of the row groups to read. All row groups are read if it is empty.
+    std::vector<int> row_groups;
+    // Read a random sample of this many columns or row groups instead, if it is not 0.
+    int64_t sample_columns = 0;
+    int64_t sample_row_groups = 0;
+    // Read every column on its own, as a query engine fetches the columns it needs.
+    bool per_column = false;
+};
 
-            std::ifstream in(save_file_name, std::ifstream::ate | std::ifstream::binary);
-            sz = in.tellg();
+// The samples are drawn with a fixed seed, so every job reads the same columns and row groups.
+const unsigned kSampleSeed = 1337;
 
-        } else {
-            auto result =
-                arrow::io::BufferOutputStream::Create(1024 * 1024 * 1024, ::arrow::default_memory_pool());
-            auto ok = result.ok();
-            if (!ok) {
-                std::cerr << "Couldn't create an output stream" << std::endl;
-                exit(-1);
-            }
-            std::shared_ptr<arrow::io::BufferOutputStream> buf_output_stream = *result;
-            arrow::Status status;
-            double t1 = gettime();
-            status = parquet::arrow::WriteTable(*table, ::arrow::default_memory_pool(),
-               buf_output_stream, table->num_rows(), props);
-            double t2 = gettime();
-            totalTime += (t2-t1);
-            if (!status.ok()) {
-                std::cerr << "Failed to write parquet" << status.message() << std::endl;
-            }
+std::vector<int> sampleIndices(int num_indices, int64_t sample_size)
+{
+    std::vector<int> indices(num_indices);
+    std::iota(indices.begin(), indices.end(), 0);
+    if (sample_size > 0 && sample_size < num_indices)
+    {
+        std::mt19937 generator(kSampleSeed);
+        std::shuffle(indices.begin(), indices.end(), generator);
+        indices.resize(sample_size);
+        std::sort(indices.begin(), indices.end());
+    }
+    return indices;
+}
 
-            arrow::Result<std::shared_ptr<arrow::Buffer> > buffer = buf_output_stream->Finish();
-            std::unique_ptr<parquet::arrow::FileReader> reader;
-            parquet::arrow::FileReaderBuilder builder;
-            builder.Open(std::make_shared<arrow::io::BufferReader>(*buffer));
-            builder.properties(parquet::default_arrow_reader_properties())->Build(&reader);
-            t1 = gettime();
-            std::shared_ptr<arrow::Table> out;
-            status = reader->ReadTable(&out);
-            t2 = gettime();
-            totalDecompressTime += (t2-t1);
-            if (!status.ok()) {
-                std::cerr << "Failed to read parquet " << status.message() << std::endl;
-            }
-            if (!table->Equals(*out, false)) {
-                std::cerr << "Table after decompression differs" << std::endl;
-            }
+parquet::ArrowReaderProperties buildReaderProperties(const ReaderSettings &reader)
+{
+    parquet::ArrowReaderProperties props = parquet::default_arrow_reader_properties();
+    props.set_use_threads(reader.use_threads);
+    props.set_batch_size(reader.batch_size);
+#if ARROW_VERSION_MAJOR >= 3
+    props.set_pre_buffer(reader.pre_buffer);
+#else
+    if (reader.pre_buffer)
+    {
+        std::cerr << "-pre_buffer needs Arrow 3 or later" << std::endl;
+        exit(-1);
+    }
+#endif
+    // The CPU thread pool is shared by the process, so it is resized before every read.
+    if (reader.use_threads && reader.cpu_threads > 0)
+    {
+        PARQUET_THROW_NOT_OK(arrow::SetCpuThreadPoolCapacity(reader.cpu_threads));
+    }
+    return props;
+}
 
-            arrow::Result<int64_t> res_sz = buf_output_stream->Tell();
-            sz = *res_sz;
+// Indices of the projected columns, or of all columns if there is no projection.
+std::vector<int> projectColumns(const arrow::Schema &schema, const ReaderSettings &reader)
+{
+    std::vector<int> indices;
+    if (reader.columns.empty())
+    {
+        return sampleIndices(schema.num_fields(), reader.sample_columns);
+    }
+    for (const std::string &name : reader.columns)
+    {
+        const int index = schema.GetFieldIndex(name);
+        if (index < 0)
+        {
+            std::cerr << "There is no column " << name << std::endl;
+            exit(-1);
         }
+        indices.push_back(index);
     }
-    double avg_compress_time = totalTime / numRuns;
-    double avg_decompress_time = totalDecompressTime / numRuns;
-    unsigned long compress_mbs = (sz / (1024 * 1024)) / avg_compress_time;
-    unsigned long decompress_mbs = (sz / (1024 * 1024)) / avg_decompress_time;
-    //std::cout << newName << ": " << avg_compress_time << " " << avg_decompress_time << " " << sz << " " << compress_mbs << " " << decompress_mbs << std::endl;
-    char *tmp_file_name = strdup(fileName.c_str());
-    result.file_name = std::string(basename(tmp_file_name));
-    free(tmp_file_name);
-    result.original_size = original_size;
-    result.compressed_size = sz;
-    result.compression_name = compression_name;
-    result.encoding_name = encoding_name;
-    result.compression_level = compressionLevel;
-    result.write_time_in_s = avg_compress_time;
-    result.read_time_in_s = avg_decompress_time;
+    return indices;
 }
 
-void printHelp()
+// Row groups to read: the given ones, a random sample, or all of them.
+std::vector<int> selectRowGroups(int num_row_groups, const ReaderSettings &reader)
+{
+    if (reader.row_groups.empty())
+    {
+        return sampleIndices(num_row_groups, reader.sample_row_groups);
+    }
+    for (const int row_group : reader.row_groups)
+    {
+        if (row_group >= num_row_groups)
+        {
+            std::cerr << "There is no row group " << row_group << ", the file has " << num_row_groups << std::endl;
+            exit(-1);
+        }
+    }
+    return reader.row_groups;
+}
+
+// The rows of the table which the row groups hold.
+std::shared_ptr<arrow::Table> selectRowGroupRows(const std::shared_ptr<arrow::Table> &table,
+                                                 const parquet::FileMetaData &metadata,
+                                                 const std::vector<int> &row_groups)
+{
+    std::vector<int64_t> offsets(metadata.num_row_groups() + 1, 0);
+    for (int i = 0; i < metadata.num_row_groups(); ++i)
+    {
+        offsets[i + 1] = offsets[i] + metadata.RowGroup(i)->num_rows();
+    }
+    std::vector<std::shared_ptr<arrow::Table> > slices;
+    for (const int row_group : row_groups)
+    {
+        slices.push_back(table->Slice(offsets[row_group], offsets[row_group + 1] - offsets[row_group]));
+    }
+    std::shared_ptr<arrow::Table> rows;
+    PARQUET_ASSIGN_OR_THROW(rows, arrow::ConcatenateTables(slices));
+    return rows;
+}
+
+// Reads the projected columns of the row groups with ReadTable or ReadRowGroups, or column by
+// column with ReadColumn or the column readers of the row groups. The schema is the projected one.
+arrow::Status readSelection(parquet::arrow::FileReader &reader,
+                            const std::shared_ptr<arrow::Schema> &schema,
+                            const std::vector<int> &column_indices,
+                            const std::vector<int> &row_groups,
+                            bool per_column,
+                            std::shared_ptr<arrow::Table> *out)
+{
+    // ReadTable returns the row groups in file order, so it only applies to exactly 0, 1, ..., n - 1.
+    bool all_row_groups = (int)row_groups.size() == reader.num_row_groups();
+    for (size_t i = 0; all_row_groups && i < row_groups.size(); ++i)
+    {
+        all_row_groups = row_groups[i] == (int)i;
+    }
+    if (!per_column)
+    {
+        return all_row_groups ? reader.ReadTable(column_indices, out)
+                              : reader.ReadRowGroups(row_groups, column_indices, out);
+    }
+    std::vector<std::shared_ptr<arrow::ChunkedArray> > columns;
+    for (size_t i = 0; i < column_indices.size(); ++i)
+    {
+        std::shared_ptr<arrow::ChunkedArray> column;
+        if (all_row_groups)
+        {
+            ARROW_RETURN_NOT_OK(reader.ReadColumn(column_indices[i], &column));
+        }
+        else
+        {
+            arrow::ArrayVector chunks;
+            for (const int row_group : row_groups)
+            {
+                std::shared_ptr<arrow::ChunkedArray> part;
+                ARROW_RETURN_NOT_OK(reader.RowGroup(row_group)->Column(column_indices[i])->Read(&part));
+                chunks.insert(chunks.end(), part->chunks().begin(), part->chunks().end());
+            }
+            column = std::make_shared<arrow::ChunkedArray>(chunks, schema->field(i)->type());
+        }
+        columns.push_back(column);
+    }
+    *out = arrow::Table::Make(schema, columns);
+    return arrow::Status::OK();
+}
+
+std::shared_ptr<arrow::Table> selectColumns(const std::shared_ptr<arrow::Table> &table, const std::vector<int> &indices)
+{
+    std::vector<std::shared_ptr<arrow::Field> > fields;
+    std::vector<std::shared_ptr<arrow::ChunkedArray> > columns;
+    for (const int index : indices)
+    {
+        fields.push_back(table->schema()->field(index));
+        columns.push_back(table->column(index));
+    }
+    return arrow::Table::Make(arrow::schema(fields), columns, table->num_rows());
+}
+
+// Parquet has no HALF_FLOAT type, so the 2-byte values are written as FIXED_LEN_BYTE_ARRAY
+// columns of the same name. The arrays are views of the same buffers, no copy is made.
+std::shared_ptr<arrow::Schema> toParquetSchema(const std::shared_ptr<arrow::Schema> &schema)
+{
+    std::vector<std::shared_ptr<arrow::Field> > fields;
+    for (const auto &field : schema->fields())
+    {
+        if (field->type()->id() == arrow::Type::HALF_FLOAT)
+        {
+            fields.push_back(field->WithType(arrow::fixed_size_binary(2)));
+        }
+        else
+        {
+            fields.push_back(field);
+        }
+    }
+    return arrow::schema(fields, schema->metadata());
+}
+
+std::shared_ptr<arrow::Table> toParquetTable(const std::shared_ptr<arrow::Table> &table)
+{
+    std::shared_ptr<arrow::Schema> schema = toParquetSchema(table->schema());
+    std::vector<std::shared_ptr<arrow::ChunkedArray> > columns;
+    for (int i = 0; i < table->num_columns(); ++i)
+    {
+        const auto &column = table->column(i);
+        if (column->type()->id() != arrow::Type::HALF_FLOAT)
+        {
+            columns.push_back(column);
+            continue;
+        }
+        arrow::ArrayVector chunks;
+        for (const auto &chunk : column->chunks())
+        {
+            std::shared_ptr<arrow::ArrayData> data = chunk->data()->Copy();
+            data->type = schema->field(i)->type();
+            chunks.push_back(arrow::MakeArray(data));
+        }
+        columns.push_back(std::make_shared<arrow::ChunkedArray>(chunks, schema->field(i)->type()));
+    }
+    return arrow::Table::Make(schema, columns, table->num_rows());
+}
+
+std::string getBaseName(const std::string &fileName)
+{
+    char *tmp_file_name = strdup(fileName.c_str());
+    std::string base_name(basename(tmp_file_name));
+    free(tmp_file_name);
+    return base_name;
+}
+
+void setReaderResult(const ReaderSettings &reader, size_t columns_read, size_t row_groups_read, TestResult &result)
+{
+    if (reader.use_threads) {
+        result.read_threads = reader.cpu_threads > 0 ? reader.cpu_threads : arrow::GetCpuThreadPoolCapacity();
+    }
+    result.pre_buffer = reader.pre_buffer;
+    result.batch_size = reader.batch_size;
+    result.io_threads = reader.io_threads;
+    result.columns_read = columns_read;
+    result.row_groups_read = row_groups_read;
+}
+
+// Keeps the times of a run unless it is one of the first numWarmupRuns, which only warm up the
+// caches and the allocator. Returns whether the run was kept.
+bool recordRun(size_t run, size_t numWarmupRuns, double write_time, double read_time, TestResult &result)
+{
+    if (run < numWarmupRuns) {
+        return false;
+    }
+    result.write_times_in_s.push_back(write_time);
+    result.read_times_in_s.push_back(read_time);
+    return true;
+}
+
+// Sets the fields which every mode reports, with the mean times of the recorded runs.
+// writer is NULL for the modes which do not go through the Parquet writer.
+void setResult(const std::string &fileName,
+               const std::string &compression_name,
+               const std::string &encoding_name,
+               int32_t compressionLevel,
+               uint64_t logical_size,
+               uint64_t compressed_size,
+               uint64_t bytes_read,
+               const WriterSettings *writer,
+               TestResult &result)
+{
+    result.file_name = getBaseName(fileName);
+    result.logical_size = logical_size;
+    result.read_logical_size = logical_size;
+    result.compressed_size = compressed_size;
+    result.bytes_read = bytes_read;
+    result.compression_name = compression_name;
+    result.encoding_name = encoding_name;
+    result.compression_level = compressionLevel;
+    result.write_time_in_s = computeStatistics(result.write_times_in_s).mean;
+    result.read_time_in_s = computeStatistics(result.read_times_in_s).mean;
+    if (writer != NULL) {
+        result.data_page_size = writer->data_page_size;
+        result.row_group_size = writer->row_group_size;
+        result.dictionary_page_size = writer->dictionary_page_size;
+        result.write_batch_size = writer->write_batch_size;
+        result.statistics = writer->statistics;
+        result.page_index = writer->page_index;
+    }
+}
+
+// Saves the table using the specified compression algorithm, FP encoding and dictionary encoding.
+void runTest(const std::string &fileName,
+             const std::shared_ptr<arrow::Table> &table,
+             uint64_t logical_size,
+             parquet::Compression::type compression,
+             parquet::Encoding::type encodingType,
+             int32_t compressionLevel,
+             const WriterSettings &writerSettings,
+             const ReaderSettings &readerSettings,
+             size_t numRuns,
+             size_t numWarmupRuns,
+             bool use_io,
+             bool use_perf_counters,
+             size_t worker_id,
+             TestResult &result)
+{
+    std::string compression_name = arrow::util::Codec::GetCodecAsString(compression);
+    std::string encoding_name = getEncodingName(encodingType);
+    WriterSettings writer = writerSettings;
+    if (writer.row_group_size == 0) {
+        writer.row_group_size = std::max<int64_t>(1, table->num_rows());
+    }
+    auto props = buildWriterProperties(table->schema(), compression, encodingType, compressionLevel, writer);
+    const std::shared_ptr<arrow::Table> parquet_table = toParquetTable(table);
+    const std::vector<int> column_indices = projectColumns(*parquet_table->schema(), readerSettings);
+    const std::shared_ptr<arrow::Table> projected_table = selectColumns(parquet_table, column_indices);
+    std::vector<int> row_groups;
+    int64_t sz = 0;
+    uint64_t bytes_read = 0;
+    uint64_t read_logical_size = logical_size;
+    std::shared_ptr<arrow::io::FileOutputStream> file_output_stream;
+    result.write_times_in_s.clear();
+    result.read_times_in_s.clear();
+    // The counters follow the worker thread, so the threads of Arrow are not counted.
+    PerfCounters perf_counters;
+    if (use_perf_counters && !perf_counters_open(&perf_counters)) {
+        use_perf_counters = false;
+    }
+    perf_counters_clear(&result.write_counters);
+    perf_counters_clear(&result.read_counters);
+    PerfCounterValues write_counters;
+    PerfCounterValues read_counters;
+    for (size_t i = 0; i < numWarmupRuns + numRuns; ++i)
+    {
+        double write_time = .0;
+        double read_time = .0;
+        perf_counters_clear(&write_counters);
+        perf_counters_clear(&read_counters);
+        if (use_io) {
+            // Each worker gets its own file so that concurrent jobs do not clobber each other.
+            const std::string save_file_name = "/tmp/tmp_arrow_file_" + std::to_string(worker_id) + ".txt";
+            auto result = arrow::io::FileOutputStream::Open(save_file_name);
+            if (!result.ok()) {
+                std::cerr << "Couldn't create an output stream" << std::endl;
+                exit(-1);
+            }
+            std::shared_ptr<arrow::io::FileOutputStream> file_output_stream = *result;
+            arrow::Status status;
+            sync();
+            double t1 = gettime();
+            if (use_perf_counters) {
+                perf_counters_start(&perf_counters);
+            }
+            status = parquet::arrow::WriteTable(*parquet_table, ::arrow::default_memory_pool(),
+               file_output_stream, writer.row_group_size, props);
+            if (use_perf_counters) {
+                perf_counters_stop(&perf_counters, &write_counters);
+            }
+                file_output_stream->Flush();
+                file_output_stream->Close();
+            sync();
+            double t2 = gettime();
+            write_time += (t2-t1);
+            if (!status.ok()) {
+                std::cerr << "Failed to write parquet: " << status.message() << std::endl;
+            }
+
+            std::unique_ptr<parquet::arrow::FileReader> reader;
+            parquet::arrow::FileReaderBuilder builder;
+
+            arrow::Result<std::shared_ptr<arrow::io::ReadableFile> > infile = arrow::io::ReadableFile::Open(
+                  save_file_name, arrow::default_memory_pool());
+            auto counting_file = std::make_shared<CountingRandomAccessFile>(*infile);
+            builder.Open(counting_file);
+
+            // Clear caches
+            system("sudo /sbin/sysctl -w vm.drop_caches=3 > /dev/null");
+
+            builder.properties(buildReaderProperties(readerSettings))->Build(&reader);
+            row_groups = selectRowGroups(reader->num_row_groups(), readerSettings);
+            t1 = gettime();
+            std::shared_ptr<arrow::Table> out;
+            if (use_perf_counters) {
+                perf_counters_start(&perf_counters);
+            }
+            status = readSelection(*reader, projected_table->schema(), column_indices, row_groups,
+                                   readerSettings.per_column, &out);
+            if (use_perf_counters) {
+                perf_counters_stop(&perf_counters, &read_counters);
+            }
+            t2 = gettime();
+            read_time += (t2-t1);
+            if (!status.ok()) {
+                std::cerr << "Failed to read parquet " << status.message() << std::endl;
+            }
+            if (!selectRowGroupRows(projected_table, *reader->parquet_reader()->metadata(), row_groups)->Equals(*out, false)) {
+                std::cerr << "Table after decompression differs" << std::endl;
+            }
+
+            std::ifstream in(save_file_name, std::ifstream::ate | std::ifstream::binary);
+            sz = in.tellg();
+            bytes_read = counting_file->bytes_read();
+            read_logical_size = getReadLogicalSize(*reader->parquet_reader()->metadata(), column_indices, row_groups,
+                                                   logical_size);
+
+        } else {
+            auto result =
+                arrow::io::BufferOutputStream::Create(1024 * 1024 * 1024, ::arrow::default_memory_pool());
+            auto ok = result.ok();
+            if (!ok) {
+                std::cerr << "Couldn't create an output stream" << std::endl;
+                exit(-1);
+            }
+            std::shared_ptr<arrow::io::BufferOutputStream> buf_output_stream = *result;
+            arrow::Status status;
+            double t1 = gettime();
+            if (use_perf_counters) {
+                perf_counters_start(&perf_counters);
+            }
+            status = parquet::arrow::WriteTable(*parquet_table, ::arrow::default_memory_pool(),
+               buf_output_stream, writer.row_group_size, props);
+            if (use_perf_counters) {
+                perf_counters_stop(&perf_counters, &write_counters);
+            }
+            double t2 = gettime();
+            write_time += (t2-t1);
+            if (!status.ok()) {
+                std::cerr << "Failed to write parquet" << status.message() << std::endl;
+            }
+
+            arrow::Result<std::shared_ptr<arrow::Buffer> > buffer = buf_output_stream->Finish();
+            std::unique_ptr<parquet::arrow::FileReader> reader;
+            parquet::arrow::FileReaderBuilder builder;
+            auto counting_file = std::make_shared<CountingRandomAccessFile>(
+                std::make_shared<arrow::io::BufferReader>(*buffer));
+            builder.Open(counting_file);
+            builder.properties(buildReaderProperties(readerSettings))->Build(&reader);
+            row_groups = selectRowGroups(reader->num_row_groups(), readerSettings);
+            t1 = gettime();
+            std::shared_ptr<arrow::Table> out;
+            if (use_perf_counters) {
+                perf_counters_start(&perf_counters);
+            }
+            status = readSelection(*reader, projected_table->schema(), column_indices, row_groups,
+                                   readerSettings.per_column, &out);
+            if (use_perf_counters) {
+                perf_counters_stop(&perf_counters, &read_counters);
+            }
+            t2 = gettime();
+            read_time += (t2-t1);
+            if (!status.ok()) {
+                std::cerr << "Failed to read parquet " << status.message() << std::endl;
+            }
+            if (!selectRowGroupRows(projected_table, *reader->parquet_reader()->metadata(), row_groups)->Equals(*out, false)) {
+                std::cerr << "Table after decompression differs" << std::endl;
+            }
+
+            arrow::Result<int64_t> res_sz = buf_output_stream->Tell();
+            sz = *res_sz;
+            bytes_read = counting_file->bytes_read();
+            read_logical_size = getReadLogicalSize(*reader->parquet_reader()->metadata(), column_indices, row_groups,
+                                                   logical_size);
+        }
+        if (recordRun(i, numWarmupRuns, write_time, read_time, result)) {
+            for (size_t e = 0; e < PerfNumEvents; ++e) {
+                result.write_counters.counts[e] += write_counters.counts[e];
+                result.write_counters.is_valid[e] = result.write_counters.is_valid[e] || write_counters.is_valid[e];
+                result.read_counters.counts[e] += read_counters.counts[e];
+                result.read_counters.is_valid[e] = result.read_counters.is_valid[e] || read_counters.is_valid[e];
+            }
+        }
+    }
+    if (use_perf_counters) {
+        perf_counters_close(&perf_counters);
+    }
+    setResult(fileName, compression_name, encoding_name, compressionLevel, logical_size, sz, bytes_read,
+              &writer, result);
+    result.read_logical_size = read_logical_size;
+    setReaderResult(readerSettings, column_indices.size(), row_groups.size(), result);
+}
+
+void printHelp()
 {
     std::cout << "Run as:" << std::endl;
     std::cout << "parquet_test [OPTION] ..." << std::endl;
@@ -303,19 +1172,136 @@ void printHelp()
     std::cout << "  " << "Reads the specifial file as a parquet file." << std::endl;
     std::cout << std::endl;
     std::cout << " " << "-b [FILE] ..." << std::endl;
-    std::cout << "  " << "Read a raw binary file of FP32 or FP64 values." << std::endl;
+    std::cout << "  " << "Read a raw binary file of FP16, BF16, FP32 or FP64 values." << std::endl;
     std::cout << "  " << "For FP32, the file extension should be .sp." << std::endl;
     std::cout << "  " << "For FP64, the file extension should be .dp." << std::endl;
+    std::cout << "  " << "For FP16 and BF16, the file extension should be .hp and .bf. Both are loaded as" << std::endl;
+    std::cout << "  " << "HALF_FLOAT columns, which Parquet stores as FIXED_LEN_BYTE_ARRAY." << std::endl;
     std::cout << " " << "-c [CODEC],[ENCODING],[COMPRESSION_LEVEL] ..." << std::endl;
     std::cout << "  " << "CODEC must be one of the following:" << std::endl;
     std::cout << "   " << "zstd, gzip, snappy, lz4, zfp, uncompressed" << std::endl;
     std::cout << "  " << "ENCODING must be one of the following:" << std::endl;
     std::cout << "   " << "plain, dictionary, byte_stream_split" << std::endl;
+    std::cout << "  " << "or one of the following experimental encodings, which are measured on the raw FP values" << std::endl;
+    std::cout << "  " << "in memory without Parquet:" << std::endl;
+    std::cout << "   " << "byte_stream_split_per_stream: every byte stream is stored raw, compressed with" << std::endl;
+    std::cout << "   " << "the codec at COMPRESSION_LEVEL or at a high level, depending on its entropy." << std::endl;
+    std::cout << "   " << "byte_stream_split_xor: every value is XORed with its predecessor before the split." << std::endl;
+    std::cout << "   " << "byte_stream_split_sub: the bits of the predecessor are subtracted as an integer before the split." << std::endl;
+    std::cout << "   " << "Both compress the split values of a column as a whole with the codec." << std::endl;
+    std::cout << "   " << "adaptive_byte_stream_split: every block of K values is split or kept plain, depending on" << std::endl;
+    std::cout << "   " << "whether its values repeat as a whole. The column is compressed as a whole with the codec." << std::endl;
     std::cout << "  " << "COMPRESSION_LEVEL depends on the codec being used." << std::endl;
     std::cout << "  " << "Pass -1 if you want to use the default compression level." << std::endl;
     std::cout << std::endl;
+    std::cout << " " << "-k K ..." << std::endl;
+    std::cout << "  " << "Block sizes in values of adaptive_byte_stream_split. Every adaptive job is run" << std::endl;
+    std::cout << "  " << "once per block size. The default sweep is 256 1024 4096 16384 65536." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-page_size BYTES ..." << std::endl;
+    std::cout << " " << "-row_group_size ROWS ..." << std::endl;
+    std::cout << " " << "-dictionary_page_size BYTES ..." << std::endl;
+    std::cout << " " << "-write_batch_size VALUES ..." << std::endl;
+    std::cout << "  " << "Sweep the data page size (default 16 MiB), the rows per row group (default all rows of" << std::endl;
+    std::cout << "  " << "the table or of a -stream chunk), the dictionary page size limit (default 1 MiB) and" << std::endl;
+    std::cout << "  " << "the write batch size (default 1024). Every job of -c is run once per combination." << std::endl;
+    std::cout << "  " << "The settings are part of the json and csv results. text prints them on an extra line." << std::endl;
+    std::cout << "  " << "-mode codec uses all of them but the row group size." << std::endl;
+    std::cout << " " << "-no_statistics" << std::endl;
+    std::cout << "  " << "Write no min/max statistics, neither for the column chunks nor in the data page headers." << std::endl;
+    std::cout << " " << "-page_index" << std::endl;
+    std::cout << "  " << "Write the column and offset indexes, which hold the min/max of every page. Needs Arrow 12." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-use_threads" << std::endl;
+    std::cout << "  " << "Decode the columns in parallel on Arrow's CPU thread pool. Needs -j 1." << std::endl;
+    std::cout << " " << "-read_threads N ..." << std::endl;
+    std::cout << "  " << "Sweep the threads of the CPU pool, implies -use_threads. Needs -j 1." << std::endl;
+    std::cout << " " << "-pre_buffer" << std::endl;
+    std::cout << "  " << "Coalesce the reads of the column chunks and issue them up-front on the I/O thread pool." << std::endl;
+    std::cout << "  " << "Needs -j 1." << std::endl;
+    std::cout << " " << "-io_threads N" << std::endl;
+    std::cout << "  " << "Threads of the I/O pool, which -pre_buffer uses." << std::endl;
+    std::cout << " " << "-batch_size N" << std::endl;
+    std::cout << "  " << "Rows per record batch of the reader, default 65536." << std::endl;
+    std::cout << " " << "-read_columns NAME ..." << std::endl;
+    std::cout << "  " << "Read only the given columns." << std::endl;
+    std::cout << "  " << "With -read_columns, -read_row_groups and the sampling options the read speeds refer to" << std::endl;
+    std::cout << "  " << "read_logical_size, the share of the logical size in the column chunks read." << std::endl;
+    std::cout << " " << "-read_row_groups INDEX ..." << std::endl;
+    std::cout << "  " << "Read only the given row groups with ReadRowGroups. Combine with -row_group_size." << std::endl;
+    std::cout << " " << "-sample_columns N" << std::endl;
+    std::cout << " " << "-sample_row_groups N" << std::endl;
+    std::cout << "  " << "Read a random sample of N columns or row groups. The seed is fixed, so all jobs read the same." << std::endl;
+    std::cout << " " << "-read_per_column" << std::endl;
+    std::cout << "  " << "Read every column on its own with ReadColumn, or with the column readers of the row groups." << std::endl;
+    std::cout << "  " << "The bytes read from the file, including the footer, are printed as bytes_read." << std::endl;
+    std::cout << "  " << "The reader settings are part of the json and csv results. text prints them on an extra line." << std::endl;
+    std::cout << std::endl;
     std::cout << " " << "-r K" << std::endl;
     std::cout << "  " << "Run the compression/decompression K times." << std::endl;
+    std::cout << "  " << "Besides the mean speed, min, median, p95 and stddev of the times are printed." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-warmup K" << std::endl;
+    std::cout << "  " << "Run K additional warm-up rounds first and discard their timings." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-io" << std::endl;
+    std::cout << "  " << "Write to and read from a file on disk instead of memory." << std::endl;
+    std::cout << "  " << "The page cache is dropped before every read, which requires sudo rights." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-format text|json|csv" << std::endl;
+    std::cout << "  " << "text prints one space-separated line per result (default)." << std::endl;
+    std::cout << "  " << "json prints one JSON object per line and csv prints a header and one row per result." << std::endl;
+    std::cout << "  " << "Both include the per-run samples, the writer configuration, the host, CPU model and Arrow version." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-perf" << std::endl;
+    std::cout << "  " << "Count cycles, instructions, L1D and LLC misses of WriteTable and ReadTable with perf_event_open." << std::endl;
+    std::cout << "  " << "Only the worker thread is counted, so it cannot be combined with -use_threads, -read_threads" << std::endl;
+    std::cout << "  " << "or -pre_buffer, which decode and read on Arrow's thread pools." << std::endl;
+    std::cout << "  " << "text prints them on two extra lines per result, json as write_counters and read_counters." << std::endl;
+    std::cout << "  " << "Nothing is printed if the host does not provide the counters, e.g. in a container." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-j N" << std::endl;
+    std::cout << "  " << "Run the (file, codec) jobs on N worker threads. All files are loaded up-front." << std::endl;
+    std::cout << "  " << "Results are still printed in the order of the serial run." << std::endl;
+    std::cout << "  " << "-io needs -j 1, as every worker would drop the page cache of all other workers." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-pin" << std::endl;
+    std::cout << "  " << "Pin worker K to core K modulo the number of cores." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-stream ROWS" << std::endl;
+    std::cout << "  " << "Stream the input through the writer in row groups of ROWS values" << std::endl;
+    std::cout << "  " << "(or one row group per input row group for Parquet files) to a file on disk" << std::endl;
+    std::cout << "  " << "and read it back batch by batch. The peak memory in bytes is printed last." << std::endl;
+    std::cout << "  " << "Every batch is compared with the input, which is not part of the read time." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-advise" << std::endl;
+    std::cout << "  " << "Do not run the benchmark. Estimate the entropy of every FP column instead and predict" << std::endl;
+    std::cout << "  " << "the best CODEC,ENCODING,COMPRESSION_LEVEL for it. Prints per column:" << std::endl;
+    std::cout << "  " << "file column advice predicted_ratio distinct_values value_entropy split_entropy" << std::endl;
+    std::cout << "  " << "xor_split_entropy stream_entropies xor_stream_entropies" << std::endl;
+    std::cout << "  " << "The entropies are order-0 estimates in bits per value from a sample of up to 1M values." << std::endl;
+    std::cout << "  " << "split is BYTE_STREAM_SPLIT and xor_split is BYTE_STREAM_SPLIT of the XOR of adjacent values." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-fused" << std::endl;
+    std::cout << "  " << "Skip Parquet and benchmark BYTE_STREAM_SPLIT plus the codec on the raw FP values." << std::endl;
+    std::cout << "  " << "Every job prints two results: BYTE_STREAM_SPLIT splits into a full-size buffer and" << std::endl;
+    std::cout << "  " << "then compresses it, BYTE_STREAM_SPLIT_FUSED splits 128 KiB tiles and feeds every" << std::endl;
+    std::cout << "  " << "stream to its own streaming compressor. The ENCODING of -c is ignored." << std::endl;
+    std::cout << "  " << "CODEC must be zstd, gzip or lz4. lz4 uses the LZ4 frame format." << std::endl;
+    std::cout << std::endl;
+    std::cout << " " << "-mode parquet|codec|pushdown" << std::endl;
+    std::cout << "  " << "parquet times WriteTable and ReadTable (default). codec skips the Arrow to Parquet" << std::endl;
+    std::cout << "  " << "conversion and runs the Parquet encoder and the codec of -c directly on pages of the" << std::endl;
+    std::cout << "  " << "FLOAT and DOUBLE values. The stage times are printed after every result: encode, compress," << std::endl;
+    std::cout << "  " << "decompress, decode and the codec alone on the raw values, codec_only_(de)compress." << std::endl;
+    std::cout << "  " << "pushdown writes the file like parquet and counts the FLOAT and DOUBLE values within" << std::endl;
+    std::cout << "  " << "-range twice: a full scan decodes every page, the timed read skips the column chunks and" << std::endl;
+    std::cout << "  " << "data pages whose min/max rule the range out, from the page index if written, else from the" << std::endl;
+    std::cout << "  " << "page headers. Needs Arrow 12. -read_columns restricts the scanned columns. The stage times" << std::endl;
+    std::cout << "  " << "full_scan and pushdown and the counts of pages, pages_skipped, column_chunks_skipped and" << std::endl;
+    std::cout << "  " << "matches are printed after every result." << std::endl;
+    std::cout << " " << "-range LOW HIGH" << std::endl;
+    std::cout << "  " << "The predicate LOW <= value <= HIGH of -mode pushdown." << std::endl;
     std::cout << std::endl;
     std::cout << "Example runs:" << std::endl;
     std::cout << "  " << "parquet_test -p file.parquet -c zstd,plain,6 gzip,dictionary,-1" << std::endl;
@@ -328,80 +1314,1944 @@ void printHelp()
     std::cout << "   " << "is the default on." << std::endl;
 }
 
-void handleInvalidArg()
+void handleInvalidArg()
+{
+    std::cout << "Invalid arguments" << std::endl;
+    printHelp();
+    exit(-1);
+}
+
+// Parses the positive numbers following the option at argv[i]. Returns the index of the last one.
+int parseSweepValues(int argc, char *argv[], int i, std::vector<int64_t> &values)
+{
+    int j = i + 1;
+    for (; j < argc && argv[j][0] != '-'; ++j) {
+        const int64_t value = strtoll(argv[j], NULL, 10);
+        if (value <= 0) {
+            handleInvalidArg();
+        }
+        values.push_back(value);
+    }
+    if (j == i + 1) {
+        handleInvalidArg();
+    }
+    return j - 1;
+}
+
+parquet::Compression::type GetCompressionTypeFromString(const char *compressionName)
+{
+    if (strcmp(compressionName, "gzip") == 0)
+    {
+        return parquet::Compression::GZIP;
+    }
+    else if (strcmp(compressionName, "zstd") == 0)
+    {
+        return parquet::Compression::ZSTD;
+    }
+    else if (strcmp(compressionName, "snappy") == 0)
+    {
+        return parquet::Compression::SNAPPY;
+    }
+    else if (strcmp(compressionName, "lz4") == 0)
+    {
+        return parquet::Compression::LZ4;
+    }
+    else if (strcmp(compressionName, "uncompressed") == 0)
+    {
+        return parquet::Compression::UNCOMPRESSED;
+    }
+    else
+    {
+        handleInvalidArg();
+    }
+}
+
+parquet::Encoding::type GetEncodingTypeFromString(const char *encodingName)
+{
+    if (strcmp(encodingName, "plain") == 0)
+    {
+        return parquet::Encoding::type::PLAIN;
+    }
+    else if (strcmp(encodingName, "dictionary") == 0)
+    {
+        return parquet::Encoding::type::RLE_DICTIONARY;
+    }
+    else if (strcmp(encodingName, "byte_stream_split") == 0)
+    {
+        return parquet::Encoding::type::BYTE_STREAM_SPLIT;
+    }
+    else
+    {
+        handleInvalidArg();
+    }
+}
+
+// Encodings which Parquet does not offer. They are benchmarked on the raw FP values, without Parquet.
+enum class ExperimentalEncoding
+{
+    None,
+    // BYTE_STREAM_SPLIT where every stream gets its own codec decision.
+    PerStreamCodec,
+    // BYTE_STREAM_SPLIT of the XOR of adjacent values.
+    XorDelta,
+    // BYTE_STREAM_SPLIT of the integer difference of adjacent values.
+    SubDelta,
+    // Every block of K values is either split or kept PLAIN.
+    Adaptive
+};
+
+ExperimentalEncoding GetExperimentalEncodingFromString(const char *encodingName)
+{
+    if (strcmp(encodingName, "byte_stream_split_per_stream") == 0)
+    {
+        return ExperimentalEncoding::PerStreamCodec;
+    }
+    else if (strcmp(encodingName, "byte_stream_split_xor") == 0)
+    {
+        return ExperimentalEncoding::XorDelta;
+    }
+    else if (strcmp(encodingName, "byte_stream_split_sub") == 0)
+    {
+        return ExperimentalEncoding::SubDelta;
+    }
+    else if (strcmp(encodingName, "adaptive_byte_stream_split") == 0)
+    {
+        return ExperimentalEncoding::Adaptive;
+    }
+    return ExperimentalEncoding::None;
+}
+
+struct TestParameters
+{
+    parquet::Compression::type compression;
+    parquet::Encoding::type encoding;
+    int32_t compressionLevel;
+    ExperimentalEncoding experimental;
+    // Values per block of ADAPTIVE_BYTE_STREAM_SPLIT.
+    size_t blockSize;
+    WriterSettings writer;
+    ReaderSettings reader;
+};
+
+// Block sizes which ADAPTIVE_BYTE_STREAM_SPLIT is measured with unless -k is given.
+const size_t kDefaultAdaptiveBlockSizes[] = {256, 1024, 4096, 16384, 65536};
+
+enum class FileType
+{
+    RawFloatFile,
+    RawDoubleFile,
+    // FP16 or BF16. Arrow has no BF16 type, so both are loaded as HALF_FLOAT. The benchmarks
+    // only move the bytes and never look at the values.
+    RawHalfFile,
+    ParquetFile
+};
+
+struct TestFile
+{
+    FileType type;
+    std::string fileName;
+};
+
+struct LoadedFile
+{
+    std::string fileName;
+    std::shared_ptr<arrow::Table> table;
+    uint64_t logical_size;
+};
+
+LoadedFile loadTestFile(const TestFile &file)
+{
+    LoadedFile loaded;
+    loaded.fileName = file.fileName;
+    switch(file.type)
+    {
+        case FileType::ParquetFile:
+            loaded.table = readParquetFile(file.fileName, loaded.logical_size);
+            break;
+        case FileType::RawFloatFile:
+            loaded.table = mapRawFileToArrowTable<arrow::FloatType>(file.fileName, loaded.logical_size);
+            break;
+        case FileType::RawDoubleFile:
+            loaded.table = mapRawFileToArrowTable<arrow::DoubleType>(file.fileName, loaded.logical_size);
+            break;
+        case FileType::RawHalfFile:
+            loaded.table = mapRawFileToArrowTable<arrow::HalfFloatType>(file.fileName, loaded.logical_size);
+            break;
+    }
+    return loaded;
+}
+
+// Reads the input chunk by chunk without materializing the whole file.
+// For raw files a chunk holds chunk_rows values. For Parquet files a chunk is one input row group.
+class InputChunkReader
+{
+public:
+    InputChunkReader(const TestFile &file, int64_t chunk_rows, arrow::MemoryPool *pool)
+        : file_type_(file.type), chunk_rows_(chunk_rows), next_row_group_(0)
+    {
+        arrow::Result<std::shared_ptr<arrow::io::ReadableFile> > infile =
+            arrow::io::ReadableFile::Open(file.fileName, pool);
+        if (!infile.ok()) {
+            std::cerr << "Couldn't open file " << file.fileName << std::endl;
+            exit(-1);
+        }
+        infile_ = *infile;
+        switch(file_type_)
+        {
+            case FileType::ParquetFile:
+                PARQUET_THROW_NOT_OK(parquet::arrow::OpenFile(infile_, pool, &parquet_reader_));
+                PARQUET_THROW_NOT_OK(parquet_reader_->GetSchema(&schema_));
+                logical_size_ = getUncompressedSize(*parquet_reader_->parquet_reader()->metadata());
+                break;
+            case FileType::RawFloatFile:
+                schema_ = arrow::schema({arrow::field("values", arrow::float32())});
+                logical_size_ = *infile_->GetSize() / sizeof(float) * sizeof(float);
+                break;
+            case FileType::RawDoubleFile:
+                schema_ = arrow::schema({arrow::field("values", arrow::float64())});
+                logical_size_ = *infile_->GetSize() / sizeof(double) * sizeof(double);
+                break;
+            case FileType::RawHalfFile:
+                schema_ = arrow::schema({arrow::field("values", arrow::float16())});
+                logical_size_ = *infile_->GetSize() / sizeof(uint16_t) * sizeof(uint16_t);
+                break;
+        }
+    }
+
+    // Same definition as for the fully loaded files.
+    uint64_t logical_size() const
+    {
+        return logical_size_;
+    }
+
+    const std::shared_ptr<arrow::Schema> &schema() const
+    {
+        return schema_;
+    }
+
+    // Returns nullptr once the input is exhausted.
+    std::shared_ptr<arrow::Table> next()
+    {
+        if (file_type_ == FileType::ParquetFile) {
+            if (next_row_group_ == parquet_reader_->num_row_groups()) {
+                return nullptr;
+            }
+            std::shared_ptr<arrow::Table> chunk;
+            PARQUET_THROW_NOT_OK(parquet_reader_->ReadRowGroup(next_row_group_++, &chunk));
+            return chunk;
+        }
+
+        const auto &type = schema_->field(0)->type();
+        const int64_t element_size = arrow::internal::checked_cast<const arrow::FixedWidthType&>(*type).bit_width() / 8;
+        std::shared_ptr<arrow::Buffer> values;
+        PARQUET_ASSIGN_OR_THROW(values, infile_->Read(chunk_rows_ * element_size));
+        const int64_t num_elements = values->size() / element_size;
+        if (num_elements == 0) {
+            return nullptr;
+        }
+        std::shared_ptr<arrow::Array> array;
+        if (file_type_ == FileType::RawFloatFile) {
+            array = std::make_shared<arrow::FloatArray>(num_elements, values);
+        } else if (file_type_ == FileType::RawHalfFile) {
+            array = std::make_shared<arrow::HalfFloatArray>(num_elements, values);
+        } else {
+            array = std::make_shared<arrow::DoubleArray>(num_elements, values);
+        }
+        return arrow::Table::Make(schema_, {array});
+    }
+
+private:
+    FileType file_type_;
+    int64_t chunk_rows_;
+    int next_row_group_;
+    uint64_t logical_size_;
+    std::shared_ptr<arrow::io::ReadableFile> infile_;
+    std::unique_ptr<parquet::arrow::FileReader> parquet_reader_;
+    std::shared_ptr<arrow::Schema> schema_;
+};
+
+// Hands out the rows of the input by their row number, to check what was read back.
+// Only one chunk is held at a time, so the input is read again from the start whenever
+// earlier rows are requested, e.g. for -read_row_groups 1 0.
+class InputRowCursor
+{
+public:
+    InputRowCursor(const TestFile &file, int64_t chunk_rows)
+        : file_(file), chunk_rows_(chunk_rows)
+    {
+        restart();
+    }
+
+    // Rows [row, row + num_rows) as they are written, see toParquetTable.
+    // Returns nullptr if the input has fewer rows.
+    std::shared_ptr<arrow::Table> rows(int64_t row, int64_t num_rows)
+    {
+        if (chunk_ != nullptr && row < chunk_start_)
+        {
+            restart();
+        }
+        std::vector<std::shared_ptr<arrow::Table> > slices;
+        while (num_rows > 0)
+        {
+            while (chunk_ == nullptr || row >= chunk_start_ + chunk_->num_rows())
+            {
+                if (chunk_ != nullptr) {
+                    chunk_start_ += chunk_->num_rows();
+                }
+                chunk_ = input_->next();
+                if (chunk_ == nullptr) {
+                    return nullptr;
+                }
+            }
+            const int64_t offset = row - chunk_start_;
+            const int64_t length = std::min(num_rows, chunk_->num_rows() - offset);
+            slices.push_back(chunk_->Slice(offset, length));
+            row += length;
+            num_rows -= length;
+        }
+        std::shared_ptr<arrow::Table> rows;
+        PARQUET_ASSIGN_OR_THROW(rows, arrow::ConcatenateTables(slices));
+        return toParquetTable(rows);
+    }
+
+private:
+    void restart()
+    {
+        input_.reset(new InputChunkReader(file_, chunk_rows_, arrow::default_memory_pool()));
+        chunk_ = nullptr;
+        chunk_start_ = 0;
+    }
+
+    TestFile file_;
+    int64_t chunk_rows_;
+    std::unique_ptr<InputChunkReader> input_;
+    std::shared_ptr<arrow::Table> chunk_;
+    int64_t chunk_start_;
+};
+
+// Writes the input one row group per chunk through a parquet::arrow::FileWriter
+// and reads it back with a record batch reader, so inputs larger than RAM can be benchmarked.
+// All allocations go through a proxy pool, which gives us the peak memory of a run.
+void runStreamingTest(const TestFile &file,
+                      const TestParameters &job,
+                      int64_t chunk_rows,
+                      size_t numRuns,
+                      size_t numWarmupRuns,
+                      size_t worker_id,
+                      TestResult &result)
+{
+    const std::string save_file_name = "/tmp/tmp_arrow_stream_" + std::to_string(worker_id) + ".parquet";
+    // A chunk is split further if the row groups are smaller than the chunks.
+    WriterSettings settings = job.writer;
+    if (settings.row_group_size == 0) {
+        settings.row_group_size = chunk_rows;
+    }
+    uint64_t logical_size = 0;
+    uint64_t read_logical_size = 0;
+    int64_t sz = 0;
+    uint64_t bytes_read = 0;
+    int64_t peak_memory = 0;
+    std::vector<int> column_indices;
+    std::vector<int> row_groups;
+    result.write_times_in_s.clear();
+    result.read_times_in_s.clear();
+    for (size_t i = 0; i < numWarmupRuns + numRuns; ++i)
+    {
+        double write_time = .0;
+        double read_time = .0;
+        arrow::ProxyMemoryPool pool(arrow::default_memory_pool());
+        InputChunkReader input(file, chunk_rows, &pool);
+        column_indices = projectColumns(*input.schema(), job.reader);
+        auto props = buildWriterProperties(input.schema(), job.compression, job.encoding, job.compressionLevel, settings);
+
+        auto sink = arrow::io::FileOutputStream::Open(save_file_name);
+        if (!sink.ok()) {
+            std::cerr << "Couldn't create an output stream" << std::endl;
+            exit(-1);
+        }
+        std::unique_ptr<parquet::arrow::FileWriter> writer;
+        PARQUET_THROW_NOT_OK(parquet::arrow::FileWriter::Open(*toParquetSchema(input.schema()), &pool, *sink, props, &writer));
+
+        int64_t num_rows_written = 0;
+        logical_size = input.logical_size();
+        while (std::shared_ptr<arrow::Table> chunk = input.next())
+        {
+            double t1 = gettime();
+            arrow::Status status = writer->WriteTable(*toParquetTable(chunk), std::min(chunk->num_rows(), settings.row_group_size));
+            double t2 = gettime();
+            write_time += (t2-t1);
+            if (!status.ok()) {
+                std::cerr << "Failed to write parquet: " << status.message() << std::endl;
+            }
+            num_rows_written += chunk->num_rows();
+        }
+        double t1 = gettime();
+        PARQUET_THROW_NOT_OK(writer->Close());
+        sz = *(*sink)->Tell();
+        PARQUET_THROW_NOT_OK((*sink)->Close());
+        double t2 = gettime();
+        write_time += (t2-t1);
+
+        std::unique_ptr<parquet::arrow::FileReader> reader;
+        parquet::arrow::FileReaderBuilder builder;
+        arrow::Result<std::shared_ptr<arrow::io::ReadableFile> > infile =
+            arrow::io::ReadableFile::Open(save_file_name, &pool);
+        if (!infile.ok()) {
+            std::cerr << "Couldn't open file " << save_file_name << std::endl;
+            exit(-1);
+        }
+        auto counting_file = std::make_shared<CountingRandomAccessFile>(*infile);
+        PARQUET_THROW_NOT_OK(builder.Open(counting_file));
+        PARQUET_THROW_NOT_OK(builder.memory_pool(&pool)->properties(buildReaderProperties(job.reader))->Build(&reader));
+        row_groups = selectRowGroups(reader->num_row_groups(), job.reader);
+        // The first row and the number of rows of every selected row group, in the order they are read.
+        const std::shared_ptr<parquet::FileMetaData> metadata = reader->parquet_reader()->metadata();
+        std::vector<int64_t> row_group_starts(1, 0);
+        for (int row_group = 0; row_group < metadata->num_row_groups(); ++row_group) {
+            row_group_starts.push_back(row_group_starts.back() + metadata->RowGroup(row_group)->num_rows());
+        }
+        std::vector<std::pair<int64_t, int64_t> > row_ranges;
+        int64_t num_rows_expected = 0;
+        for (const int row_group : row_groups) {
+            row_ranges.push_back({row_group_starts[row_group], metadata->RowGroup(row_group)->num_rows()});
+            num_rows_expected += row_ranges.back().second;
+        }
+
+        int64_t num_rows_read = 0;
+        InputRowCursor input_rows(file, chunk_rows);
+        size_t range = 0;
+        int64_t range_offset = 0;
+        bool differs = false;
+        t1 = gettime();
+        std::unique_ptr<arrow::RecordBatchReader> batch_reader;
+        PARQUET_THROW_NOT_OK(reader->GetRecordBatchReader(row_groups, column_indices, &batch_reader));
+        t2 = gettime();
+        read_time += (t2-t1);
+        for (;;) {
+            std::shared_ptr<arrow::RecordBatch> batch;
+            t1 = gettime();
+            PARQUET_THROW_NOT_OK(batch_reader->ReadNext(&batch));
+            t2 = gettime();
+            read_time += (t2-t1);
+            if (batch == nullptr) {
+                break;
+            }
+            num_rows_read += batch->num_rows();
+
+            // Not timed: compare the batch with the same rows of the input, one row group at a time.
+            std::shared_ptr<arrow::Table> batch_table;
+            PARQUET_ASSIGN_OR_THROW(batch_table, arrow::Table::FromRecordBatches({batch}));
+            int64_t batch_offset = 0;
+            while (!differs && batch_offset < batch->num_rows()) {
+                if (range == row_ranges.size()) {
+                    differs = true;
+                    break;
+                }
+                const int64_t length = std::min(batch->num_rows() - batch_offset,
+                                                row_ranges[range].second - range_offset);
+                const std::shared_ptr<arrow::Table> expected =
+                    input_rows.rows(row_ranges[range].first + range_offset, length);
+                differs = expected == nullptr ||
+                          !selectColumns(expected, column_indices)->Equals(*batch_table->Slice(batch_offset, length), false);
+                batch_offset += length;
+                range_offset += length;
+                if (range_offset == row_ranges[range].second) {
+                    range += 1;
+                    range_offset = 0;
+                }
+            }
+        }
+        if (num_rows_read != num_rows_expected) {
+            std::cerr << "Read " << num_rows_read << " rows but expected " << num_rows_expected
+                      << " of the " << num_rows_written << " written" << std::endl;
+        }
+        if (differs) {
+            std::cerr << "Table after decompression differs" << std::endl;
+        }
+        bytes_read = counting_file->bytes_read();
+        read_logical_size = getReadLogicalSize(*metadata, column_indices, row_groups, logical_size);
+        peak_memory = std::max(peak_memory, pool.max_memory());
+        recordRun(i, numWarmupRuns, write_time, read_time, result);
+    }
+
+    setResult(file.fileName, arrow::util::Codec::GetCodecAsString(job.compression), getEncodingName(job.encoding),
+              job.compressionLevel, logical_size, sz, bytes_read, &settings, result);
+    result.read_logical_size = read_logical_size;
+    result.peak_memory_in_bytes = peak_memory;
+    setReaderResult(job.reader, column_indices.size(), row_groups.size(), result);
+}
+
+// A contiguous run of fixed-width FP values, i.e. one chunk of an FP column.
+struct ValueBuffer
+{
+    const uint8_t *data;
+    size_t num_elements;
+    size_t type_size;
+};
+
+void collectColumnBuffers(const arrow::ChunkedArray &column, std::vector<ValueBuffer> &buffers)
+{
+    const auto &type = arrow::internal::checked_cast<const arrow::FixedWidthType &>(*column.type());
+    const size_t type_size = type.bit_width() / 8;
+    for (const auto &chunk : column.chunks())
+    {
+        const auto &array = arrow::internal::checked_cast<const arrow::PrimitiveArray &>(*chunk);
+        buffers.push_back({array.values()->data() + array.offset() * type_size, (size_t)array.length(), type_size});
+    }
+}
+
+std::vector<ValueBuffer> collectFloatingPointBuffers(const arrow::Table &table)
+{
+    std::vector<ValueBuffer> buffers;
+    for (int i = 0; i < table.num_columns(); ++i)
+    {
+        const auto &column = table.column(i);
+        if (arrow::is_floating(column->type()->id()))
+        {
+            collectColumnBuffers(*column, buffers);
+        }
+    }
+    return buffers;
+}
+
+// The codec which also offers the streaming API.
+// Parquet's LZ4 is the raw block format, so the LZ4 frame format is used instead.
+arrow::Compression::type getStreamingCodecType(parquet::Compression::type compression)
+{
+    switch (compression)
+    {
+        case parquet::Compression::ZSTD:
+            return arrow::Compression::ZSTD;
+        case parquet::Compression::LZ4:
+            return arrow::Compression::LZ4_FRAME;
+        case parquet::Compression::GZIP:
+            return arrow::Compression::GZIP;
+        default:
+            std::cerr << "The fused mode needs a streaming codec: zstd, lz4 or gzip" << std::endl;
+            exit(-1);
+    }
+}
+
+// Names the LZ4 frame format explicitly, so that its results are not taken for Parquet's LZ4.
+std::string getStreamingCodecName(parquet::Compression::type compression)
+{
+    const arrow::Compression::type type = getStreamingCodecType(compression);
+    if (type == arrow::Compression::LZ4_FRAME)
+    {
+        return "lz4_frame";
+    }
+    return arrow::util::Codec::GetCodecAsString(type);
+}
+
+std::unique_ptr<arrow::util::Codec> makeStreamingCodec(parquet::Compression::type compression, int32_t compressionLevel)
+{
+    const arrow::Compression::type type = getStreamingCodecType(compression);
+    auto codec = compressionLevel != -1 ? arrow::util::Codec::Create(type, compressionLevel)
+                                        : arrow::util::Codec::Create(type);
+    if (!codec.ok())
+    {
+        std::cerr << "Couldn't create the codec: " << codec.status().message() << std::endl;
+        exit(-1);
+    }
+    return std::move(*codec);
+}
+
+// Bytes of the tile which is split before its streams go to the compressors. It stays in L2.
+const size_t kFusedTileBytes = 128 * 1024;
+
+void compressAll(arrow::util::Compressor &compressor, const uint8_t *input, int64_t input_len,
+                 std::vector<uint8_t> &output, int64_t &output_len)
+{
+    while (input_len > 0)
+    {
+        auto res = compressor.Compress(input_len, input, output.size() - output_len, output.data() + output_len);
+        PARQUET_THROW_NOT_OK(res.status());
+        if (res->bytes_read == 0 && res->bytes_written == 0)
+        {
+            std::cerr << "The output buffer of a stream is too small" << std::endl;
+            exit(-1);
+        }
+        input += res->bytes_read;
+        input_len -= res->bytes_read;
+        output_len += res->bytes_written;
+    }
+}
+
+void endCompression(arrow::util::Compressor &compressor, std::vector<uint8_t> &output, int64_t &output_len)
+{
+    for (;;)
+    {
+        auto res = compressor.End(output.size() - output_len, output.data() + output_len);
+        PARQUET_THROW_NOT_OK(res.status());
+        output_len += res->bytes_written;
+        if (!res->should_retry)
+        {
+            break;
+        }
+    }
+}
+
+// Decompresses exactly output_len bytes and advances input_pos past the consumed input.
+void decompressExactly(arrow::util::Decompressor &decompressor, const std::vector<uint8_t> &input, int64_t input_len,
+                       int64_t &input_pos, uint8_t *output, int64_t output_len)
+{
+    int64_t written = 0;
+    while (written < output_len)
+    {
+        auto res = decompressor.Decompress(input_len - input_pos, input.data() + input_pos,
+                                           output_len - written, output + written);
+        PARQUET_THROW_NOT_OK(res.status());
+        if (res->bytes_read == 0 && res->bytes_written == 0 && !res->need_more_output)
+        {
+            std::cerr << "A compressed stream ended early" << std::endl;
+            exit(-1);
+        }
+        input_pos += res->bytes_read;
+        written += res->bytes_written;
+    }
+}
+
+// Benchmarks BYTE_STREAM_SPLIT plus compression on the raw FP values of the table, without Parquet.
+// The two-pass variant splits every buffer into a full-size intermediate buffer and compresses that.
+// The fused variant splits tile by tile and feeds every stream of the tile to its own streaming
+// compressor, so the split output never leaves the cache. Decoding mirrors both.
+void runFusedTest(const LoadedFile &file,
+                  const TestParameters &job,
+                  bool fused,
+                  size_t numRuns,
+                  size_t numWarmupRuns,
+                  TestResult &result)
+{
+    const std::unique_ptr<arrow::util::Codec> codec = makeStreamingCodec(job.compression, job.compressionLevel);
+    const std::vector<ValueBuffer> buffers = collectFloatingPointBuffers(*file.table);
+
+    // All buffers are allocated and touched up-front, so that the runs measure only the transform.
+    size_t max_buffer_bytes = 0;
+    std::vector<std::vector<std::vector<uint8_t> > > compressed(buffers.size());
+    std::vector<std::vector<int64_t> > compressed_len(buffers.size());
+    for (size_t b = 0; b < buffers.size(); ++b)
+    {
+        const ValueBuffer &buffer = buffers[b];
+        const int64_t buffer_bytes = buffer.num_elements * buffer.type_size;
+        max_buffer_bytes = std::max(max_buffer_bytes, (size_t)buffer_bytes);
+        if (fused)
+        {
+            // Streaming frames carry a little more overhead than a one-shot compression.
+            const int64_t capacity = codec->MaxCompressedLen(buffer.num_elements, nullptr) + 64 * 1024;
+            compressed[b].assign(buffer.type_size, std::vector<uint8_t>(capacity));
+            compressed_len[b].assign(buffer.type_size, 0);
+        }
+        else
+        {
+            compressed[b].assign(1, std::vector<uint8_t>(codec->MaxCompressedLen(buffer_bytes, nullptr)));
+            compressed_len[b].assign(1, 0);
+        }
+    }
+    std::vector<uint8_t> intermediate(fused ? kFusedTileBytes : max_buffer_bytes);
+    std::vector<uint8_t> decoded(max_buffer_bytes);
+
+    result.write_times_in_s.clear();
+    result.read_times_in_s.clear();
+    uint64_t compressed_size = 0;
+    for (size_t i = 0; i < numWarmupRuns + numRuns; ++i)
+    {
+        double write_time = .0;
+        double read_time = .0;
+        compressed_size = 0;
+        for (size_t b = 0; b < buffers.size(); ++b)
+        {
+            const ValueBuffer &buffer = buffers[b];
+            const size_t type_size = buffer.type_size;
+            const int64_t buffer_bytes = buffer.num_elements * type_size;
+            const size_t tile_elements = std::max<size_t>(1, kFusedTileBytes / type_size);
+
+            double t1 = gettime();
+            if (fused)
+            {
+                std::vector<std::shared_ptr<arrow::util::Compressor> > compressors(type_size);
+                for (size_t k = 0; k < type_size; ++k)
+                {
+                    auto compressor = codec->MakeCompressor();
+                    PARQUET_THROW_NOT_OK(compressor.status());
+                    compressors[k] = *compressor;
+                    compressed_len[b][k] = 0;
+                }
+                for (size_t begin = 0; begin < buffer.num_elements; begin += tile_elements)
+                {
+                    const size_t length = std::min(tile_elements, buffer.num_elements - begin);
+                    byte_stream_split_encode(buffer.data + begin * type_size, length, type_size, intermediate.data());
+                    for (size_t k = 0; k < type_size; ++k)
+                    {
+                        compressAll(*compressors[k], intermediate.data() + k * length, length,
+                                    compressed[b][k], compressed_len[b][k]);
+                    }
+                }
+                for (size_t k = 0; k < type_size; ++k)
+                {
+                    endCompression(*compressors[k], compressed[b][k], compressed_len[b][k]);
+                }
+            }
+            else
+            {
+                byte_stream_split_encode(buffer.data, buffer.num_elements, type_size, intermediate.data());
+                auto len = codec->Compress(buffer_bytes, intermediate.data(),
+                                           compressed[b][0].size(), compressed[b][0].data());
+                PARQUET_THROW_NOT_OK(len.status());
+                compressed_len[b][0] = *len;
+            }
+            double t2 = gettime();
+            write_time += (t2-t1);
+
+            t1 = gettime();
+            if (fused)
+            {
+                std::vector<std::shared_ptr<arrow::util::Decompressor> > decompressors(type_size);
+                std::vector<int64_t> input_pos(type_size, 0);
+                for (size_t k = 0; k < type_size; ++k)
+                {
+                    auto decompressor = codec->MakeDecompressor();
+                    PARQUET_THROW_NOT_OK(decompressor.status());
+                    decompressors[k] = *decompressor;
+                }
+                for (size_t begin = 0; begin < buffer.num_elements; begin += tile_elements)
+                {
+                    const size_t length = std::min(tile_elements, buffer.num_elements - begin);
+                    for (size_t k = 0; k < type_size; ++k)
+                    {
+                        decompressExactly(*decompressors[k], compressed[b][k], compressed_len[b][k], input_pos[k],
+                                          intermediate.data() + k * length, length);
+                    }
+                    byte_stream_split_decode(intermediate.data(), length, type_size, decoded.data() + begin * type_size);
+                }
+            }
+            else
+            {
+                auto len = codec->Decompress(compressed_len[b][0], compressed[b][0].data(),
+                                             buffer_bytes, intermediate.data());
+                PARQUET_THROW_NOT_OK(len.status());
+                byte_stream_split_decode(intermediate.data(), buffer.num_elements, type_size, decoded.data());
+            }
+            t2 = gettime();
+            read_time += (t2-t1);
+
+            if (memcmp(decoded.data(), buffer.data, buffer_bytes) != 0)
+            {
+                std::cerr << "Values after decompression differ" << std::endl;
+            }
+            for (size_t k = 0; k < compressed_len[b].size(); ++k)
+            {
+                compressed_size += compressed_len[b][k];
+            }
+        }
+        recordRun(i, numWarmupRuns, write_time, read_time, result);
+    }
+    setResult(file.fileName, getStreamingCodecName(job.compression),
+              fused ? "BYTE_STREAM_SPLIT_FUSED" : "BYTE_STREAM_SPLIT", job.compressionLevel,
+              file.logical_size, compressed_size, compressed_size, NULL, result);
+}
+
+// Byte histogram with four interleaved counters per value,
+// so that runs of the same byte do not serialize on one counter.
+struct ByteHistogram
+{
+    uint32_t counts[4][256];
+    uint64_t total;
+
+    ByteHistogram() : total(0)
+    {
+        memset(counts, 0, sizeof(counts));
+    }
+
+    void add(const uint8_t *data, size_t len)
+    {
+        size_t i = 0;
+        for (; i + 4 <= len; i += 4)
+        {
+            counts[0][data[i]]++;
+            counts[1][data[i + 1]]++;
+            counts[2][data[i + 2]]++;
+            counts[3][data[i + 3]]++;
+        }
+        for (; i < len; ++i)
+        {
+            counts[0][data[i]]++;
+        }
+        total += len;
+    }
+
+    // Order-0 entropy in bits per byte.
+    double entropy() const
+    {
+        double entropy = .0;
+        for (size_t v = 0; v < 256; ++v)
+        {
+            const uint64_t count = (uint64_t)counts[0][v] + counts[1][v] + counts[2][v] + counts[3][v];
+            if (count > 0)
+            {
+                const double p = (double)count / total;
+                entropy -= p * std::log2(p);
+            }
+        }
+        return entropy;
+    }
+};
+
+// Estimates the entropy in bits per byte from up to 16 blocks of 4 KiB spread over the data.
+// Order-0 entropy misses streams which change slowly, e.g. the high mantissa bytes of smooth data,
+// so the result is the smaller of the entropy of the bytes and of the differences of adjacent bytes.
+double estimateByteEntropy(const uint8_t *data, size_t len)
+{
+    const size_t kBlockBytes = 4096;
+    const size_t kMaxBlocks = 16;
+    if (len < 2)
+    {
+        return .0;
+    }
+    ByteHistogram histogram;
+    ByteHistogram delta_histogram;
+    uint8_t deltas[kBlockBytes];
+    const size_t num_blocks = std::min(kMaxBlocks, (len + kBlockBytes - 1) / kBlockBytes);
+    const size_t block_bytes = std::min(len, kBlockBytes);
+    for (size_t b = 0; b < num_blocks; ++b)
+    {
+        const size_t begin = num_blocks == 1 ? 1 : std::max<size_t>(1, (len - block_bytes) * b / (num_blocks - 1));
+        const size_t end = std::min(len, begin + block_bytes);
+        for (size_t i = begin; i < end; ++i)
+        {
+            deltas[i - begin] = data[i] - data[i - 1];
+        }
+        histogram.add(data + begin, end - begin);
+        delta_histogram.add(deltas, end - begin);
+    }
+    return std::min(histogram.entropy(), delta_histogram.entropy());
+}
+
+enum class StreamCodec : uint8_t
+{
+    Raw,
+    Default,
+    High
+};
+
+StreamCodec chooseStreamCodec(double entropy)
+{
+    // Nearly random bytes, e.g. the low mantissa bytes, do not compress. The codec would only burn CPU.
+    if (entropy > 7.5)
+    {
+        return StreamCodec::Raw;
+    }
+    // Highly redundant bytes, e.g. the exponents, are worth a slow and strong level.
+    if (entropy < 3.0)
+    {
+        return StreamCodec::High;
+    }
+    return StreamCodec::Default;
+}
+
+// The level for the redundant streams, or -1 if the codec has no levels worth trying.
+// zstd 19 compresses these streams only slightly better than 9, at a small fraction of the speed,
+// so it is 9 unless the job asks for a higher level anyway.
+int32_t getHighCompressionLevel(parquet::Compression::type compression, int32_t compressionLevel)
+{
+    switch (compression)
+    {
+        case parquet::Compression::ZSTD:
+        case parquet::Compression::GZIP:
+            return std::max(compressionLevel, 9);
+        default:
+            return -1;
+    }
+}
+
+std::unique_ptr<arrow::util::Codec> makeCodec(parquet::Compression::type compression, int32_t compressionLevel)
+{
+    auto codec = compressionLevel != -1 ? arrow::util::Codec::Create(compression, compressionLevel)
+                                        : arrow::util::Codec::Create(compression);
+    if (!codec.ok())
+    {
+        std::cerr << "Couldn't create the codec: " << codec.status().message() << std::endl;
+        exit(-1);
+    }
+    return std::move(*codec);
+}
+
+// Every stream is stored with a header of its codec choice and its compressed length.
+const size_t kStreamHeaderBytes = 1 + sizeof(int64_t);
+
+// Benchmarks BYTE_STREAM_SPLIT where every byte stream gets its own codec decision
+// from a quick estimate of its entropy.
+void runPerStreamTest(const LoadedFile &file,
+                      const TestParameters &job,
+                      size_t numRuns,
+                      size_t numWarmupRuns,
+                      TestResult &result)
+{
+    const int32_t high_level = getHighCompressionLevel(job.compression, job.compressionLevel);
+    const std::unique_ptr<arrow::util::Codec> default_codec = makeCodec(job.compression, job.compressionLevel);
+    const std::unique_ptr<arrow::util::Codec> high_codec =
+        high_level != -1 ? makeCodec(job.compression, high_level) : nullptr;
+    const std::vector<ValueBuffer> buffers = collectFloatingPointBuffers(*file.table);
+
+    size_t max_buffer_bytes = 0;
+    std::vector<std::vector<std::vector<uint8_t> > > compressed(buffers.size());
+    std::vector<std::vector<StreamCodec> > choices(buffers.size());
+    std::vector<std::vector<int64_t> > compressed_len(buffers.size());
+    for (size_t b = 0; b < buffers.size(); ++b)
+    {
+        const ValueBuffer &buffer = buffers[b];
+        max_buffer_bytes = std::max(max_buffer_bytes, buffer.num_elements * buffer.type_size);
+        const int64_t capacity = default_codec != nullptr
+            ? default_codec->MaxCompressedLen(buffer.num_elements, nullptr)
+            : buffer.num_elements;
+        compressed[b].assign(buffer.type_size, std::vector<uint8_t>(std::max<int64_t>(capacity, buffer.num_elements)));
+        choices[b].assign(buffer.type_size, StreamCodec::Raw);
+        compressed_len[b].assign(buffer.type_size, 0);
+    }
+    std::vector<uint8_t> intermediate(max_buffer_bytes);
+    std::vector<uint8_t> decoded(max_buffer_bytes);
+
+    result.write_times_in_s.clear();
+    result.read_times_in_s.clear();
+    uint64_t compressed_size = 0;
+    for (size_t i = 0; i < numWarmupRuns + numRuns; ++i)
+    {
+        double write_time = .0;
+        double read_time = .0;
+        compressed_size = 0;
+        for (size_t b = 0; b < buffers.size(); ++b)
+        {
+            const ValueBuffer &buffer = buffers[b];
+            const size_t n = buffer.num_elements;
+
+            double t1 = gettime();
+            byte_stream_split_encode(buffer.data, n, buffer.type_size, intermediate.data());
+            for (size_t k = 0; k < buffer.type_size; ++k)
+            {
+                const uint8_t *stream = intermediate.data() + k * n;
+                StreamCodec choice = chooseStreamCodec(estimateByteEntropy(stream, n));
+                if (choice == StreamCodec::High && high_codec == nullptr)
+                {
+                    choice = StreamCodec::Default;
+                }
+                if (choice == StreamCodec::Default && default_codec == nullptr)
+                {
+                    choice = StreamCodec::Raw;
+                }
+                arrow::util::Codec *codec = choice == StreamCodec::High ? high_codec.get() : default_codec.get();
+                choices[b][k] = choice;
+                if (choice == StreamCodec::Raw)
+                {
+                    memcpy(compressed[b][k].data(), stream, n);
+                    compressed_len[b][k] = n;
+                }
+                else
+                {
+                    auto len = codec->Compress(n, stream, compressed[b][k].size(), compressed[b][k].data());
+                    PARQUET_THROW_NOT_OK(len.status());
+                    compressed_len[b][k] = *len;
+                }
+            }
+            double t2 = gettime();
+            write_time += (t2-t1);
+
+            t1 = gettime();
+            for (size_t k = 0; k < buffer.type_size; ++k)
+            {
+                uint8_t *stream = intermediate.data() + k * n;
+                if (choices[b][k] == StreamCodec::Raw)
+                {
+                    memcpy(stream, compressed[b][k].data(), n);
+                }
+                else
+                {
+                    arrow::util::Codec *codec =
+                        choices[b][k] == StreamCodec::High ? high_codec.get() : default_codec.get();
+                    auto len = codec->Decompress(compressed_len[b][k], compressed[b][k].data(), n, stream);
+                    PARQUET_THROW_NOT_OK(len.status());
+                }
+            }
+            byte_stream_split_decode(intermediate.data(), n, buffer.type_size, decoded.data());
+            t2 = gettime();
+            read_time += (t2-t1);
+
+            if (memcmp(decoded.data(), buffer.data, n * buffer.type_size) != 0)
+            {
+                std::cerr << "Values after decompression differ" << std::endl;
+            }
+            for (size_t k = 0; k < buffer.type_size; ++k)
+            {
+                compressed_size += kStreamHeaderBytes + compressed_len[b][k];
+            }
+        }
+        recordRun(i, numWarmupRuns, write_time, read_time, result);
+    }
+    setResult(file.fileName, arrow::util::Codec::GetCodecAsString(job.compression),
+              "BYTE_STREAM_SPLIT_PER_STREAM", job.compressionLevel,
+              file.logical_size, compressed_size, compressed_size, NULL, result);
+}
+
+// An experimental encoding which turns the values of a column chunk into one buffer.
+struct BufferEncoding
+{
+    std::string name;
+    std::function<size_t(const ValueBuffer &)> encoded_size;
+    std::function<void(const ValueBuffer &, uint8_t *)> encode;
+    std::function<void(const uint8_t *, const ValueBuffer &, uint8_t *)> decode;
+};
+
+// Benchmarks an encoding whose output for every column chunk is compressed as a whole,
+// so the size has no page or file overhead.
+void runBufferEncodingTest(const LoadedFile &file,
+                           const TestParameters &job,
+                           const BufferEncoding &encoding,
+                           size_t numRuns,
+                           size_t numWarmupRuns,
+                           TestResult &result)
+{
+    const std::unique_ptr<arrow::util::Codec> codec = makeCodec(job.compression, job.compressionLevel);
+    const std::vector<ValueBuffer> buffers = collectFloatingPointBuffers(*file.table);
+
+    size_t max_buffer_bytes = 0;
+    size_t max_encoded_bytes = 0;
+    for (const ValueBuffer &buffer : buffers)
+    {
+        max_buffer_bytes = std::max(max_buffer_bytes, buffer.num_elements * buffer.type_size);
+        max_encoded_bytes = std::max(max_encoded_bytes, encoding.encoded_size(buffer));
+    }
+    const int64_t capacity = codec != nullptr ? codec->MaxCompressedLen(max_encoded_bytes, nullptr) : max_encoded_bytes;
+    std::vector<uint8_t> intermediate(max_encoded_bytes);
+    std::vector<uint8_t> compressed(capacity);
+    std::vector<uint8_t> decoded(max_buffer_bytes);
+
+    result.write_times_in_s.clear();
+    result.read_times_in_s.clear();
+    uint64_t compressed_size = 0;
+    for (size_t i = 0; i < numWarmupRuns + numRuns; ++i)
+    {
+        double write_time = .0;
+        double read_time = .0;
+        compressed_size = 0;
+        for (const ValueBuffer &buffer : buffers)
+        {
+            const int64_t num_bytes = buffer.num_elements * buffer.type_size;
+            const int64_t encoded_bytes = encoding.encoded_size(buffer);
+
+            double t1 = gettime();
+            encoding.encode(buffer, intermediate.data());
+            int64_t compressed_len = encoded_bytes;
+            if (codec != nullptr)
+            {
+                auto len = codec->Compress(encoded_bytes, intermediate.data(), capacity, compressed.data());
+                PARQUET_THROW_NOT_OK(len.status());
+                compressed_len = *len;
+            }
+            else
+            {
+                memcpy(compressed.data(), intermediate.data(), encoded_bytes);
+            }
+            double t2 = gettime();
+            write_time += (t2-t1);
+
+            t1 = gettime();
+            if (codec != nullptr)
+            {
+                auto len = codec->Decompress(compressed_len, compressed.data(), encoded_bytes, intermediate.data());
+                PARQUET_THROW_NOT_OK(len.status());
+            }
+            else
+            {
+                memcpy(intermediate.data(), compressed.data(), encoded_bytes);
+            }
+            encoding.decode(intermediate.data(), buffer, decoded.data());
+            t2 = gettime();
+            read_time += (t2-t1);
+
+            if (memcmp(decoded.data(), buffer.data, num_bytes) != 0)
+            {
+                std::cerr << "Values after decompression differ" << std::endl;
+            }
+            compressed_size += compressed_len;
+        }
+        recordRun(i, numWarmupRuns, write_time, read_time, result);
+    }
+    setResult(file.fileName, arrow::util::Codec::GetCodecAsString(job.compression), encoding.name,
+              job.compressionLevel, file.logical_size, compressed_size, compressed_size, NULL, result);
+}
+
+// BYTE_STREAM_SPLIT after a delta transform.
+BufferEncoding makeDeltaEncoding(DeltaTransform transform)
+{
+    BufferEncoding encoding;
+    encoding.name = transform == DeltaXor ? "BYTE_STREAM_SPLIT_XOR" : "BYTE_STREAM_SPLIT_SUB";
+    encoding.encoded_size = [](const ValueBuffer &buffer) {
+        return buffer.num_elements * buffer.type_size;
+    };
+    encoding.encode = [transform](const ValueBuffer &buffer, uint8_t *output) {
+        byte_stream_split_encode_delta(buffer.data, buffer.num_elements, buffer.type_size, transform, output);
+    };
+    encoding.decode = [transform](const uint8_t *input, const ValueBuffer &buffer, uint8_t *output) {
+        byte_stream_split_decode_delta(input, buffer.num_elements, buffer.type_size, transform, output);
+    };
+    return encoding;
+}
+
+// ADAPTIVE_BYTE_STREAM_SPLIT with blocks of blockSize values. The block size is part of the name.
+BufferEncoding makeAdaptiveEncoding(size_t blockSize)
+{
+    BufferEncoding encoding;
+    encoding.name = "ADAPTIVE_BYTE_STREAM_SPLIT_K" + std::to_string(blockSize);
+    encoding.encoded_size = [blockSize](const ValueBuffer &buffer) {
+        return adaptive_byte_stream_split_encoded_size(buffer.num_elements, buffer.type_size, blockSize);
+    };
+    encoding.encode = [blockSize](const ValueBuffer &buffer, uint8_t *output) {
+        adaptive_byte_stream_split_encode(buffer.data, buffer.num_elements, buffer.type_size, blockSize, output);
+    };
+    encoding.decode = [blockSize](const uint8_t *input, const ValueBuffer &buffer, uint8_t *output) {
+        adaptive_byte_stream_split_decode(input, buffer.num_elements, buffer.type_size, blockSize, output);
+    };
+    return encoding;
+}
+
+void runExperimentalTest(const LoadedFile &file,
+                         const TestParameters &job,
+                         size_t numRuns,
+                         size_t numWarmupRuns,
+                         TestResult &result)
+{
+    switch (job.experimental)
+    {
+        case ExperimentalEncoding::PerStreamCodec:
+            runPerStreamTest(file, job, numRuns, numWarmupRuns, result);
+            break;
+        case ExperimentalEncoding::XorDelta:
+            runBufferEncodingTest(file, job, makeDeltaEncoding(DeltaXor), numRuns, numWarmupRuns, result);
+            break;
+        case ExperimentalEncoding::SubDelta:
+            runBufferEncodingTest(file, job, makeDeltaEncoding(DeltaSub), numRuns, numWarmupRuns, result);
+            break;
+        case ExperimentalEncoding::Adaptive:
+            runBufferEncodingTest(file, job, makeAdaptiveEncoding(job.blockSize), numRuns, numWarmupRuns, result);
+            break;
+        case ExperimentalEncoding::None:
+            std::cerr << "Not an experimental encoding" << std::endl;
+            exit(-1);
+    }
+}
+
+// Time of the stages of -mode codec in one run.
+struct CodecStageTimes
+{
+    double encode = .0;
+    double compress = .0;
+    double decompress = .0;
+    double decode = .0;
+    // The codec on the raw values, without an encoding.
+    double raw_compress = .0;
+    double raw_decompress = .0;
+};
+
+int64_t compressPage(arrow::util::Codec *codec, const uint8_t *input, int64_t input_len, std::vector<uint8_t> &output)
+{
+    if (codec == nullptr)
+    {
+        output.resize(input_len);
+        memcpy(output.data(), input, input_len);
+        return input_len;
+    }
+    output.resize(codec->MaxCompressedLen(input_len, input));
+    auto len = codec->Compress(input_len, input, output.size(), output.data());
+    PARQUET_THROW_NOT_OK(len.status());
+    return *len;
+}
+
+void decompressPage(arrow::util::Codec *codec, const std::vector<uint8_t> &input, int64_t input_len,
+                    uint8_t *output, int64_t output_len)
+{
+    if (codec == nullptr)
+    {
+        memcpy(output, input.data(), input_len);
+        return;
+    }
+    auto len = codec->Decompress(input_len, input.data(), output_len, output);
+    PARQUET_THROW_NOT_OK(len.status());
+}
+
+// A data page of -mode codec.
+struct CodecPage
+{
+    size_t begin;
+    int num_values;
+    // Holds dictionary indices rather than PLAIN values.
+    bool is_dictionary;
+    int64_t encoded_len;
+    int64_t compressed_len;
+};
+
+// Encodes the buffer with the Parquet encoder of the job and compresses every page, as the column
+// writer does for a column chunk, and reads it back. The values are put in write batches and a page
+// is flushed once its encoded size reaches the page size. With dictionary encoding the pages hold
+// the indices, and once the dictionary reaches the dictionary page size the current page is
+// flushed, the dictionary page is written and the remaining values fall back to PLAIN, as in the
+// column writer.
+template <typename DType>
+void runCodecBuffer(const ValueBuffer &buffer,
+                    parquet::Encoding::type encoding,
+                    const WriterSettings &writer,
+                    arrow::util::Codec *codec,
+                    CodecStageTimes &times,
+                    uint64_t &compressed_size,
+                    std::vector<std::vector<uint8_t> > &compressed,
+                    std::vector<uint8_t> &decompressed,
+                    std::vector<uint8_t> &decoded)
+{
+    typedef typename DType::c_type T;
+    const parquet::schema::NodePtr node =
+        parquet::schema::PrimitiveNode::Make("value", parquet::Repetition::REQUIRED, DType::type_num);
+    const parquet::ColumnDescriptor descr(node, 0, 0);
+    const bool use_dictionary = encoding == parquet::Encoding::RLE_DICTIONARY;
+    const size_t batch_values = std::max<int64_t>(1, writer.write_batch_size);
+    const T *values = reinterpret_cast<const T *>(buffer.data);
+
+    auto encoder = parquet::MakeTypedEncoder<DType>(use_dictionary ? parquet::Encoding::PLAIN : encoding,
+                                                    use_dictionary, &descr);
+    std::vector<CodecPage> pages;
+    bool is_dictionary_written = false;
+    const auto flushPage = [&](size_t begin, size_t end)
+    {
+        if (compressed.size() <= pages.size())
+        {
+            compressed.resize(pages.size() + 1);
+        }
+        double t1 = gettime();
+        std::shared_ptr<arrow::Buffer> page = encoder->FlushValues();
+        double t2 = gettime();
+        times.encode += t2 - t1;
+        t1 = gettime();
+        const int64_t len = compressPage(codec, page->data(), page->size(), compressed[pages.size()]);
+        t2 = gettime();
+        times.compress += t2 - t1;
+        pages.push_back({begin, (int)(end - begin), use_dictionary && !is_dictionary_written, page->size(), len});
+    };
+    std::vector<uint8_t> dictionary;
+    std::vector<uint8_t> compressed_dictionary;
+    int64_t compressed_dictionary_len = 0;
+    int num_dictionary_values = 0;
+    const auto writeDictionary = [&]()
+    {
+        auto dict_encoder = dynamic_cast<parquet::DictEncoder<DType> *>(encoder.get());
+        double t1 = gettime();
+        dictionary.resize(dict_encoder->dict_encoded_size());
+        dict_encoder->WriteDict(dictionary.data());
+        num_dictionary_values = dict_encoder->num_entries();
+        double t2 = gettime();
+        times.encode += t2 - t1;
+        t1 = gettime();
+        compressed_dictionary_len = compressPage(codec, dictionary.data(), dictionary.size(), compressed_dictionary);
+        t2 = gettime();
+        times.compress += t2 - t1;
+    };
+    size_t page_begin = 0;
+    for (size_t begin = 0; begin < buffer.num_elements; begin += batch_values)
+    {
+        const size_t end = std::min(begin + batch_values, buffer.num_elements);
+        double t1 = gettime();
+        encoder->Put(values + begin, (int)(end - begin));
+        double t2 = gettime();
+        times.encode += t2 - t1;
+        const bool fall_back = use_dictionary && !is_dictionary_written &&
+            dynamic_cast<parquet::DictEncoder<DType> *>(encoder.get())->dict_encoded_size() >= writer.dictionary_page_size;
+        if (fall_back || encoder->EstimatedDataEncodedSize() >= writer.data_page_size || end == buffer.num_elements)
+        {
+            flushPage(page_begin, end);
+            page_begin = end;
+        }
+        if (fall_back)
+        {
+            writeDictionary();
+            is_dictionary_written = true;
+            encoder = parquet::MakeTypedEncoder<DType>(parquet::Encoding::PLAIN, false, &descr);
+        }
+    }
+    if (use_dictionary && !is_dictionary_written)
+    {
+        writeDictionary();
+    }
+
+    std::unique_ptr<parquet::DictDecoder<DType> > dict_decoder;
+    if (use_dictionary)
+    {
+        decompressed.resize(dictionary.size());
+        double t1 = gettime();
+        decompressPage(codec, compressed_dictionary, compressed_dictionary_len, decompressed.data(), dictionary.size());
+        double t2 = gettime();
+        times.decompress += t2 - t1;
+        t1 = gettime();
+        auto dictionary_decoder = parquet::MakeTypedDecoder<DType>(parquet::Encoding::PLAIN, &descr);
+        dictionary_decoder->SetData(num_dictionary_values, decompressed.data(), (int)dictionary.size());
+        dict_decoder = parquet::MakeDictDecoder<DType>(&descr);
+        dict_decoder->SetDict(dictionary_decoder.get());
+        t2 = gettime();
+        times.decode += t2 - t1;
+    }
+    auto decoder = parquet::MakeTypedDecoder<DType>(use_dictionary ? parquet::Encoding::PLAIN : encoding, &descr);
+    T *output = reinterpret_cast<T *>(decoded.data());
+    for (size_t p = 0; p < pages.size(); ++p)
+    {
+        const CodecPage &page = pages[p];
+        decompressed.resize(page.encoded_len);
+        double t1 = gettime();
+        decompressPage(codec, compressed[p], page.compressed_len, decompressed.data(), page.encoded_len);
+        double t2 = gettime();
+        times.decompress += t2 - t1;
+        t1 = gettime();
+        int num_decoded;
+        if (page.is_dictionary)
+        {
+            dict_decoder->SetData(page.num_values, decompressed.data(), (int)page.encoded_len);
+            num_decoded = dict_decoder->Decode(output + page.begin, page.num_values);
+        }
+        else
+        {
+            decoder->SetData(page.num_values, decompressed.data(), (int)page.encoded_len);
+            num_decoded = decoder->Decode(output + page.begin, page.num_values);
+        }
+        t2 = gettime();
+        times.decode += t2 - t1;
+        if (num_decoded != page.num_values)
+        {
+            std::cerr << "A page decoded to " << num_decoded << " instead of " << page.num_values << " values" << std::endl;
+        }
+    }
+    if (memcmp(decoded.data(), buffer.data, buffer.num_elements * sizeof(T)) != 0)
+    {
+        std::cerr << "Values after decompression differ" << std::endl;
+    }
+    compressed_size += compressed_dictionary_len;
+    for (const CodecPage &page : pages)
+    {
+        compressed_size += page.compressed_len;
+    }
+
+    // The codec alone, on the same pages of raw values.
+    for (size_t p = 0; p < pages.size(); ++p)
+    {
+        const CodecPage &page = pages[p];
+        const int64_t page_bytes = page.num_values * sizeof(T);
+        double t1 = gettime();
+        const int64_t len = compressPage(codec, buffer.data + page.begin * sizeof(T), page_bytes, compressed[p]);
+        double t2 = gettime();
+        times.raw_compress += t2 - t1;
+        t1 = gettime();
+        decompressPage(codec, compressed[p], len, decoded.data() + page.begin * sizeof(T), page_bytes);
+        t2 = gettime();
+        times.raw_decompress += t2 - t1;
+    }
+    if (memcmp(decoded.data(), buffer.data, buffer.num_elements * sizeof(T)) != 0)
+    {
+        std::cerr << "Values after the codec alone differ" << std::endl;
+    }
+}
+
+// Benchmarks the Parquet encoder and the codec of the job directly on the FP values, without the
+// Arrow to Parquet conversion, the statistics and the page headers of WriteTable. The write time is
+// encode plus compress and the read time decompress plus decode. The codec on the raw values is
+// reported as a separate stage.
+void runCodecTest(const LoadedFile &file,
+                  const TestParameters &job,
+                  size_t numRuns,
+                  size_t numWarmupRuns,
+                  TestResult &result)
+{
+    const std::unique_ptr<arrow::util::Codec> codec = makeCodec(job.compression, job.compressionLevel);
+    const std::vector<ValueBuffer> buffers = collectFloatingPointBuffers(*file.table);
+    size_t max_buffer_bytes = 0;
+    for (const ValueBuffer &buffer : buffers)
+    {
+        if (buffer.type_size != 4 && buffer.type_size != 8)
+        {
+            std::cerr << "-mode codec supports only FLOAT and DOUBLE columns" << std::endl;
+            exit(-1);
+        }
+        max_buffer_bytes = std::max(max_buffer_bytes, buffer.num_elements * buffer.type_size);
+    }
+    std::vector<std::vector<uint8_t> > compressed;
+    std::vector<uint8_t> decompressed;
+    std::vector<uint8_t> decoded(max_buffer_bytes);
+
+    result.write_times_in_s.clear();
+    result.read_times_in_s.clear();
+    std::vector<CodecStageTimes> stage_times;
+    uint64_t compressed_size = 0;
+    for (size_t i = 0; i < numWarmupRuns + numRuns; ++i)
+    {
+        CodecStageTimes times;
+        compressed_size = 0;
+        for (const ValueBuffer &buffer : buffers)
+        {
+            if (buffer.type_size == 4)
+            {
+                runCodecBuffer<parquet::FloatType>(buffer, job.encoding, job.writer, codec.get(),
+                                                   times, compressed_size,
+                                                   compressed, decompressed, decoded);
+            }
+            else
+            {
+                runCodecBuffer<parquet::DoubleType>(buffer, job.encoding, job.writer, codec.get(),
+                                                    times, compressed_size,
+                                                    compressed, decompressed, decoded);
+            }
+        }
+        if (recordRun(i, numWarmupRuns, times.encode + times.compress, times.decompress + times.decode, result)) {
+            stage_times.push_back(times);
+        }
+    }
+    CodecStageTimes mean;
+    for (const CodecStageTimes &times : stage_times)
+    {
+        mean.encode += times.encode / stage_times.size();
+        mean.compress += times.compress / stage_times.size();
+        mean.decompress += times.decompress / stage_times.size();
+        mean.decode += times.decode / stage_times.size();
+        mean.raw_compress += times.raw_compress / stage_times.size();
+        mean.raw_decompress += times.raw_decompress / stage_times.size();
+    }
+    result.stage_times_in_s = {
+        {"encode", mean.encode},
+        {"compress", mean.compress},
+        {"decompress", mean.decompress},
+        {"decode", mean.decode},
+        {"codec_only_compress", mean.raw_compress},
+        {"codec_only_decompress", mean.raw_decompress},
+    };
+    setResult(file.fileName, arrow::util::Codec::GetCodecAsString(job.compression), getEncodingName(job.encoding),
+              job.compressionLevel, file.logical_size, compressed_size, compressed_size, &job.writer, result);
+}
+
+// Range predicate LOW <= value <= HIGH of -mode pushdown.
+struct ValueRange
+{
+    double low;
+    double high;
+};
+
+#if ARROW_VERSION_MAJOR >= 12
+
+// What one scan of -mode pushdown has seen of the projected FP columns.
+struct ScanCounts
+{
+    // Data pages which were decoded.
+    int64_t pages_read = 0;
+    // Column chunks skipped as a whole by the statistics in the footer.
+    int64_t column_chunks_skipped = 0;
+    // Values within the range.
+    int64_t matches = 0;
+};
+
+bool isOutsideRange(double min, double max, const ValueRange &range)
+{
+    return max < range.low || min > range.high;
+}
+
+template <typename T>
+bool decodeMinMax(const std::string &encoded_min, const std::string &encoded_max, double &min, double &max)
+{
+    if (encoded_min.size() != sizeof(T) || encoded_max.size() != sizeof(T))
+    {
+        return false;
+    }
+    T value;
+    memcpy(&value, encoded_min.data(), sizeof(T));
+    min = value;
+    memcpy(&value, encoded_max.data(), sizeof(T));
+    max = value;
+    return true;
+}
+
+// Counts the values of one column chunk within the range. With pushdown, the chunk is skipped if
+// the statistics of the footer rule it out, and every data page if the min and max of the column
+// index, or of its page header if the file has no page index, do so.
+template <typename DType>
+void scanColumnChunk(parquet::RowGroupReader &row_group, int column,
+                     const std::shared_ptr<parquet::ColumnIndex> &column_index,
+                     const ValueRange &range, bool pushdown, ScanCounts &counts,
+                     std::vector<typename DType::c_type> &values, std::vector<int16_t> &def_levels)
+{
+    using T = typename DType::c_type;
+    if (pushdown)
+    {
+        const std::shared_ptr<parquet::Statistics> stats = row_group.metadata()->ColumnChunk(column)->statistics();
+        if (stats != NULL && stats->HasMinMax())
+        {
+            const auto typed_stats = std::static_pointer_cast<parquet::TypedStatistics<DType> >(stats);
+            if (isOutsideRange(typed_stats->min(), typed_stats->max(), range))
+            {
+                counts.column_chunks_skipped += 1;
+                return;
+            }
+        }
+    }
+
+    std::unique_ptr<parquet::PageReader> page_reader = row_group.GetColumnPageReader(column);
+    // The filter sees the data pages in the order of the column index.
+    size_t page = 0;
+    page_reader->set_data_page_filter([&](const parquet::DataPageStats &page_stats) {
+        const size_t ordinal = page++;
+        double min, max;
+        bool has_min_max = false;
+        if (pushdown && column_index != NULL && ordinal < column_index->null_pages().size())
+        {
+            // Pages of only nulls have no min and max, and never match.
+            if (column_index->null_pages()[ordinal])
+            {
+                return true;
+            }
+            has_min_max = decodeMinMax<T>(column_index->encoded_min_values()[ordinal],
+                                          column_index->encoded_max_values()[ordinal], min, max);
+        }
+        else if (pushdown && page_stats.encoded_statistics != NULL)
+        {
+            const parquet::EncodedStatistics &encoded = *page_stats.encoded_statistics;
+            has_min_max = encoded.has_min && encoded.has_max &&
+                          decodeMinMax<T>(encoded.min(), encoded.max(), min, max);
+        }
+        if (has_min_max && isOutsideRange(min, max, range))
+        {
+            return true;
+        }
+        counts.pages_read += 1;
+        return false;
+    });
+
+    const std::shared_ptr<parquet::ColumnReader> column_reader = parquet::ColumnReader::Make(
+        row_group.metadata()->schema()->Column(column), std::move(page_reader));
+    auto *typed_reader = static_cast<parquet::TypedColumnReader<DType> *>(column_reader.get());
+    while (typed_reader->HasNext())
+    {
+        int64_t values_read = 0;
+        typed_reader->ReadBatch(values.size(), def_levels.data(), NULL, values.data(), &values_read);
+        for (int64_t v = 0; v < values_read; ++v)
+        {
+            const double value = values[v];
+            counts.matches += value >= range.low && value <= range.high;
+        }
+    }
+}
+
+void scanFile(parquet::ParquetFileReader &reader, const std::vector<int> &columns, const ValueRange &range,
+              bool pushdown, ScanCounts &counts)
+{
+    const int64_t kValuesPerBatch = 64 * 1024;
+    std::vector<float> float_values(kValuesPerBatch);
+    std::vector<double> double_values(kValuesPerBatch);
+    std::vector<int16_t> def_levels(kValuesPerBatch);
+    const std::shared_ptr<parquet::PageIndexReader> page_index = pushdown ? reader.GetPageIndexReader() : NULL;
+    for (int i = 0; i < reader.metadata()->num_row_groups(); ++i)
+    {
+        const std::shared_ptr<parquet::RowGroupReader> row_group = reader.RowGroup(i);
+        const std::shared_ptr<parquet::RowGroupPageIndexReader> row_group_index =
+            page_index != NULL ? page_index->RowGroup(i) : NULL;
+        for (int column : columns)
+        {
+            const std::shared_ptr<parquet::ColumnIndex> column_index =
+                row_group_index != NULL ? row_group_index->GetColumnIndex(column) : NULL;
+            if (reader.metadata()->schema()->Column(column)->physical_type() == parquet::Type::FLOAT)
+            {
+                scanColumnChunk<parquet::FloatType>(*row_group, column, column_index, range, pushdown, counts,
+                                                    float_values, def_levels);
+            }
+            else
+            {
+                scanColumnChunk<parquet::DoubleType>(*row_group, column, column_index, range, pushdown, counts,
+                                                     double_values, def_levels);
+            }
+        }
+    }
+}
+
+// Writes the table with the job's settings and times two scans of the FLOAT and DOUBLE columns which
+// count the values within the range: a full scan which decodes every page, and a scan which skips
+// column chunks and pages with the statistics and the page index. The write time is WriteTable and
+// the read time the scan with pushdown.
+void runPushdownTest(const LoadedFile &file,
+                     const TestParameters &job,
+                     const ValueRange &range,
+                     size_t numRuns,
+                     size_t numWarmupRuns,
+                     TestResult &result)
+{
+    WriterSettings writer = job.writer;
+    if (writer.row_group_size == 0) {
+        writer.row_group_size = std::max<int64_t>(1, file.table->num_rows());
+    }
+    const auto props = buildWriterProperties(file.table->schema(), job.compression, job.encoding,
+                                             job.compressionLevel, writer);
+    const std::shared_ptr<arrow::Table> parquet_table = toParquetTable(file.table);
+    std::vector<int> columns;
+    for (int column : projectColumns(*parquet_table->schema(), job.reader))
+    {
+        // HALF_FLOAT columns are FIXED_LEN_BYTE_ARRAY in the Parquet table, so check the loaded one.
+        const arrow::Type::type type_id = file.table->schema()->field(column)->type()->id();
+        if (type_id == arrow::Type::FLOAT || type_id == arrow::Type::DOUBLE)
+        {
+            columns.push_back(column);
+        }
+        else if (arrow::is_floating(type_id))
+        {
+            std::cerr << "-mode pushdown supports only FLOAT and DOUBLE columns" << std::endl;
+            exit(-1);
+        }
+    }
+
+    result.write_times_in_s.clear();
+    result.read_times_in_s.clear();
+    std::vector<double> full_scan_times;
+    ScanCounts full_scan;
+    ScanCounts pushdown;
+    int64_t sz = 0;
+    uint64_t bytes_read = 0;
+    int64_t num_row_groups = 0;
+    for (size_t i = 0; i < numWarmupRuns + numRuns; ++i)
+    {
+        auto output = arrow::io::BufferOutputStream::Create(1024 * 1024 * 1024, ::arrow::default_memory_pool());
+        if (!output.ok()) {
+            std::cerr << "Couldn't create an output stream" << std::endl;
+            exit(-1);
+        }
+        std::shared_ptr<arrow::io::BufferOutputStream> buf_output_stream = *output;
+        double t1 = gettime();
+        arrow::Status status = parquet::arrow::WriteTable(*parquet_table, ::arrow::default_memory_pool(),
+            buf_output_stream, writer.row_group_size, props);
+        double t2 = gettime();
+        const double write_time = t2 - t1;
+        if (!status.ok()) {
+            std::cerr << "Failed to write parquet" << status.message() << std::endl;
+        }
+        sz = *buf_output_stream->Tell();
+        const std::shared_ptr<arrow::Buffer> buffer = *buf_output_stream->Finish();
+
+        full_scan = ScanCounts();
+        std::unique_ptr<parquet::ParquetFileReader> reader =
+            parquet::ParquetFileReader::Open(std::make_shared<arrow::io::BufferReader>(buffer));
+        num_row_groups = reader->metadata()->num_row_groups();
+        t1 = gettime();
+        scanFile(*reader, columns, range, false, full_scan);
+        t2 = gettime();
+        const double full_scan_time = t2 - t1;
+
+        // The footer is read again, so that the page index is not cached from the full scan.
+        pushdown = ScanCounts();
+        auto counting_file = std::make_shared<CountingRandomAccessFile>(
+            std::make_shared<arrow::io::BufferReader>(buffer));
+        reader = parquet::ParquetFileReader::Open(counting_file);
+        t1 = gettime();
+        scanFile(*reader, columns, range, true, pushdown);
+        t2 = gettime();
+        const double pushdown_time = t2 - t1;
+        bytes_read = counting_file->bytes_read();
+        if (pushdown.matches != full_scan.matches) {
+            std::cerr << "Pushdown found " << pushdown.matches << " values instead of " << full_scan.matches << std::endl;
+        }
+        if (recordRun(i, numWarmupRuns, write_time, pushdown_time, result)) {
+            full_scan_times.push_back(full_scan_time);
+        }
+    }
+    result.stage_times_in_s = {
+        {"full_scan", computeStatistics(full_scan_times).mean},
+        {"pushdown", computeStatistics(result.read_times_in_s).mean},
+    };
+    result.has_pushdown = true;
+    result.pages = full_scan.pages_read;
+    result.pages_skipped = full_scan.pages_read - pushdown.pages_read;
+    result.column_chunks_skipped = pushdown.column_chunks_skipped;
+    result.matches = pushdown.matches;
+    setResult(file.fileName, arrow::util::Codec::GetCodecAsString(job.compression), getEncodingName(job.encoding),
+              job.compressionLevel, file.logical_size, sz, bytes_read, &writer, result);
+    setReaderResult(job.reader, columns.size(), num_row_groups, result);
+}
+#endif
+
+// Entropy estimates of one FP column. All entropies are in bits per value.
+struct ColumnEntropy
+{
+    std::string name;
+    size_t type_size;
+    uint64_t num_values;
+    uint64_t num_distinct_values;
+    // Order-0 entropy of the whole values. It bounds dictionary encoding.
+    double value_entropy;
+    // Order-0 entropy of every byte stream after BYTE_STREAM_SPLIT.
+    std::vector<double> stream_entropy;
+    // The same for the streams of the XOR of adjacent values.
+    std::vector<double> xor_stream_entropy;
+};
+
+// The estimates look at up to kEntropySampleTiles tiles of kEntropyTileValues values spread over the column.
+const size_t kEntropyTileValues = 16 * 1024;
+const size_t kEntropySampleTiles = 64;
+
+template<typename UnsignedType>
+void xorAdjacentValues(const uint8_t *input, size_t num_values, UnsignedType previous, uint8_t *output)
+{
+    // Simple enough for the compiler to vectorize.
+    const UnsignedType *values = (const UnsignedType *)input;
+    UnsignedType *xored = (UnsignedType *)output;
+    xored[0] = values[0] ^ previous;
+    for (size_t i = 1; i < num_values; ++i)
+    {
+        xored[i] = values[i] ^ values[i - 1];
+    }
+}
+
+ColumnEntropy estimateColumnEntropy(const std::string &name, const arrow::ChunkedArray &column)
+{
+    std::vector<ValueBuffer> buffers;
+    collectColumnBuffers(column, buffers);
+    ColumnEntropy entropy;
+    entropy.name = name;
+    entropy.type_size = buffers.empty() ? 0 : buffers[0].type_size;
+    entropy.num_values = 0;
+    const size_t type_size = entropy.type_size;
+
+    // (buffer, first value) of every tile of the column.
+    std::vector<std::pair<size_t, size_t> > tiles;
+    for (size_t b = 0; b < buffers.size(); ++b)
+    {
+        for (size_t begin = 0; begin < buffers[b].num_elements; begin += kEntropyTileValues)
+        {
+            tiles.push_back(std::make_pair(b, begin));
+        }
+    }
+    const size_t num_sampled_tiles = std::min(kEntropySampleTiles, tiles.size());
+
+    std::vector<ByteHistogram> stream_histograms(type_size);
+    std::vector<ByteHistogram> xor_histograms(type_size);
+    std::unordered_map<uint64_t, uint64_t> value_counts;
+    std::vector<uint8_t> split(kEntropyTileValues * type_size);
+    std::vector<uint8_t> xored(kEntropyTileValues * type_size);
+    for (size_t t = 0; t < num_sampled_tiles; ++t)
+    {
+        const auto &tile = tiles[t * tiles.size() / num_sampled_tiles];
+        const ValueBuffer &buffer = buffers[tile.first];
+        const size_t n = std::min(kEntropyTileValues, buffer.num_elements - tile.second);
+        const uint8_t *values = buffer.data + tile.second * type_size;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint64_t value = 0;
+            memcpy(&value, values + i * type_size, type_size);
+            value_counts[value]++;
+        }
+
+        byte_stream_split_encode(values, n, type_size, split.data());
+        for (size_t k = 0; k < type_size; ++k)
+        {
+            stream_histograms[k].add(split.data() + k * n, n);
+        }
+
+        const uint8_t *previous = tile.second > 0 ? values - type_size : nullptr;
+        if (type_size == 4)
+        {
+            uint32_t p = 0;
+            if (previous != nullptr)
+            {
+                memcpy(&p, previous, sizeof(p));
+            }
+            xorAdjacentValues<uint32_t>(values, n, p, xored.data());
+        }
+        else if (type_size == 8)
+        {
+            uint64_t p = 0;
+            if (previous != nullptr)
+            {
+                memcpy(&p, previous, sizeof(p));
+            }
+            xorAdjacentValues<uint64_t>(values, n, p, xored.data());
+        }
+        else
+        {
+            for (size_t i = 0; i < n * type_size; ++i)
+            {
+                xored[i] = values[i] ^ (i >= type_size ? values[i - type_size] : (previous != nullptr ? previous[i] : 0));
+            }
+        }
+        byte_stream_split_encode(xored.data(), n, type_size, split.data());
+        for (size_t k = 0; k < type_size; ++k)
+        {
+            xor_histograms[k].add(split.data() + k * n, n);
+        }
+        entropy.num_values += n;
+    }
+
+    entropy.num_distinct_values = value_counts.size();
+    entropy.value_entropy = .0;
+    for (const auto &count : value_counts)
+    {
+        const double p = (double)count.second / entropy.num_values;
+        entropy.value_entropy -= p * std::log2(p);
+    }
+    for (size_t k = 0; k < type_size; ++k)
+    {
+        entropy.stream_entropy.push_back(stream_histograms[k].entropy());
+        entropy.xor_stream_entropy.push_back(xor_histograms[k].entropy());
+    }
+    return entropy;
+}
+
+struct EncodingAdvice
 {
-    std::cout << "Invalid arguments" << std::endl;
-    printHelp();
-    exit(-1);
-}
+    std::string codec;
+    std::string encoding;
+    int32_t compression_level;
+    // Bits of a raw value divided by the estimated bits of an encoded one.
+    double predicted_ratio;
+};
 
-parquet::Compression::type GetCompressionTypeFromString(const char *compressionName)
+// Predicts the -c combination for a column from its entropy, without running the benchmark matrix.
+// The order-0 entropies are only rough estimates of what the encodings plus a codec reach, not bounds:
+// zstd finds repeated sequences which order-0 statistics miss, but falls short of them on noisy
+// streams, e.g. it reaches a ratio of 1.57 where the estimate of walk.sp is 1.22.
+EncodingAdvice adviseEncoding(const ColumnEntropy &entropy)
 {
-    if (strcmp(compressionName, "gzip") == 0)
+    const double raw_bits = 8.0 * entropy.type_size;
+    const double split_bits = std::accumulate(entropy.stream_entropy.begin(), entropy.stream_entropy.end(), .0);
+    const double xor_split_bits = std::accumulate(entropy.xor_stream_entropy.begin(),
+                                                  entropy.xor_stream_entropy.end(), .0);
+    EncodingAdvice advice;
+    // Parquet falls back to plain once the dictionary page exceeds 1 MiB.
+    const bool dictionary_fits = entropy.num_distinct_values * entropy.type_size <= 1024 * 1024 &&
+                                 entropy.num_distinct_values * 4 <= entropy.num_values;
+    double encoded_bits;
+    if (dictionary_fits && entropy.value_entropy < split_bits)
     {
-        return parquet::Compression::GZIP;
+        advice.encoding = "dictionary";
+        encoded_bits = entropy.value_entropy;
     }
-    else if (strcmp(compressionName, "zstd") == 0)
+    else if (xor_split_bits < 0.9 * split_bits && xor_split_bits < 0.95 * raw_bits)
     {
-        return parquet::Compression::ZSTD;
+        // Smooth data: the XOR of neighbours zeroes the high bytes, see byte_stream_split_xor.
+        advice.encoding = "byte_stream_split_xor";
+        encoded_bits = xor_split_bits;
     }
-    else if (strcmp(compressionName, "snappy") == 0)
+    else if (split_bits < 0.95 * raw_bits)
     {
-        return parquet::Compression::SNAPPY;
+        advice.encoding = "byte_stream_split";
+        encoded_bits = split_bits;
     }
-    else if (strcmp(compressionName, "lz4") == 0)
+    else
     {
-        return parquet::Compression::LZ4;
+        // The entropy of the whole values only helps if they repeat. For distinct values it just
+        // reflects the size of the sample, which caps it at about 20 bits.
+        advice.encoding = "plain";
+        encoded_bits = dictionary_fits ? std::min(raw_bits, entropy.value_entropy) : raw_bits;
     }
-    else if (strcmp(compressionName, "uncompressed") == 0)
+    advice.predicted_ratio = raw_bits / std::max(encoded_bits, 1e-3);
+    if (advice.predicted_ratio < 1.05)
     {
-        return parquet::Compression::UNCOMPRESSED;
+        // Nothing to gain, so do not spend CPU on a codec.
+        advice.codec = "uncompressed";
+        advice.compression_level = -1;
     }
     else
     {
-        handleInvalidArg();
+        advice.codec = "zstd";
+        advice.compression_level = advice.predicted_ratio < 1.25 ? 1 : 3;
     }
+    return advice;
 }
 
-parquet::Encoding::type GetEncodingTypeFromString(const char *encodingName)
+// Prints: file column codec,encoding,level predicted_ratio distinct_values
+// value_entropy split_entropy xor_split_entropy stream_entropies xor_stream_entropies.
+// Entropies are in bits per value. The per-stream entropies are comma-separated.
+void adviseFile(const LoadedFile &file)
 {
-    if (strcmp(encodingName, "plain") == 0)
-    {
-        return parquet::Encoding::type::PLAIN;
-    }
-    else if (strcmp(encodingName, "dictionary") == 0)
-    {
-        return parquet::Encoding::type::RLE_DICTIONARY;
-    }
-    else if (strcmp(encodingName, "byte_stream_split") == 0)
-    {
-        return parquet::Encoding::type::BYTE_STREAM_SPLIT;
-    }
-    else
+    const auto &table = *file.table;
+    for (int i = 0; i < table.num_columns(); ++i)
     {
-        handleInvalidArg();
+        const auto &column = table.column(i);
+        if (!arrow::is_floating(column->type()->id()))
+        {
+            continue;
+        }
+        const ColumnEntropy entropy = estimateColumnEntropy(table.schema()->field(i)->name(), *column);
+        const EncodingAdvice advice = adviseEncoding(entropy);
+        auto join = [](const std::vector<double> &values) {
+            std::string joined;
+            for (size_t k = 0; k < values.size(); ++k)
+            {
+                joined += (k > 0 ? "," : "") + std::to_string(values[k]);
+            }
+            return joined;
+        };
+        std::cout << getBaseName(file.fileName) << " " << entropy.name << " "
+                  << advice.codec << "," << advice.encoding << "," << advice.compression_level << " "
+                  << advice.predicted_ratio << " " << entropy.num_distinct_values << " "
+                  << entropy.value_entropy << " "
+                  << std::accumulate(entropy.stream_entropy.begin(), entropy.stream_entropy.end(), .0) << " "
+                  << std::accumulate(entropy.xor_stream_entropy.begin(), entropy.xor_stream_entropy.end(), .0) << " "
+                  << join(entropy.stream_entropy) << " " << join(entropy.xor_stream_entropy) << std::endl;
     }
 }
 
-struct TestParameters
+void pinCurrentThread(size_t worker_id)
 {
-    parquet::Compression::type compression;
-    parquet::Encoding::type encoding;
-    int32_t compressionLevel;
-};
+    const unsigned num_cores = std::max(1U, std::thread::hardware_concurrency());
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(worker_id % num_cores, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset) != 0) {
+        std::cerr << "Couldn't pin worker " << worker_id << " to a core" << std::endl;
+    }
+}
 
-enum class FileType
+// Runs num_pairs (file, job) pairs on a pool of worker threads.
+// run_pair is called with the index of the pair and the id of the worker which runs it.
+// Results are printed in the same order as the serial loop would print them.
+void runJobs(size_t num_pairs,
+             size_t num_threads,
+             bool pin_threads,
+             OutputFormat format,
+             const RunMetadata &metadata,
+             const std::function<TestResult(size_t, size_t)> &run_pair)
 {
-    RawFloatFile,
-    RawDoubleFile,
-    ParquetFile
-};
+    std::vector<TestResult> results(num_pairs);
+    std::vector<bool> finished(num_pairs, false);
+    size_t next_to_print = 0;
+    std::mutex print_mutex;
+    std::atomic<size_t> next_pair(0);
 
-struct TestFile
-{
-    FileType type;
-    std::string fileName;
-};
+    auto worker = [&](size_t worker_id) {
+        if (pin_threads) {
+            pinCurrentThread(worker_id);
+        }
+        for (;;) {
+            const size_t pair = next_pair.fetch_add(1);
+            if (pair >= num_pairs) {
+                break;
+            }
+            TestResult result = run_pair(pair, worker_id);
+
+            std::lock_guard<std::mutex> lock(print_mutex);
+            results[pair] = result;
+            finished[pair] = true;
+            while (next_to_print < num_pairs && finished[next_to_print]) {
+                print_result(results[next_to_print], format, metadata);
+                ++next_to_print;
+            }
+        }
+    };
+
+    if (num_threads <= 1) {
+        worker(0);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::min(num_threads, num_pairs); ++i) {
+        threads.emplace_back(worker, i);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
 
 } // namespace
 
@@ -412,9 +3262,31 @@ int main(int argc, char *argv[]) {
     }
 
     std::vector<TestParameters> testJobs;
+    std::vector<size_t> adaptive_block_sizes;
+    std::vector<int64_t> data_page_sizes;
+    std::vector<int64_t> row_group_sizes;
+    std::vector<int64_t> dictionary_page_sizes;
+    std::vector<int64_t> write_batch_sizes;
+    std::vector<int64_t> read_threads;
+    // Applies to every job. -read_threads sweeps its cpu_threads.
+    ReaderSettings reader_settings;
+    bool reader_options = false;
     std::vector<TestFile> files;
     unsigned long num_rounds = 16;
     bool use_io = false;
+    bool use_perf_counters = false;
+    unsigned long num_threads = 1;
+    bool pin_threads = false;
+    int64_t stream_rows = 0;
+    bool fused = false;
+    bool advise = false;
+    BenchmarkMode mode = BenchmarkMode::Parquet;
+    bool write_statistics = true;
+    bool write_page_index = false;
+    bool has_range = false;
+    ValueRange range = {0, 0};
+    unsigned long num_warmup_rounds = 0;
+    OutputFormat format = OutputFormat::Text;
     for (int i = 1; i < argc; ++i)
     {
         const char *arg = argv[i];
@@ -461,6 +3333,11 @@ int main(int argc, char *argv[]) {
                     {
                         files.push_back({FileType::RawDoubleFile, fname});
                     }
+                    else if (fname.compare(fname.length() - 3, 3, ".hp") == 0 ||
+                             fname.compare(fname.length() - 3, 3, ".bf") == 0)
+                    {
+                        files.push_back({FileType::RawHalfFile, fname});
+                    }
                     else
                     {
                         break;
@@ -492,13 +3369,19 @@ int main(int argc, char *argv[]) {
                         splitBorder[0] = '\0';
                         const int32_t compressionLevel = atoi(splitBorder+1);
                         const auto compressionType = GetCompressionTypeFromString(compression);
-                        const auto encodingType = GetEncodingTypeFromString(encoding);
+                        const auto experimentalEncoding = GetExperimentalEncodingFromString(encoding);
+                        // The experimental encodings build on BYTE_STREAM_SPLIT.
+                        const auto encodingType = experimentalEncoding != ExperimentalEncoding::None
+                            ? parquet::Encoding::type::BYTE_STREAM_SPLIT
+                            : GetEncodingTypeFromString(encoding);
 
                         TestParameters job =
                         {
                             compressionType,
                             encodingType,
                             compressionLevel,
+                            experimentalEncoding,
+                            0,
                         };
                         testJobs.push_back(job);
                     } else {
@@ -507,6 +3390,112 @@ int main(int argc, char *argv[]) {
                 }
                 i = j - 1;
             }
+            else if (strcmp(arg, "-k") == 0) {
+                int j = i + 1;
+                for (; j < argc && argv[j][0] != '-'; ++j) {
+                    const size_t block_size = strtoul(argv[j], NULL, 10);
+                    if (block_size == 0) {
+                        handleInvalidArg();
+                    }
+                    adaptive_block_sizes.push_back(block_size);
+                }
+                if (j == i + 1) {
+                    handleInvalidArg();
+                }
+                i = j - 1;
+            }
+            else if (strcmp(arg, "-page_size") == 0) {
+                i = parseSweepValues(argc, argv, i, data_page_sizes);
+            }
+            else if (strcmp(arg, "-row_group_size") == 0) {
+                i = parseSweepValues(argc, argv, i, row_group_sizes);
+            }
+            else if (strcmp(arg, "-dictionary_page_size") == 0) {
+                i = parseSweepValues(argc, argv, i, dictionary_page_sizes);
+            }
+            else if (strcmp(arg, "-write_batch_size") == 0) {
+                i = parseSweepValues(argc, argv, i, write_batch_sizes);
+            }
+            else if (strcmp(arg, "-no_statistics") == 0) {
+                write_statistics = false;
+            }
+            else if (strcmp(arg, "-page_index") == 0) {
+                write_page_index = true;
+            }
+            else if (strcmp(arg, "-use_threads") == 0) {
+                reader_settings.use_threads = true;
+                reader_options = true;
+            }
+            else if (strcmp(arg, "-pre_buffer") == 0) {
+                reader_settings.pre_buffer = true;
+                reader_options = true;
+            }
+            else if (strcmp(arg, "-batch_size") == 0 || strcmp(arg, "-io_threads") == 0) {
+                std::vector<int64_t> values;
+                i = parseSweepValues(argc, argv, i, values);
+                if (values.size() != 1) {
+                    handleInvalidArg();
+                }
+                if (strcmp(arg, "-batch_size") == 0) {
+                    reader_settings.batch_size = values[0];
+                } else {
+                    reader_settings.io_threads = values[0];
+                }
+                reader_options = true;
+            }
+            else if (strcmp(arg, "-read_row_groups") == 0) {
+                int j = i + 1;
+                for (; j < argc && argv[j][0] != '-'; ++j) {
+                    char *end = nullptr;
+                    const long row_group = strtol(argv[j], &end, 10);
+                    if (*end != '\0' || row_group < 0) {
+                        handleInvalidArg();
+                    }
+                    if (std::find(reader_settings.row_groups.begin(), reader_settings.row_groups.end(), row_group) !=
+                        reader_settings.row_groups.end()) {
+                        std::cerr << "Row group " << row_group << " is given twice" << std::endl;
+                        exit(-1);
+                    }
+                    reader_settings.row_groups.push_back(row_group);
+                }
+                if (j == i + 1) {
+                    handleInvalidArg();
+                }
+                i = j - 1;
+                reader_options = true;
+            }
+            else if (strcmp(arg, "-sample_columns") == 0 || strcmp(arg, "-sample_row_groups") == 0) {
+                std::vector<int64_t> values;
+                i = parseSweepValues(argc, argv, i, values);
+                if (values.size() != 1) {
+                    handleInvalidArg();
+                }
+                if (strcmp(arg, "-sample_columns") == 0) {
+                    reader_settings.sample_columns = values[0];
+                } else {
+                    reader_settings.sample_row_groups = values[0];
+                }
+                reader_options = true;
+            }
+            else if (strcmp(arg, "-read_per_column") == 0) {
+                reader_settings.per_column = true;
+                reader_options = true;
+            }
+            else if (strcmp(arg, "-read_threads") == 0) {
+                i = parseSweepValues(argc, argv, i, read_threads);
+                reader_options = true;
+            }
+            else if (strcmp(arg, "-read_columns") == 0) {
+                int j = i + 1;
+                for (; j < argc && argv[j][0] != '-'; ++j) {
+                    reader_settings.columns.push_back(argv[j]);
+                }
+                if (j == i + 1) {
+                    handleInvalidArg();
+                }
+                i = j - 1;
+                reader_options = true;
+            }
             else if (strcmp(arg, "-r") == 0) {
                 i += 1;
                 if (i == argc) {
@@ -514,10 +3503,107 @@ int main(int argc, char *argv[]) {
                     break;
                 }
                 num_rounds = strtoul(argv[i], NULL, 10);
+                if (num_rounds == 0) {
+                    handleInvalidArg();
+                }
+            }
+            else if (strcmp(arg, "-warmup") == 0) {
+                i += 1;
+                if (i == argc) {
+                    handleInvalidArg();
+                    break;
+                }
+                num_warmup_rounds = strtoul(argv[i], NULL, 10);
             }
             else if (strcmp(arg, "-io") == 0) {
                 use_io = true;
             }
+            else if (strcmp(arg, "-perf") == 0) {
+                use_perf_counters = true;
+            }
+            else if (strcmp(arg, "-format") == 0 || strcmp(arg, "--format") == 0) {
+                i += 1;
+                if (i == argc) {
+                    handleInvalidArg();
+                    break;
+                }
+                if (strcmp(argv[i], "text") == 0) {
+                    format = OutputFormat::Text;
+                } else if (strcmp(argv[i], "json") == 0) {
+                    format = OutputFormat::Json;
+                } else if (strcmp(argv[i], "csv") == 0) {
+                    format = OutputFormat::Csv;
+                } else {
+                    handleInvalidArg();
+                }
+            }
+            else if (strcmp(arg, "-j") == 0) {
+                i += 1;
+                if (i == argc) {
+                    handleInvalidArg();
+                    break;
+                }
+                num_threads = strtoul(argv[i], NULL, 10);
+                if (num_threads == 0) {
+                    handleInvalidArg();
+                }
+            }
+            else if (strcmp(arg, "-pin") == 0) {
+                pin_threads = true;
+            }
+            else if (strcmp(arg, "-advise") == 0 || strcmp(arg, "--advise") == 0) {
+                advise = true;
+            }
+            else if (strcmp(arg, "-fused") == 0) {
+                fused = true;
+            }
+            else if (strcmp(arg, "-mode") == 0) {
+                i += 1;
+                if (i == argc) {
+                    handleInvalidArg();
+                    break;
+                }
+                if (strcmp(argv[i], "parquet") == 0) {
+                    mode = BenchmarkMode::Parquet;
+                } else if (strcmp(argv[i], "codec") == 0) {
+                    mode = BenchmarkMode::Codec;
+                } else if (strcmp(argv[i], "pushdown") == 0) {
+#if ARROW_VERSION_MAJOR >= 12
+                    mode = BenchmarkMode::Pushdown;
+#else
+                    std::cerr << "-mode pushdown needs Arrow 12 or later" << std::endl;
+                    exit(-1);
+#endif
+                } else {
+                    handleInvalidArg();
+                }
+            }
+            else if (strcmp(arg, "-range") == 0) {
+                if (i + 2 >= argc) {
+                    handleInvalidArg();
+                    break;
+                }
+                char *low_end;
+                char *high_end;
+                range.low = strtod(argv[i + 1], &low_end);
+                range.high = strtod(argv[i + 2], &high_end);
+                if (*low_end != '\0' || *high_end != '\0' || !(range.low <= range.high)) {
+                    handleInvalidArg();
+                }
+                has_range = true;
+                i += 2;
+            }
+            else if (strcmp(arg, "-stream") == 0) {
+                i += 1;
+                if (i == argc) {
+                    handleInvalidArg();
+                    break;
+                }
+                stream_rows = strtoll(argv[i], NULL, 10);
+                if (stream_rows <= 0) {
+                    handleInvalidArg();
+                }
+            }
             else
             {
                 handleInvalidArg();
@@ -527,37 +3613,196 @@ int main(int argc, char *argv[]) {
             handleInvalidArg();
         }
     }
-    for (const auto &file : files)
+    // Every adaptive job is run once per block size.
+    if (adaptive_block_sizes.empty())
+    {
+        adaptive_block_sizes.assign(std::begin(kDefaultAdaptiveBlockSizes), std::end(kDefaultAdaptiveBlockSizes));
+    }
+    std::vector<TestParameters> expandedJobs;
+    for (const auto &job : testJobs)
     {
-        std::shared_ptr<arrow::Table> table;
-        const auto &fileName = file.fileName;
-        uint64_t file_size;
-        switch(file.type)
+        if (job.experimental != ExperimentalEncoding::Adaptive)
         {
-            case FileType::ParquetFile:
-                table = readParquetFile(fileName);
-                break;
-            case FileType::RawFloatFile:
-                {
-                const auto data = readBinaryFile<float>(fileName);
-                file_size = data.size() * sizeof(float);
-                table = transformRawVectorToArrowTable(data);
-                break;
-                }
-            case FileType::RawDoubleFile:
-                {
-                const auto data = readBinaryFile<double>(fileName);
-                file_size = data.size() * sizeof(double);
-                table = transformRawVectorToArrowTable(data);
-                break;
-                }
+            expandedJobs.push_back(job);
+            continue;
+        }
+        for (const size_t block_size : adaptive_block_sizes)
+        {
+            expandedJobs.push_back(job);
+            expandedJobs.back().blockSize = block_size;
         }
+    }
+    testJobs.swap(expandedJobs);
+
+    // Every job is run once per combination of the swept writer properties.
+    const auto sweepWriterProperty = [&testJobs](const std::vector<int64_t> &values, int64_t WriterSettings::*property)
+    {
+        if (values.empty())
+        {
+            return;
+        }
+        std::vector<TestParameters> sweptJobs;
+        for (const auto &job : testJobs)
+        {
+            for (const int64_t value : values)
+            {
+                sweptJobs.push_back(job);
+                sweptJobs.back().writer.*property = value;
+            }
+        }
+        testJobs.swap(sweptJobs);
+    };
+    for (auto &job : testJobs)
+    {
+        job.writer.statistics = write_statistics;
+        job.writer.page_index = write_page_index;
+        job.reader = reader_settings;
+    }
+    // The sync and the dropped page cache of one worker would land in the timings of the others.
+    if (use_io && num_threads > 1)
+    {
+        std::cerr << "-io needs -j 1" << std::endl;
+        exit(-1);
+    }
+    // The counters follow the worker thread and would miss the work on Arrow's pools.
+    if (use_perf_counters && (reader_settings.use_threads || reader_settings.pre_buffer || !read_threads.empty()))
+    {
+        std::cerr << "-perf cannot be combined with -use_threads, -read_threads or -pre_buffer" << std::endl;
+        exit(-1);
+    }
+    // The CPU and I/O pools are shared by the process, so the workers would decode and read on the same threads.
+    if (num_threads > 1 && (reader_settings.use_threads || reader_settings.pre_buffer || !read_threads.empty()))
+    {
+        std::cerr << "-use_threads, -read_threads and -pre_buffer need -j 1" << std::endl;
+        exit(-1);
+    }
+    if (!read_threads.empty())
+    {
+        std::vector<TestParameters> sweptJobs;
+        for (const auto &job : testJobs)
+        {
+            for (const int64_t threads : read_threads)
+            {
+                sweptJobs.push_back(job);
+                sweptJobs.back().reader.use_threads = true;
+                sweptJobs.back().reader.cpu_threads = threads;
+            }
+        }
+        testJobs.swap(sweptJobs);
+    }
+    if (reader_settings.io_threads > 0)
+    {
+        PARQUET_THROW_NOT_OK(arrow::io::SetIOThreadPoolCapacity(reader_settings.io_threads));
+    }
+    sweepWriterProperty(data_page_sizes, &WriterSettings::data_page_size);
+    sweepWriterProperty(row_group_sizes, &WriterSettings::row_group_size);
+    sweepWriterProperty(dictionary_page_sizes, &WriterSettings::dictionary_page_size);
+    sweepWriterProperty(write_batch_sizes, &WriterSettings::write_batch_size);
+    const bool writer_sweep = !data_page_sizes.empty() || !row_group_sizes.empty() ||
+                              !dictionary_page_sizes.empty() || !write_batch_sizes.empty() ||
+                              !write_statistics || write_page_index;
+    if (mode == BenchmarkMode::Pushdown && !has_range)
+    {
+        std::cerr << "-mode pushdown needs -range LOW HIGH" << std::endl;
+        exit(-1);
+    }
+
+    if (use_perf_counters)
+    {
+        PerfCounters perf_counters;
+        if (perf_counters_open(&perf_counters)) {
+            perf_counters_close(&perf_counters);
+        } else {
+            std::cerr << "Hardware counters are not available, -perf is ignored" << std::endl;
+            use_perf_counters = false;
+        }
+    }
+    const RunMetadata metadata = collectRunMetadata(num_threads, num_warmup_rounds, writer_sweep, reader_options);
+    if (format == OutputFormat::Csv)
+    {
+        print_csv_header();
+    }
+
+    if (advise)
+    {
+        for (const auto &file : files)
+        {
+            adviseFile(loadTestFile(file));
+        }
+        return 0;
+    }
+
+    if (stream_rows > 0)
+    {
         for (const auto &job : testJobs)
         {
-            TestResult result;
-            runTest(fileName, table, file_size, job.compression, job.encoding, job.compressionLevel, num_rounds, use_io, result);
-            print_result(result);
+            if (job.experimental != ExperimentalEncoding::None)
+            {
+                std::cerr << "The experimental encodings cannot be streamed" << std::endl;
+                exit(-1);
+            }
+        }
+        runJobs(files.size() * testJobs.size(), num_threads, pin_threads, format, metadata,
+            [&](size_t pair, size_t worker_id) {
+                TestResult result;
+                runStreamingTest(files[pair / testJobs.size()], testJobs[pair % testJobs.size()],
+                                 stream_rows, num_rounds, num_warmup_rounds, worker_id, result);
+                return result;
+            });
+        return 0;
+    }
+
+    // With a single worker we keep the old behaviour of loading one file at a time.
+    // Otherwise all files are loaded up-front so that every (file, job) pair can be scheduled.
+    const size_t files_per_batch = num_threads > 1 ? files.size() : 1;
+    for (size_t batch_start = 0; batch_start < files.size(); batch_start += files_per_batch)
+    {
+        const size_t batch_end = std::min(files.size(), batch_start + files_per_batch);
+        std::vector<LoadedFile> loaded_files;
+        for (size_t i = batch_start; i < batch_end; ++i)
+        {
+            loaded_files.push_back(loadTestFile(files[i]));
+        }
+        if (fused)
+        {
+            // Every (file, job) pair is measured as the two-pass and as the fused variant.
+            runJobs(loaded_files.size() * testJobs.size() * 2, num_threads, pin_threads, format, metadata,
+                [&](size_t pair, size_t) {
+                    const LoadedFile &file = loaded_files[pair / (testJobs.size() * 2)];
+                    const TestParameters &job = testJobs[(pair / 2) % testJobs.size()];
+                    TestResult result;
+                    runFusedTest(file, job, pair % 2 == 1, num_rounds, num_warmup_rounds, result);
+                    return result;
+                });
+            continue;
         }
+        runJobs(loaded_files.size() * testJobs.size(), num_threads, pin_threads, format, metadata,
+            [&](size_t pair, size_t worker_id) {
+                const LoadedFile &file = loaded_files[pair / testJobs.size()];
+                const TestParameters &job = testJobs[pair % testJobs.size()];
+                TestResult result;
+                if (job.experimental != ExperimentalEncoding::None)
+                {
+                    runExperimentalTest(file, job, num_rounds, num_warmup_rounds, result);
+                    return result;
+                }
+                if (mode == BenchmarkMode::Codec)
+                {
+                    runCodecTest(file, job, num_rounds, num_warmup_rounds, result);
+                    return result;
+                }
+#if ARROW_VERSION_MAJOR >= 12
+                if (mode == BenchmarkMode::Pushdown)
+                {
+                    runPushdownTest(file, job, range, num_rounds, num_warmup_rounds, result);
+                    return result;
+                }
+#endif
+                runTest(file.fileName, file.table, file.logical_size, job.compression, job.encoding,
+                        job.compressionLevel, job.writer, job.reader, num_rounds, num_warmup_rounds, use_io, use_perf_counters,
+                        worker_id, result);
+                return result;
+            });
     }
 
     return 0;
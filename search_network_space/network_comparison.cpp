@@ -7,6 +7,14 @@
 #include <time.h>
 #include <sys/mman.h>
 
+#include <algorithm>
+#include <thread>
+
+#include "../byte_stream_split/byte_stream_split.h"
+#include "../byte_stream_split/perf_counters.h"
+// The kernels of the optimal networks of search_space, see the Makefile.
+#include "generated_kernels.h"
+
 #define ASSERT(x) \
     do { \
         if (!(x)) { \
@@ -15,9 +23,6 @@
         } \
     } while(0)
 
-#define _mm256_unpacklo_epi128(a, b) _mm256_permute2x128_si256(a, b, 2 << 4);
-#define _mm256_unpackhi_epi128(a, b) _mm256_permute2x128_si256(a, b, 1 | (3 << 4));
-
 enum RunName {
     RnStart = 0,
 
@@ -34,6 +39,54 @@ enum RunName {
     RnDecodeAVX2Float,
     RnEncodeAVX2Double,
     RnDecodeAVX2Double,
+    RnEncodeAVX512Float,
+    RnDecodeAVX512Float,
+    RnEncodeAVX512Double,
+    RnDecodeAVX512Double,
+    RnEncodeAVX512VbmiFloat,
+    RnDecodeAVX512VbmiFloat,
+    RnEncodeAVX512VbmiDouble,
+    RnDecodeAVX512VbmiDouble,
+    RnEncodeScalarHalf,
+    RnDecodeScalarHalf,
+    RnEncodeSimdHalf,
+    RnDecodeSimdHalf,
+    RnEncodeAVX2Half,
+    RnDecodeAVX2Half,
+    RnEncodeAVX512Half,
+    RnDecodeAVX512Half,
+    RnEncodeScalarInt24,
+    RnDecodeScalarInt24,
+    RnEncodeAVX2Int24,
+    RnDecodeAVX2Int24,
+    RnEncodeAVX512VbmiInt24,
+    RnDecodeAVX512VbmiInt24,
+    RnEncodeDispatchFloat,
+    RnDecodeDispatchFloat,
+    RnEncodeDispatchDouble,
+    RnDecodeDispatchDouble,
+    RnEncodeXorFloat,
+    RnDecodeXorFloat,
+    RnEncodeXorDouble,
+    RnDecodeXorDouble,
+    RnEncodeSubFloat,
+    RnDecodeSubFloat,
+    RnEncodeSubDouble,
+    RnDecodeSubDouble,
+    RnEncodeXorSplitFloat,
+    RnDecodeXorSplitFloat,
+    RnEncodeXorSplitDouble,
+    RnDecodeXorSplitDouble,
+    RnEncodeSubSplitFloat,
+    RnDecodeSubSplitFloat,
+    RnEncodeSubSplitDouble,
+    RnDecodeSubSplitDouble,
+    RnAdaptiveClassifyFloat,
+    RnAdaptiveClassifyDouble,
+    RnEncodeAdaptiveFloat,
+    RnDecodeAdaptiveFloat,
+    RnEncodeAdaptiveDouble,
+    RnDecodeAdaptiveDouble,
     RnEnd,
 
 };
@@ -66,12 +119,142 @@ const char* CovertRnNameToString(RunName name) {
             return "encode_avx2_double";
         case RnDecodeAVX2Double:
             return "decode_avx2_double";
+        case RnEncodeAVX512Float:
+            return "encode_avx512_float";
+        case RnDecodeAVX512Float:
+            return "decode_avx512_float";
+        case RnEncodeAVX512Double:
+            return "encode_avx512_double";
+        case RnDecodeAVX512Double:
+            return "decode_avx512_double";
+        case RnEncodeAVX512VbmiFloat:
+            return "encode_avx512_vbmi_float";
+        case RnDecodeAVX512VbmiFloat:
+            return "decode_avx512_vbmi_float";
+        case RnEncodeAVX512VbmiDouble:
+            return "encode_avx512_vbmi_double";
+        case RnDecodeAVX512VbmiDouble:
+            return "decode_avx512_vbmi_double";
+        case RnEncodeScalarHalf:
+            return "encode_scalar_half";
+        case RnDecodeScalarHalf:
+            return "decode_scalar_half";
+        case RnEncodeSimdHalf:
+            return "encode_simd_half";
+        case RnDecodeSimdHalf:
+            return "decode_simd_half";
+        case RnEncodeAVX2Half:
+            return "encode_avx2_half";
+        case RnDecodeAVX2Half:
+            return "decode_avx2_half";
+        case RnEncodeAVX512Half:
+            return "encode_avx512_half";
+        case RnDecodeAVX512Half:
+            return "decode_avx512_half";
+        case RnEncodeScalarInt24:
+            return "encode_scalar_int24";
+        case RnDecodeScalarInt24:
+            return "decode_scalar_int24";
+        case RnEncodeAVX2Int24:
+            return "encode_avx2_int24";
+        case RnDecodeAVX2Int24:
+            return "decode_avx2_int24";
+        case RnEncodeAVX512VbmiInt24:
+            return "encode_avx512_vbmi_int24";
+        case RnDecodeAVX512VbmiInt24:
+            return "decode_avx512_vbmi_int24";
+        case RnEncodeDispatchFloat:
+            return "encode_dispatch_float";
+        case RnDecodeDispatchFloat:
+            return "decode_dispatch_float";
+        case RnEncodeDispatchDouble:
+            return "encode_dispatch_double";
+        case RnDecodeDispatchDouble:
+            return "decode_dispatch_double";
+        case RnEncodeXorFloat:
+            return "delta_encode_xor_float";
+        case RnDecodeXorFloat:
+            return "delta_decode_xor_float";
+        case RnEncodeXorDouble:
+            return "delta_encode_xor_double";
+        case RnDecodeXorDouble:
+            return "delta_decode_xor_double";
+        case RnEncodeSubFloat:
+            return "delta_encode_sub_float";
+        case RnDecodeSubFloat:
+            return "delta_decode_sub_float";
+        case RnEncodeSubDouble:
+            return "delta_encode_sub_double";
+        case RnDecodeSubDouble:
+            return "delta_decode_sub_double";
+        case RnEncodeXorSplitFloat:
+            return "encode_xor_split_float";
+        case RnDecodeXorSplitFloat:
+            return "decode_xor_split_float";
+        case RnEncodeXorSplitDouble:
+            return "encode_xor_split_double";
+        case RnDecodeXorSplitDouble:
+            return "decode_xor_split_double";
+        case RnEncodeSubSplitFloat:
+            return "encode_sub_split_float";
+        case RnDecodeSubSplitFloat:
+            return "decode_sub_split_float";
+        case RnEncodeSubSplitDouble:
+            return "encode_sub_split_double";
+        case RnDecodeSubSplitDouble:
+            return "decode_sub_split_double";
+        case RnAdaptiveClassifyFloat:
+            return "adaptive_classify_float";
+        case RnAdaptiveClassifyDouble:
+            return "adaptive_classify_double";
+        case RnEncodeAdaptiveFloat:
+            return "encode_adaptive_float";
+        case RnDecodeAdaptiveFloat:
+            return "decode_adaptive_float";
+        case RnEncodeAdaptiveDouble:
+            return "encode_adaptive_double";
+        case RnDecodeAdaptiveDouble:
+            return "decode_adaptive_double";
         default:
             ASSERT(!"Unknown name");
             return NULL;
     }
 }
 
+// Returns the instruction set which the run needs.
+SimdLevel RequiredSimdLevel(RunName name) {
+    switch (name) {
+        case RnEncodeAVX2Float:
+        case RnDecodeAVX2Float:
+        case RnEncodeAVX2Double:
+        case RnDecodeAVX2Double:
+        case RnEncodeAVX2Half:
+        case RnDecodeAVX2Half:
+        case RnEncodeAVX2Int24:
+        case RnDecodeAVX2Int24:
+            return SimdAVX2;
+        case RnEncodeAVX512Float:
+        case RnDecodeAVX512Float:
+        case RnEncodeAVX512Double:
+        case RnDecodeAVX512Double:
+        case RnEncodeAVX512Half:
+        case RnDecodeAVX512Half:
+            return SimdAVX512BW;
+        case RnEncodeAVX512VbmiFloat:
+        case RnDecodeAVX512VbmiFloat:
+        case RnEncodeAVX512VbmiDouble:
+        case RnDecodeAVX512VbmiDouble:
+        case RnEncodeAVX512VbmiInt24:
+        case RnDecodeAVX512VbmiInt24:
+            return SimdAVX512;
+        default:
+            return SimdScalar;
+    }
+}
+
+// Block size of the ADAPTIVE_BYTE_STREAM_SPLIT runs.
+const size_t kAdaptiveBlockSize = 4096;
+
 static inline double gettime(void) {
     struct timespec ts = {0};
     int err = clock_gettime(CLOCK_MONOTONIC, &ts);
@@ -79,400 +262,26 @@ static inline double gettime(void) {
     return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
 }
 
-template<size_t type_size>
-void decode_scalar(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
-    for (size_t i = 0; i < num_elements; ++i) {
-        for (size_t k = 0; k < type_size; ++k) {
-            output_data[i * type_size + k] = input_data[k * num_elements + i];
-        }
-    }
-}
-
-template<size_t type_size>
-void encode_scalar(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
-    for (size_t i = 0; i < num_elements; ++i) {
-        for (size_t k = 0; k < type_size; ++k) {
-            output_data[k * num_elements + i] = input_data[i * type_size + k];
-        }
-    }
-}
-
-void encode_simd_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
-    // We will not handle the special case here and assume size is divisble 16 * 4.
-    __m128i s[4];
-    __m128i p[4];
-    for (size_t i = 0; i < num_elements * 4UL; i += 64UL) {
-        s[0] = _mm_loadu_si128((__m128i*)(input_data + i));
-        s[1] = _mm_loadu_si128((__m128i*)(input_data + i + 16UL));
-        s[2] = _mm_loadu_si128((__m128i*)(input_data + i + 32UL));
-        s[3] = _mm_loadu_si128((__m128i*)(input_data + i + 48UL));
-
-        p[0] = _mm_unpacklo_epi8(s[0], s[1]);
-        p[1] = _mm_unpackhi_epi8(s[0], s[1]);
-        p[2] = _mm_unpacklo_epi8(s[2], s[3]);
-        p[3] = _mm_unpackhi_epi8(s[2], s[3]);
-
-        s[0] = _mm_unpacklo_epi8(p[0], p[1]);
-        s[1] = _mm_unpackhi_epi8(p[0], p[1]);
-        s[2] = _mm_unpacklo_epi8(p[2], p[3]);
-        s[3] = _mm_unpackhi_epi8(p[2], p[3]);
-
-        p[0] = _mm_unpacklo_epi8(s[0], s[1]);
-        p[1] = _mm_unpackhi_epi8(s[0], s[1]);
-        p[2] = _mm_unpacklo_epi8(s[2], s[3]);
-        p[3] = _mm_unpackhi_epi8(s[2], s[3]);
-
-        s[0] = _mm_unpacklo_epi64(p[0], p[2]);
-        s[1] = _mm_unpackhi_epi64(p[0], p[2]);
-        s[2] = _mm_unpacklo_epi64(p[1], p[3]);
-        s[3] = _mm_unpackhi_epi64(p[1], p[3]);
-
-        size_t off = i / 4UL;
-        _mm_storeu_si128((__m128i*)(output_data + off), s[0]);
-        _mm_storeu_si128((__m128i*)(output_data + num_elements + off), s[1]);
-        _mm_storeu_si128((__m128i*)(output_data + num_elements*2 + off), s[2]);
-        _mm_storeu_si128((__m128i*)(output_data + num_elements*3 + off), s[3]);
-    }
-}
-
-void decode_simd_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
-    __m128i s[4];
-    __m128i p[4];
-    for (size_t i = 0; i < num_elements; i += 16UL) {
-        s[0] = _mm_loadu_si128((__m128i*)(input_data + i));
-        s[1] = _mm_loadu_si128((__m128i*)(input_data + num_elements + i));
-        s[2] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 2UL + i));
-        s[3] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 3UL + i));
-
-        p[0] = _mm_unpacklo_epi8(s[0], s[2]);
-        p[1] = _mm_unpackhi_epi8(s[0], s[2]);
-        p[2] = _mm_unpacklo_epi8(s[1], s[3]);
-        p[3] = _mm_unpackhi_epi8(s[1], s[3]);
-
-        s[0] = _mm_unpacklo_epi8(p[0], p[2]);
-        s[1] = _mm_unpackhi_epi8(p[0], p[2]);
-        s[2] = _mm_unpacklo_epi8(p[1], p[3]);
-        s[3] = _mm_unpackhi_epi8(p[1], p[3]);
-
-        size_t off = i * 4UL;
-        _mm_storeu_si128((__m128i*)(output_data + off), s[0]);
-        _mm_storeu_si128((__m128i*)(output_data + off + 16UL), s[1]);
-        _mm_storeu_si128((__m128i*)(output_data + off + 32UL), s[2]);
-        _mm_storeu_si128((__m128i*)(output_data + off + 48UL), s[3]);
-    }
-}
-
-void encode_simd_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
-    // We will not handle the special case here and assume size is divisble 16 * 8.
-    __m128i s[8];
-    __m128i p[8];
-    for (size_t i = 0; i < num_elements * 8UL; i += 128UL) {
-        s[0] = _mm_loadu_si128((__m128i*)(input_data + i));
-        s[1] = _mm_loadu_si128((__m128i*)(input_data + i + 16UL));
-        s[2] = _mm_loadu_si128((__m128i*)(input_data + i + 32UL));
-        s[3] = _mm_loadu_si128((__m128i*)(input_data + i + 48UL));
-        s[4] = _mm_loadu_si128((__m128i*)(input_data + i + 64UL));
-        s[5] = _mm_loadu_si128((__m128i*)(input_data + i + 80UL));
-        s[6] = _mm_loadu_si128((__m128i*)(input_data + i + 96UL));
-        s[7] = _mm_loadu_si128((__m128i*)(input_data + i + 112UL));
-
-        p[0] = _mm_unpacklo_epi8(s[0], s[1]);
-        p[1] = _mm_unpackhi_epi8(s[0], s[1]);
-        p[2] = _mm_unpacklo_epi8(s[2], s[3]);
-        p[3] = _mm_unpackhi_epi8(s[2], s[3]);
-        p[4] = _mm_unpacklo_epi8(s[4], s[5]);
-        p[5] = _mm_unpackhi_epi8(s[4], s[5]);
-        p[6] = _mm_unpacklo_epi8(s[6], s[7]);
-        p[7] = _mm_unpackhi_epi8(s[6], s[7]);
-
-        s[0] = _mm_unpacklo_epi8(p[0], p[1]);
-        s[1] = _mm_unpackhi_epi8(p[0], p[1]);
-        s[2] = _mm_unpacklo_epi8(p[2], p[3]);
-        s[3] = _mm_unpackhi_epi8(p[2], p[3]);
-        s[4] = _mm_unpacklo_epi8(p[4], p[5]);
-        s[5] = _mm_unpackhi_epi8(p[4], p[5]);
-        s[6] = _mm_unpacklo_epi8(p[6], p[7]);
-        s[7] = _mm_unpackhi_epi8(p[6], p[7]);
-
-        p[0] = _mm_unpacklo_epi32(s[0], s[4]);
-        p[1] = _mm_unpackhi_epi32(s[0], s[4]);
-        p[2] = _mm_unpacklo_epi32(s[1], s[5]);
-        p[3] = _mm_unpackhi_epi32(s[1], s[5]);
-        p[4] = _mm_unpacklo_epi32(s[2], s[6]);
-        p[5] = _mm_unpackhi_epi32(s[2], s[6]);
-        p[6] = _mm_unpacklo_epi32(s[3], s[7]);
-        p[7] = _mm_unpackhi_epi32(s[3], s[7]);
-
-        s[0] = _mm_unpacklo_epi32(p[0], p[4]);
-        s[1] = _mm_unpackhi_epi32(p[0], p[4]);
-        s[2] = _mm_unpacklo_epi32(p[1], p[5]);
-        s[3] = _mm_unpackhi_epi32(p[1], p[5]);
-        s[4] = _mm_unpacklo_epi32(p[2], p[6]);
-        s[5] = _mm_unpackhi_epi32(p[2], p[6]);
-        s[6] = _mm_unpacklo_epi32(p[3], p[7]);
-        s[7] = _mm_unpackhi_epi32(p[3], p[7]);
-
-        size_t off = i / 8UL;
-        _mm_storeu_si128((__m128i*)(output_data + off), s[0]);
-        _mm_storeu_si128((__m128i*)(output_data + num_elements + off), s[1]);
-        _mm_storeu_si128((__m128i*)(output_data + num_elements*2 + off), s[2]);
-        _mm_storeu_si128((__m128i*)(output_data + num_elements*3 + off), s[3]);
-        _mm_storeu_si128((__m128i*)(output_data + num_elements*4 + off), s[4]);
-        _mm_storeu_si128((__m128i*)(output_data + num_elements*5 + off), s[5]);
-        _mm_storeu_si128((__m128i*)(output_data + num_elements*6 + off), s[6]);
-        _mm_storeu_si128((__m128i*)(output_data + num_elements*7 + off), s[7]);
-    }
-}
-
-void decode_simd_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
-    __m128i s[8];
-    __m128i p[8];
-    for (size_t i = 0; i < num_elements; i += 16UL) {
-        s[0] = _mm_loadu_si128((__m128i*)(input_data + i));
-        s[1] = _mm_loadu_si128((__m128i*)(input_data + num_elements + i));
-        s[2] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 2UL + i));
-        s[3] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 3UL + i));
-        s[4] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 4UL + i));
-        s[5] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 5UL + i));
-        s[6] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 6UL + i));
-        s[7] = _mm_loadu_si128((__m128i*)(input_data + num_elements * 7UL + i));
-
-        p[0] = _mm_unpacklo_epi8(s[0], s[4]);
-        p[1] = _mm_unpackhi_epi8(s[0], s[4]);
-        p[2] = _mm_unpacklo_epi8(s[1], s[5]);
-        p[3] = _mm_unpackhi_epi8(s[1], s[5]);
-        p[4] = _mm_unpacklo_epi8(s[2], s[6]);
-        p[5] = _mm_unpackhi_epi8(s[2], s[6]);
-        p[6] = _mm_unpacklo_epi8(s[3], s[7]);
-        p[7] = _mm_unpackhi_epi8(s[3], s[7]);
-
-        s[0] = _mm_unpacklo_epi8(p[0], p[4]);
-        s[1] = _mm_unpackhi_epi8(p[0], p[4]);
-        s[2] = _mm_unpacklo_epi8(p[1], p[5]);
-        s[3] = _mm_unpackhi_epi8(p[1], p[5]);
-        s[4] = _mm_unpacklo_epi8(p[2], p[6]);
-        s[5] = _mm_unpackhi_epi8(p[2], p[6]);
-        s[6] = _mm_unpacklo_epi8(p[3], p[7]);
-        s[7] = _mm_unpackhi_epi8(p[3], p[7]);
-
-        p[0] = _mm_unpacklo_epi8(s[0], s[4]);
-        p[1] = _mm_unpackhi_epi8(s[0], s[4]);
-        p[2] = _mm_unpacklo_epi8(s[1], s[5]);
-        p[3] = _mm_unpackhi_epi8(s[1], s[5]);
-        p[4] = _mm_unpacklo_epi8(s[2], s[6]);
-        p[5] = _mm_unpackhi_epi8(s[2], s[6]);
-        p[6] = _mm_unpacklo_epi8(s[3], s[7]);
-        p[7] = _mm_unpackhi_epi8(s[3], s[7]);
-
-        size_t off = i * 8UL;
-        _mm_storeu_si128((__m128i*)(output_data + off), p[0]);
-        _mm_storeu_si128((__m128i*)(output_data + off + 16UL), p[1]);
-        _mm_storeu_si128((__m128i*)(output_data + off + 32UL), p[2]);
-        _mm_storeu_si128((__m128i*)(output_data + off + 48UL), p[3]);
-        _mm_storeu_si128((__m128i*)(output_data + off + 64UL), p[4]);
-        _mm_storeu_si128((__m128i*)(output_data + off + 80UL), p[5]);
-        _mm_storeu_si128((__m128i*)(output_data + off + 96UL), p[6]);
-        _mm_storeu_si128((__m128i*)(output_data + off + 112UL), p[7]);
-    }
-}
-
-void encode_avx2_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
-    // We will not handle the special case here and assume size is divisble 32 * 4.
-    __m256i s[4];
-    __m256i p[4];
-    for (size_t i = 0; i < num_elements * 4UL; i += 128UL) {
-        s[0] = _mm256_loadu_si256((__m256i*)(input_data + i));
-        s[1] = _mm256_loadu_si256((__m256i*)(input_data + i + 32UL));
-        s[2] = _mm256_loadu_si256((__m256i*)(input_data + i + 64UL));
-        s[3] = _mm256_loadu_si256((__m256i*)(input_data + i + 96UL));
-
-        p[0] = _mm256_unpacklo_epi8(s[0], s[1]);
-        p[1] = _mm256_unpackhi_epi8(s[0], s[1]);
-        p[2] = _mm256_unpacklo_epi8(s[2], s[3]);
-        p[3] = _mm256_unpackhi_epi8(s[2], s[3]);
-
-        s[0] = _mm256_unpacklo_epi8(p[0], p[1]);
-        s[1] = _mm256_unpackhi_epi8(p[0], p[1]);
-        s[2] = _mm256_unpacklo_epi8(p[2], p[3]);
-        s[3] = _mm256_unpackhi_epi8(p[2], p[3]);
-
-        p[0] = _mm256_unpacklo_epi8(s[0], s[1]);
-        p[1] = _mm256_unpackhi_epi8(s[0], s[1]);
-        p[2] = _mm256_unpacklo_epi8(s[2], s[3]);
-        p[3] = _mm256_unpackhi_epi8(s[2], s[3]);
-
-        s[0] = _mm256_unpacklo_epi128(p[0], p[2]);
-        s[1] = _mm256_unpackhi_epi128(p[0], p[2]);
-        s[2] = _mm256_unpacklo_epi128(p[1], p[3]);
-        s[3] = _mm256_unpackhi_epi128(p[1], p[3]);
-
-        p[0] = _mm256_unpacklo_epi32(s[0], s[1]);
-        p[1] = _mm256_unpackhi_epi32(s[0], s[1]);
-        p[2] = _mm256_unpacklo_epi32(s[2], s[3]);
-        p[3] = _mm256_unpackhi_epi32(s[2], s[3]);
-
-        size_t off = i / 4UL;
-        _mm256_storeu_si256((__m256i*)(output_data + off), p[0]);
-        _mm256_storeu_si256((__m256i*)(output_data + num_elements + off), p[1]);
-        _mm256_storeu_si256((__m256i*)(output_data + num_elements*2 + off), p[2]);
-        _mm256_storeu_si256((__m256i*)(output_data + num_elements*3 + off), p[3]);
-    }
-}
+// Warm runs measure the kernels on buffers which stay in the caches between the runs, as far
+// as they fit. Cold runs flush both buffers before every run, so each run starts from DRAM.
+enum CacheMode {
+    CacheWarm,
+    CacheCold,
+};
 
-void decode_avx2_float(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
-    __m256i s[4];
-    __m256i p[4];
-    for (size_t i = 0; i < num_elements; i += 32UL) {
-        s[0] = _mm256_loadu_si256((__m256i*)(input_data + i));
-        s[1] = _mm256_loadu_si256((__m256i*)(input_data + num_elements + i));
-        s[2] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 2UL + i));
-        s[3] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 3UL + i));
-
-        p[0] = _mm256_unpacklo_epi8(s[0], s[1]);
-        p[1] = _mm256_unpackhi_epi8(s[0], s[1]);
-        p[2] = _mm256_unpacklo_epi8(s[2], s[3]);
-        p[3] = _mm256_unpackhi_epi8(s[2], s[3]);
-
-        s[0] = _mm256_unpacklo_epi64(p[0], p[1]);
-        s[1] = _mm256_unpackhi_epi64(p[0], p[1]);
-        s[2] = _mm256_unpacklo_epi64(p[2], p[3]);
-        s[3] = _mm256_unpackhi_epi64(p[2], p[3]);
-
-        p[0] = _mm256_unpacklo_epi128(s[0], s[1]);
-        p[1] = _mm256_unpackhi_epi128(s[0], s[1]);
-        p[2] = _mm256_unpacklo_epi128(s[2], s[3]);
-        p[3] = _mm256_unpackhi_epi128(s[2], s[3]);
-
-        s[0] = _mm256_unpacklo_epi16(p[0], p[2]);
-        s[1] = _mm256_unpackhi_epi16(p[0], p[2]);
-        s[2] = _mm256_unpacklo_epi16(p[1], p[3]);
-        s[3] = _mm256_unpackhi_epi16(p[1], p[3]);
-
-        size_t off = i * 4UL;
-        _mm256_storeu_si256((__m256i*)(output_data + off), s[0]);
-        _mm256_storeu_si256((__m256i*)(output_data + off + 32UL), s[1]);
-        _mm256_storeu_si256((__m256i*)(output_data + off + 64UL), s[2]);
-        _mm256_storeu_si256((__m256i*)(output_data + off + 96UL), s[3]);
+static void flush_buf(const uint8_t *data, size_t num_bytes) {
+    for (size_t i = 0; i < num_bytes; i += 64) {
+        _mm_clflush(&data[i]);
     }
+    _mm_mfence();
 }
 
-void encode_avx2_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
-    // We will not handle the special case here and assume size is divisble 32 * 8.
-    __m256i s[8];
-    __m256i p[8];
-    for (size_t i = 0; i < num_elements * 8UL; i += 256UL) {
-        s[0] = _mm256_loadu_si256((__m256i*)(input_data + i));
-        s[1] = _mm256_loadu_si256((__m256i*)(input_data + i + 32UL));
-        s[2] = _mm256_loadu_si256((__m256i*)(input_data + i + 64UL));
-        s[3] = _mm256_loadu_si256((__m256i*)(input_data + i + 96UL));
-        s[4] = _mm256_loadu_si256((__m256i*)(input_data + i + 128UL));
-        s[5] = _mm256_loadu_si256((__m256i*)(input_data + i + 160UL));
-        s[6] = _mm256_loadu_si256((__m256i*)(input_data + i + 192UL));
-        s[7] = _mm256_loadu_si256((__m256i*)(input_data + i + 224UL));
-
-        p[0] = _mm256_unpacklo_epi128(s[0], s[4]);
-        p[1] = _mm256_unpackhi_epi128(s[0], s[4]);
-        p[2] = _mm256_unpacklo_epi128(s[1], s[5]);
-        p[3] = _mm256_unpackhi_epi128(s[1], s[5]);
-        p[4] = _mm256_unpacklo_epi128(s[2], s[6]);
-        p[5] = _mm256_unpackhi_epi128(s[2], s[6]);
-        p[6] = _mm256_unpacklo_epi128(s[3], s[7]);
-        p[7] = _mm256_unpackhi_epi128(s[3], s[7]);
-
-        s[0] = _mm256_unpacklo_epi8(p[0], p[4]);
-        s[1] = _mm256_unpackhi_epi8(p[0], p[4]);
-        s[2] = _mm256_unpacklo_epi8(p[1], p[5]);
-        s[3] = _mm256_unpackhi_epi8(p[1], p[5]);
-        s[4] = _mm256_unpacklo_epi8(p[2], p[6]);
-        s[5] = _mm256_unpackhi_epi8(p[2], p[6]);
-        s[6] = _mm256_unpacklo_epi8(p[3], p[7]);
-        s[7] = _mm256_unpackhi_epi8(p[3], p[7]);
-
-        p[0] = _mm256_unpacklo_epi8(s[0], s[4]);
-        p[1] = _mm256_unpackhi_epi8(s[0], s[4]);
-        p[2] = _mm256_unpacklo_epi8(s[1], s[5]);
-        p[3] = _mm256_unpackhi_epi8(s[1], s[5]);
-        p[4] = _mm256_unpacklo_epi8(s[2], s[6]);
-        p[5] = _mm256_unpackhi_epi8(s[2], s[6]);
-        p[6] = _mm256_unpacklo_epi8(s[3], s[7]);
-        p[7] = _mm256_unpackhi_epi8(s[3], s[7]);
-
-        s[0] = _mm256_unpacklo_epi8(p[0], p[4]);
-        s[1] = _mm256_unpackhi_epi8(p[0], p[4]);
-        s[2] = _mm256_unpacklo_epi8(p[1], p[5]);
-        s[3] = _mm256_unpackhi_epi8(p[1], p[5]);
-        s[4] = _mm256_unpacklo_epi8(p[2], p[6]);
-        s[5] = _mm256_unpackhi_epi8(p[2], p[6]);
-        s[6] = _mm256_unpacklo_epi8(p[3], p[7]);
-        s[7] = _mm256_unpackhi_epi8(p[3], p[7]);
-
-        p[0] = _mm256_unpacklo_epi8(s[0], s[4]);
-        p[1] = _mm256_unpackhi_epi8(s[0], s[4]);
-        p[2] = _mm256_unpacklo_epi8(s[1], s[5]);
-        p[3] = _mm256_unpackhi_epi8(s[1], s[5]);
-        p[4] = _mm256_unpacklo_epi8(s[2], s[6]);
-        p[5] = _mm256_unpackhi_epi8(s[2], s[6]);
-        p[6] = _mm256_unpacklo_epi8(s[3], s[7]);
-        p[7] = _mm256_unpackhi_epi8(s[3], s[7]);
-
-        size_t off = i / 8UL;
-        _mm256_storeu_si256((__m256i*)(output_data + off), p[0]);
-        _mm256_storeu_si256((__m256i*)(output_data + num_elements + off), p[1]);
-        _mm256_storeu_si256((__m256i*)(output_data + num_elements*2 + off), p[2]);
-        _mm256_storeu_si256((__m256i*)(output_data + num_elements*3 + off), p[3]);
-        _mm256_storeu_si256((__m256i*)(output_data + num_elements*4 + off), p[4]);
-        _mm256_storeu_si256((__m256i*)(output_data + num_elements*5 + off), p[5]);
-        _mm256_storeu_si256((__m256i*)(output_data + num_elements*6 + off), p[6]);
-        _mm256_storeu_si256((__m256i*)(output_data + num_elements*7 + off), p[7]);
-    }
-}
+// Set by -perf if the counters could be opened.
+PerfCounters *perf_counters = NULL;
 
-void decode_avx2_double(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {
-    __m256i s[8];
-    __m256i p[8];
-    const int permute_mask = (3U << 6) | (1U << 4) | (2U << 2) | (0U << 0);
-    for (size_t i = 0; i < num_elements; i += 32UL) {
-        s[0] = _mm256_loadu_si256((__m256i*)(input_data + i));
-        s[1] = _mm256_loadu_si256((__m256i*)(input_data + num_elements + i));
-        s[2] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 2UL + i));
-        s[3] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 3UL + i));
-        s[4] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 4UL + i));
-        s[5] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 5UL + i));
-        s[6] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 6UL + i));
-        s[7] = _mm256_loadu_si256((__m256i*)(input_data + num_elements * 7UL + i));
-
-        for (int i = 0; i < 4; ++i) {
-            p[2*i] = _mm256_unpacklo_epi128(s[i], s[i+4]);
-            p[2*i+1] = _mm256_unpackhi_epi128(s[i], s[i+4]);
-        }
-        for (int i = 0; i < 4; ++i) {
-            s[2*i] = _mm256_unpacklo_epi8(p[i], p[i+4]);
-            s[2*i+1] = _mm256_unpackhi_epi8(p[i], p[i+4]);
-        }
-        for (int i = 0; i < 4; ++i) {
-            p[2*i] = _mm256_unpacklo_epi8(s[i], s[i+4]);
-            p[2*i+1] = _mm256_unpackhi_epi8(s[i], s[i+4]);
-        }
-        for (int i = 0; i < 8; ++i) {
-            s[i] = _mm256_permute4x64_epi64(p[i], permute_mask);
-        }
-        for (int i = 0; i < 8; ++i) {
-            p[i] = _mm256_shuffle_epi32(s[i], permute_mask);
-        }
-
-        size_t off = i * 8UL;
-        _mm256_storeu_si256((__m256i*)(output_data + off), p[0]);
-        _mm256_storeu_si256((__m256i*)(output_data + off + 32UL), p[1]);
-        _mm256_storeu_si256((__m256i*)(output_data + off + 64UL), p[2]);
-        _mm256_storeu_si256((__m256i*)(output_data + off + 96UL), p[3]);
-        _mm256_storeu_si256((__m256i*)(output_data + off + 128UL), p[4]);
-        _mm256_storeu_si256((__m256i*)(output_data + off + 160UL), p[5]);
-        _mm256_storeu_si256((__m256i*)(output_data + off + 192UL), p[6]);
-        _mm256_storeu_si256((__m256i*)(output_data + off + 224UL), p[7]);
-    }
-}
-
-double benchmark_path(RunName name, const uint8_t *input, size_t num_bytes, uint8_t *output, const size_t num_runs)
+// Adds the hardware counters of the timed runs to perf_values if perf_counters is set.
+double benchmark_path(RunName name, const uint8_t *input, size_t num_bytes, uint8_t *output, const size_t num_runs,
+                      CacheMode cache_mode = CacheWarm, PerfCounterValues *perf_values = NULL)
 {
     size_t num_elements;
     switch(name) {
@@ -482,6 +291,23 @@ double benchmark_path(RunName name, const uint8_t *input, size_t num_bytes, uint
         case RnDecodeSimdFloat:
         case RnEncodeAVX2Float:
         case RnDecodeAVX2Float:
+        case RnEncodeAVX512Float:
+        case RnDecodeAVX512Float:
+        case RnEncodeAVX512VbmiFloat:
+        case RnDecodeAVX512VbmiFloat:
+        case RnEncodeDispatchFloat:
+        case RnDecodeDispatchFloat:
+        case RnEncodeXorFloat:
+        case RnDecodeXorFloat:
+        case RnEncodeSubFloat:
+        case RnDecodeSubFloat:
+        case RnEncodeXorSplitFloat:
+        case RnDecodeXorSplitFloat:
+        case RnEncodeSubSplitFloat:
+        case RnDecodeSubSplitFloat:
+        case RnAdaptiveClassifyFloat:
+        case RnEncodeAdaptiveFloat:
+        case RnDecodeAdaptiveFloat:
             num_elements = num_bytes / 4UL;
             break;
         case RnEncodeScalarDouble:
@@ -490,8 +316,43 @@ double benchmark_path(RunName name, const uint8_t *input, size_t num_bytes, uint
         case RnDecodeSimdDouble:
         case RnEncodeAVX2Double:
         case RnDecodeAVX2Double:
+        case RnEncodeAVX512Double:
+        case RnDecodeAVX512Double:
+        case RnEncodeAVX512VbmiDouble:
+        case RnDecodeAVX512VbmiDouble:
+        case RnEncodeDispatchDouble:
+        case RnDecodeDispatchDouble:
+        case RnEncodeXorDouble:
+        case RnDecodeXorDouble:
+        case RnEncodeSubDouble:
+        case RnDecodeSubDouble:
+        case RnEncodeXorSplitDouble:
+        case RnDecodeXorSplitDouble:
+        case RnEncodeSubSplitDouble:
+        case RnDecodeSubSplitDouble:
+        case RnAdaptiveClassifyDouble:
+        case RnEncodeAdaptiveDouble:
+        case RnDecodeAdaptiveDouble:
             num_elements = num_bytes / 8UL;
             break;
+        case RnEncodeScalarHalf:
+        case RnDecodeScalarHalf:
+        case RnEncodeSimdHalf:
+        case RnDecodeSimdHalf:
+        case RnEncodeAVX2Half:
+        case RnDecodeAVX2Half:
+        case RnEncodeAVX512Half:
+        case RnDecodeAVX512Half:
+            num_elements = num_bytes / 2UL;
+            break;
+        case RnEncodeScalarInt24:
+        case RnDecodeScalarInt24:
+        case RnEncodeAVX2Int24:
+        case RnDecodeAVX2Int24:
+        case RnEncodeAVX512VbmiInt24:
+        case RnDecodeAVX512VbmiInt24:
+            num_elements = num_bytes / 3UL;
+            break;
         case RnMemcpy:
             num_elements = num_bytes;
             break;
@@ -499,11 +360,21 @@ double benchmark_path(RunName name, const uint8_t *input, size_t num_bytes, uint
             ASSERT(!"Unknown name");
             return .0;
     }
-    // Warm-up the cache.
-    memcpy(output, input, num_bytes);
+    if (cache_mode == CacheWarm) {
+        // Warm-up the cache.
+        memcpy(output, input, num_bytes);
+    }
 
+    size_t classified_blocks = 0;
     double total_time = .0;
     for (size_t i = 0; i < num_runs; ++i) {
+        if (cache_mode == CacheCold) {
+            flush_buf(input, num_bytes);
+            flush_buf(output, num_bytes);
+        }
+        if (perf_counters != NULL && perf_values != NULL) {
+            perf_counters_start(perf_counters);
+        }
         double t1 = gettime();
         switch(name) {
             case RnMemcpy:
@@ -545,91 +416,421 @@ double benchmark_path(RunName name, const uint8_t *input, size_t num_bytes, uint
             case RnDecodeAVX2Double:
                 decode_avx2_double(input, num_elements, output);
                 break;
+            case RnEncodeAVX512Float:
+                encode_avx512_float(input, num_elements, output);
+                break;
+            case RnDecodeAVX512Float:
+                decode_avx512_float(input, num_elements, output);
+                break;
+            case RnEncodeAVX512Double:
+                encode_avx512_double(input, num_elements, output);
+                break;
+            case RnDecodeAVX512Double:
+                decode_avx512_double(input, num_elements, output);
+                break;
+            case RnEncodeAVX512VbmiFloat:
+                encode_avx512_vbmi_float(input, num_elements, output);
+                break;
+            case RnDecodeAVX512VbmiFloat:
+                decode_avx512_vbmi_float(input, num_elements, output);
+                break;
+            case RnEncodeAVX512VbmiDouble:
+                encode_avx512_vbmi_double(input, num_elements, output);
+                break;
+            case RnDecodeAVX512VbmiDouble:
+                decode_avx512_vbmi_double(input, num_elements, output);
+                break;
+            case RnEncodeScalarHalf:
+                encode_scalar<2>(input, num_elements, output);
+                break;
+            case RnDecodeScalarHalf:
+                decode_scalar<2>(input, num_elements, output);
+                break;
+            case RnEncodeSimdHalf:
+                encode_simd_half(input, num_elements, output);
+                break;
+            case RnDecodeSimdHalf:
+                decode_simd_half(input, num_elements, output);
+                break;
+            case RnEncodeAVX2Half:
+                encode_avx2_half(input, num_elements, output);
+                break;
+            case RnDecodeAVX2Half:
+                decode_avx2_half(input, num_elements, output);
+                break;
+            case RnEncodeAVX512Half:
+                encode_avx512_half(input, num_elements, output);
+                break;
+            case RnDecodeAVX512Half:
+                decode_avx512_half(input, num_elements, output);
+                break;
+            case RnEncodeScalarInt24:
+                encode_scalar<3>(input, num_elements, output);
+                break;
+            case RnDecodeScalarInt24:
+                decode_scalar<3>(input, num_elements, output);
+                break;
+            case RnEncodeAVX2Int24:
+                encode_avx2_int24(input, num_elements, output);
+                break;
+            case RnDecodeAVX2Int24:
+                decode_avx2_int24(input, num_elements, output);
+                break;
+            case RnEncodeAVX512VbmiInt24:
+                encode_avx512_vbmi_int24(input, num_elements, output);
+                break;
+            case RnDecodeAVX512VbmiInt24:
+                decode_avx512_vbmi_int24(input, num_elements, output);
+                break;
+            case RnEncodeDispatchFloat:
+                byte_stream_split_encode(input, num_elements, 4, output);
+                break;
+            case RnDecodeDispatchFloat:
+                byte_stream_split_decode(input, num_elements, 4, output);
+                break;
+            case RnEncodeDispatchDouble:
+                byte_stream_split_encode(input, num_elements, 8, output);
+                break;
+            case RnDecodeDispatchDouble:
+                byte_stream_split_decode(input, num_elements, 8, output);
+                break;
+            case RnEncodeXorFloat:
+                delta_encode(input, num_elements, 4, DeltaXor, output);
+                break;
+            case RnDecodeXorFloat:
+                delta_decode(input, num_elements, 4, DeltaXor, output);
+                break;
+            case RnEncodeXorDouble:
+                delta_encode(input, num_elements, 8, DeltaXor, output);
+                break;
+            case RnDecodeXorDouble:
+                delta_decode(input, num_elements, 8, DeltaXor, output);
+                break;
+            case RnEncodeSubFloat:
+                delta_encode(input, num_elements, 4, DeltaSub, output);
+                break;
+            case RnDecodeSubFloat:
+                delta_decode(input, num_elements, 4, DeltaSub, output);
+                break;
+            case RnEncodeSubDouble:
+                delta_encode(input, num_elements, 8, DeltaSub, output);
+                break;
+            case RnDecodeSubDouble:
+                delta_decode(input, num_elements, 8, DeltaSub, output);
+                break;
+            case RnEncodeXorSplitFloat:
+                byte_stream_split_encode_delta(input, num_elements, 4, DeltaXor, output);
+                break;
+            case RnDecodeXorSplitFloat:
+                byte_stream_split_decode_delta(input, num_elements, 4, DeltaXor, output);
+                break;
+            case RnEncodeXorSplitDouble:
+                byte_stream_split_encode_delta(input, num_elements, 8, DeltaXor, output);
+                break;
+            case RnDecodeXorSplitDouble:
+                byte_stream_split_decode_delta(input, num_elements, 8, DeltaXor, output);
+                break;
+            case RnEncodeSubSplitFloat:
+                byte_stream_split_encode_delta(input, num_elements, 4, DeltaSub, output);
+                break;
+            case RnDecodeSubSplitFloat:
+                byte_stream_split_decode_delta(input, num_elements, 4, DeltaSub, output);
+                break;
+            case RnEncodeSubSplitDouble:
+                byte_stream_split_encode_delta(input, num_elements, 8, DeltaSub, output);
+                break;
+            case RnDecodeSubSplitDouble:
+                byte_stream_split_decode_delta(input, num_elements, 8, DeltaSub, output);
+                break;
+            case RnAdaptiveClassifyFloat:
+                for (size_t b = 0; b < num_elements; b += kAdaptiveBlockSize) {
+                    classified_blocks += adaptive_byte_stream_split_classify(input + b * 4, std::min(kAdaptiveBlockSize, num_elements - b), 4);
+                }
+                break;
+            case RnAdaptiveClassifyDouble:
+                for (size_t b = 0; b < num_elements; b += kAdaptiveBlockSize) {
+                    classified_blocks += adaptive_byte_stream_split_classify(input + b * 8, std::min(kAdaptiveBlockSize, num_elements - b), 8);
+                }
+                break;
+            case RnEncodeAdaptiveFloat:
+                adaptive_byte_stream_split_encode(input, num_elements, 4, kAdaptiveBlockSize, output);
+                break;
+            case RnDecodeAdaptiveFloat:
+                adaptive_byte_stream_split_decode(input, num_elements, 4, kAdaptiveBlockSize, output);
+                break;
+            case RnEncodeAdaptiveDouble:
+                adaptive_byte_stream_split_encode(input, num_elements, 8, kAdaptiveBlockSize, output);
+                break;
+            case RnDecodeAdaptiveDouble:
+                adaptive_byte_stream_split_decode(input, num_elements, 8, kAdaptiveBlockSize, output);
+                break;
             default:
                 ASSERT(!"Unknown name");
                 return .0;
         }
         double t2 = gettime();
+        if (perf_counters != NULL && perf_values != NULL) {
+            perf_counters_stop(perf_counters, perf_values);
+        }
         total_time += (t2 - t1);
     }
+    // Keeps the classifier from being optimized away.
+    ASSERT(classified_blocks <= num_runs * num_elements);
     const uint64_t total_bytes_processed = num_runs * num_bytes;
     const double avg_bytes_per_s = total_bytes_processed / total_time;
     const double avg_gibs_per_s = avg_bytes_per_s / (1024.0 * 1024.0 * 1024.0);
     return avg_gibs_per_s;
 }
 
-void test_all_encodings() {
-    const size_t num_bytes = 1024 * 1024;
-    const size_t num_elements_float = num_bytes / 4UL;
-    const size_t num_elements_double = num_bytes / 8UL;
-    uint8_t *input = (uint8_t*)malloc(num_bytes);
-    uint8_t *expected_output_float = (uint8_t*)malloc(num_bytes);
-    uint8_t *expected_output_double = (uint8_t*)malloc(num_bytes);
+struct KernelTest {
+    const char *name;
+    size_t type_size;
+    bool is_encode;
+    SplitKernel kernel;
+    SimdLevel required_level;
+};
+
+const KernelTest kernel_tests[] = {
+    {"encode_simd_float", 4, true, encode_simd_float, SimdSSE},
+    {"decode_simd_float", 4, false, decode_simd_float, SimdSSE},
+    {"encode_simd_double", 8, true, encode_simd_double, SimdSSE},
+    {"decode_simd_double", 8, false, decode_simd_double, SimdSSE},
+    {"encode_avx2_float", 4, true, encode_avx2_float, SimdAVX2},
+    {"decode_avx2_float", 4, false, decode_avx2_float, SimdAVX2},
+    {"encode_avx2_double", 8, true, encode_avx2_double, SimdAVX2},
+    {"decode_avx2_double", 8, false, decode_avx2_double, SimdAVX2},
+    {"encode_avx512_float", 4, true, encode_avx512_float, SimdAVX512BW},
+    {"decode_avx512_float", 4, false, decode_avx512_float, SimdAVX512BW},
+    {"encode_avx512_double", 8, true, encode_avx512_double, SimdAVX512BW},
+    {"decode_avx512_double", 8, false, decode_avx512_double, SimdAVX512BW},
+    {"encode_avx512_vbmi_float", 4, true, encode_avx512_vbmi_float, SimdAVX512},
+    {"decode_avx512_vbmi_float", 4, false, decode_avx512_vbmi_float, SimdAVX512},
+    {"encode_avx512_vbmi_double", 8, true, encode_avx512_vbmi_double, SimdAVX512},
+    {"decode_avx512_vbmi_double", 8, false, decode_avx512_vbmi_double, SimdAVX512},
+    {"encode_simd_half", 2, true, encode_simd_half, SimdSSE},
+    {"decode_simd_half", 2, false, decode_simd_half, SimdSSE},
+    {"encode_avx2_half", 2, true, encode_avx2_half, SimdAVX2},
+    {"decode_avx2_half", 2, false, decode_avx2_half, SimdAVX2},
+    {"encode_avx512_half", 2, true, encode_avx512_half, SimdAVX512BW},
+    {"decode_avx512_half", 2, false, decode_avx512_half, SimdAVX512BW},
+    {"encode_avx2_int24", 3, true, encode_avx2_int24, SimdAVX2},
+    {"decode_avx2_int24", 3, false, decode_avx2_int24, SimdAVX2},
+    {"encode_avx512_vbmi_int24", 3, true, encode_avx512_vbmi_int24, SimdAVX512},
+    {"decode_avx512_vbmi_int24", 3, false, decode_avx512_vbmi_int24, SimdAVX512},
+};
+
+// Reference for the delta transforms: XOR or wrapping subtraction of the predecessor.
+template<typename T>
+void delta_encode_reference(const uint8_t *input_data, size_t num_elements, DeltaTransform transform, uint8_t *output_data) {
+    const T *input = (const T*)input_data;
+    T *output = (T*)output_data;
+    for (size_t i = 0; i < num_elements; ++i) {
+        const T previous = i > 0 ? input[i - 1] : 0;
+        output[i] = transform == DeltaXor ? input[i] ^ previous : input[i] - previous;
+    }
+}
+
+// Checks the delta transforms against the reference, alone and composed with the split.
+void test_delta_transforms(const uint8_t *input, size_t num_bytes) {
+    uint8_t *expected = (uint8_t*)malloc(num_bytes);
     uint8_t *output = (uint8_t*)malloc(num_bytes);
-    srand(1337);
-    for (size_t i = 0; i < num_bytes; ++i) {
-        input[i] = (uint8_t)rand();
+    uint8_t *decoded = (uint8_t*)malloc(num_bytes);
+    const DeltaTransform transforms[] = {DeltaXor, DeltaSub};
+    const size_t type_sizes[] = {2, 4, 8};
+    for (size_t t = 0; t < 2; ++t) {
+        for (size_t s = 0; s < sizeof(type_sizes) / sizeof(type_sizes[0]); ++s) {
+            const DeltaTransform transform = transforms[t];
+            const size_t type_size = type_sizes[s];
+            const size_t num_elements = num_bytes / type_size;
+            if (type_size == 2) {
+                delta_encode_reference<uint16_t>(input, num_elements, transform, expected);
+            } else if (type_size == 4) {
+                delta_encode_reference<uint32_t>(input, num_elements, transform, expected);
+            } else {
+                delta_encode_reference<uint64_t>(input, num_elements, transform, expected);
+            }
+            memset(output, 0, num_bytes);
+            delta_encode(input, num_elements, type_size, transform, output);
+            ASSERT(memcmp(expected, output, num_bytes) == 0);
+            delta_decode(expected, num_elements, type_size, transform, decoded);
+            ASSERT(memcmp(input, decoded, num_bytes) == 0);
+
+            byte_stream_split_encode(expected, num_elements, type_size, decoded);
+            memset(output, 0, num_bytes);
+            byte_stream_split_encode_delta(input, num_elements, type_size, transform, output);
+            ASSERT(memcmp(decoded, output, num_bytes) == 0);
+            byte_stream_split_decode_delta(output, num_elements, type_size, transform, decoded);
+            ASSERT(memcmp(input, decoded, num_bytes) == 0);
+        }
     }
-    encode_scalar<4>(input, num_elements_float, expected_output_float);
-    encode_scalar<8>(input, num_elements_double, expected_output_double);
+    free(expected);
+    free(output);
+    free(decoded);
+}
 
-    // Check that the decode_scalar works correctly.
-    decode_scalar<4>(expected_output_float, num_elements_float, output);
-    if (memcmp(input, output, num_bytes)) {
-        ASSERT(!"encode_float or decode_flaot failed");
+// Round-trips ADAPTIVE_BYTE_STREAM_SPLIT for several block sizes. The first half of the input
+// is made of runs of repeated values, so that both block types occur.
+void test_adaptive(const uint8_t *random, size_t num_bytes) {
+    const size_t block_sizes[] = {1, 7, 64, 4096, 100000};
+    uint8_t *input = (uint8_t*)malloc(num_bytes);
+    uint8_t *decoded = (uint8_t*)malloc(num_bytes);
+    memcpy(input, random, num_bytes);
+    for (size_t i = 0; i < num_bytes / 2; ++i) {
+        input[i] = random[i / 64];
+    }
+    const size_t type_sizes[] = {2, 3, 4, 8};
+    for (size_t s = 0; s < sizeof(type_sizes) / sizeof(type_sizes[0]); ++s) {
+        const size_t type_size = type_sizes[s];
+        const size_t num_elements = num_bytes / type_size;
+        for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); ++b) {
+            const size_t encoded_size = adaptive_byte_stream_split_encoded_size(num_elements, type_size, block_sizes[b]);
+            uint8_t *encoded = (uint8_t*)malloc(encoded_size);
+            adaptive_byte_stream_split_encode(input, num_elements, type_size, block_sizes[b], encoded);
+            memset(decoded, 0, num_bytes);
+            adaptive_byte_stream_split_decode(encoded, num_elements, type_size, block_sizes[b], decoded);
+            ASSERT(memcmp(input, decoded, num_elements * type_size) == 0);
+            free(encoded);
+        }
     }
-    decode_scalar<8>(expected_output_double, num_elements_double, output);
-    if (memcmp(input, output, num_bytes)) {
-        ASSERT(!"encode_double or decode_double failed");
+    // Runs of one value stay PLAIN and random values are split.
+    if (num_bytes >= 8192) {
+        ASSERT(!adaptive_byte_stream_split_classify(input, 1024, 4));
+        ASSERT(adaptive_byte_stream_split_classify(random, 1024, 4));
     }
+    free(input);
+    free(decoded);
+}
+
+// The type sizes which have SIMD kernels.
+const size_t kTypeSizes[] = {2, 3, 4, 8};
 
-    // Check that encode_simd_float and decode_simd_float work correctly.
-    encode_simd_float(input, num_elements_float, output);
-    if (memcmp(expected_output_float, output, num_bytes)) {
-        ASSERT(!"encode_simd_float failed");
+void encode_reference(const uint8_t *input_data, size_t num_elements, size_t type_size, uint8_t *output_data) {
+    switch (type_size) {
+        case 2: encode_scalar<2>(input_data, num_elements, output_data); break;
+        case 3: encode_scalar<3>(input_data, num_elements, output_data); break;
+        case 4: encode_scalar<4>(input_data, num_elements, output_data); break;
+        case 8: encode_scalar<8>(input_data, num_elements, output_data); break;
+        default: ASSERT(!"Unknown type size");
     }
-    decode_simd_float(expected_output_float, num_elements_float, output);
-    if (memcmp(input, output, num_bytes)) {
-        ASSERT(!"decode_simd_float failed");
+}
+
+void decode_reference(const uint8_t *input_data, size_t num_elements, size_t type_size, uint8_t *output_data) {
+    switch (type_size) {
+        case 2: decode_scalar<2>(input_data, num_elements, output_data); break;
+        case 3: decode_scalar<3>(input_data, num_elements, output_data); break;
+        case 4: decode_scalar<4>(input_data, num_elements, output_data); break;
+        case 8: decode_scalar<8>(input_data, num_elements, output_data); break;
+        default: ASSERT(!"Unknown type size");
     }
+}
 
-    // Check that encode_simd_double and decode_simd_double work correctly.
-    encode_simd_double(input, num_elements_double, output);
-    if (memcmp(expected_output_double, output, num_bytes)) {
-        ASSERT(!"encode_simd_double failed");
+// Checks every kernel against the scalar reference.
+// The sizes which are not a multiple of the block sizes exercise the tail paths.
+void test_all_encodings_with_size(size_t num_bytes) {
+    uint8_t *input = (uint8_t*)malloc(num_bytes);
+    uint8_t *output = (uint8_t*)malloc(num_bytes);
+    // Indexed by the type size. Only the first num_elements * type_size bytes are compared.
+    uint8_t *expected_outputs[9] = {NULL};
+    size_t num_elements_of[9] = {0};
+    srand(1337);
+    for (size_t i = 0; i < num_bytes; ++i) {
+        input[i] = (uint8_t)rand();
     }
-    decode_simd_double(expected_output_double, num_elements_double, output);
-    if (memcmp(input, output, num_bytes)) {
-        ASSERT(!"decode_simd_double failed");
+    for (size_t t = 0; t < sizeof(kTypeSizes) / sizeof(kTypeSizes[0]); ++t) {
+        const size_t type_size = kTypeSizes[t];
+        const size_t num_elements = num_bytes / type_size;
+        num_elements_of[type_size] = num_elements;
+        expected_outputs[type_size] = (uint8_t*)malloc(num_bytes);
+        encode_reference(input, num_elements, type_size, expected_outputs[type_size]);
+
+        // Check that the decode_scalar works correctly.
+        decode_reference(expected_outputs[type_size], num_elements, type_size, output);
+        if (memcmp(input, output, num_elements * type_size)) {
+            printf("encode_scalar or decode_scalar failed for type size %zu\n", type_size);
+            ASSERT(!"encode_scalar or decode_scalar failed");
+        }
     }
 
-    // Check that encode_avx2_float and decode_avx2_float work correctly.
-    encode_avx2_float(input, num_elements_float, output);
-    if (memcmp(expected_output_float, output, num_bytes)) {
-        ASSERT(!"encode_avx2_float failed");
-    }
-    decode_avx2_float(expected_output_float, num_elements_float, output);
-    if (memcmp(input, output, num_bytes)) {
-        ASSERT(!"decode_avx2_float failed");
+    for (size_t i = 0; i < sizeof(kernel_tests) / sizeof(kernel_tests[0]); ++i) {
+        const KernelTest &test = kernel_tests[i];
+        if (test.required_level > get_simd_level()) {
+            continue;
+        }
+        const size_t num_elements = num_elements_of[test.type_size];
+        const uint8_t *encoded = expected_outputs[test.type_size];
+        memset(output, 0, num_bytes);
+        if (test.is_encode) {
+            test.kernel(input, num_elements, output);
+            if (memcmp(encoded, output, num_elements * test.type_size)) {
+                printf("%s failed for %zu bytes\n", test.name, num_bytes);
+                ASSERT(!"encode failed");
+            }
+        } else {
+            test.kernel(encoded, num_elements, output);
+            if (memcmp(input, output, num_elements * test.type_size)) {
+                printf("%s failed for %zu bytes\n", test.name, num_bytes);
+                ASSERT(!"decode failed");
+            }
+        }
     }
 
-    // Check that encode_avx2_double and decode_avx2_double work correctly.
-    encode_avx2_double(input, num_elements_double, output);
-    if (memcmp(expected_output_double, output, num_bytes)) {
-        ASSERT(!"encode_avx2_double failed");
+    for (size_t t = 0; t < sizeof(kTypeSizes) / sizeof(kTypeSizes[0]); ++t) {
+        const size_t type_size = kTypeSizes[t];
+        const size_t num_elements = num_elements_of[type_size];
+        const uint8_t *encoded = expected_outputs[type_size];
+        const size_t size = num_elements * type_size;
+
+        memset(output, 0, num_bytes);
+        byte_stream_split_encode(input, num_elements, type_size, output);
+        ASSERT(memcmp(encoded, output, size) == 0);
+        byte_stream_split_decode(encoded, num_elements, type_size, output);
+        ASSERT(memcmp(input, output, size) == 0);
+
+        // The parallel kernels split the elements at different points for every thread count.
+        for (size_t num_threads = 1; num_threads <= 4; ++num_threads) {
+            memset(output, 0, num_bytes);
+            byte_stream_split_encode_parallel(input, num_elements, type_size, output, num_threads);
+            ASSERT(memcmp(encoded, output, size) == 0);
+            byte_stream_split_decode_parallel(encoded, num_elements, type_size, output, num_threads);
+            ASSERT(memcmp(input, output, size) == 0);
+        }
+
+        memset(output, 0, num_bytes);
+        byte_stream_split_encode_tiled(input, num_elements, type_size, output);
+        ASSERT(memcmp(encoded, output, size) == 0);
+        byte_stream_split_decode_tiled(encoded, num_elements, type_size, output);
+        ASSERT(memcmp(input, output, size) == 0);
     }
-    decode_avx2_double(expected_output_double, num_elements_double, output);
-    if (memcmp(input, output, num_bytes)) {
-        for (size_t i = 0; i < 256; ++i) {
-            printf("%u\n", output[i]);
+
+    for (size_t i = 0; i < sizeof(generated_kernels) / sizeof(generated_kernels[0]); ++i) {
+        const GeneratedKernel &kernel = generated_kernels[i];
+        if (kernel.required_level > get_simd_level()) {
+            continue;
+        }
+        const size_t num_elements = num_elements_of[kernel.type_size];
+        const uint8_t *encoded = expected_outputs[kernel.type_size];
+        memset(output, 0, num_bytes);
+        kernel.kernel(kernel.is_encode ? input : encoded, num_elements, output);
+        if (memcmp(kernel.is_encode ? encoded : input, output, num_elements * kernel.type_size)) {
+            printf("%s failed for %zu bytes\n", kernel.name, num_bytes);
+            ASSERT(!"generated kernel failed");
         }
-        ASSERT(!"decode_avx2_double failed");
     }
 
+    test_delta_transforms(input, num_bytes);
+    test_adaptive(input, num_bytes);
+
     free(input);
     free(output);
-    free(expected_output_float);
-    free(expected_output_double);
+    for (size_t t = 0; t < sizeof(kTypeSizes) / sizeof(kTypeSizes[0]); ++t) {
+        free(expected_outputs[kTypeSizes[t]]);
+    }
+}
+
+void test_all_encodings() {
+    test_all_encodings_with_size(1024 * 1024);
+    test_all_encodings_with_size(1024 * 1024 + 8 * 37);
+    test_all_encodings_with_size(8 * 5);
 }
 
 void benchmark_all_encodings() {
@@ -638,24 +839,330 @@ void benchmark_all_encodings() {
     const size_t num_runs = 4096;
     printf("Testing %zu MiB.\n", size_MiB);
     printf("Averaging over %zu runs.\n", num_runs);
-    uint8_t *input = (uint8_t*)malloc(num_bytes);
-    uint8_t *output = (uint8_t*)malloc(num_bytes);
+    // The adaptive encoding adds a bitmap of the block types to the values.
+    const size_t slack = adaptive_byte_stream_split_encoded_size(num_bytes / 4, 4, kAdaptiveBlockSize) - num_bytes;
+    uint8_t *input = (uint8_t*)malloc(num_bytes + slack);
+    uint8_t *output = (uint8_t*)malloc(num_bytes + slack);
     srand(1337);
     for (size_t i = 0; i < num_bytes; ++i) {
         input[i] = (uint8_t)rand();
     }
+    printf("Dispatching to %s kernels.\n", simd_level_to_string(get_simd_level()));
     for (size_t i = RnStart; i < RnEnd; ++i) {
         RunName name = (RunName)i;
         const char *name_s = CovertRnNameToString(name);
-        double avg_gibs_per_s = benchmark_path(name, input, num_bytes, output, num_runs);
-        printf("%s: %lf GiB/s\n", name_s, avg_gibs_per_s);
+        if (RequiredSimdLevel(name) > get_simd_level()) {
+            printf("%s: not supported\n", name_s);
+            continue;
+        }
+        PerfCounterValues perf_values;
+        perf_counters_clear(&perf_values);
+        double avg_gibs_per_s = benchmark_path(name, input, num_bytes, output, num_runs, CacheWarm, &perf_values);
+        if (perf_counters != NULL) {
+            char counters[256];
+            perf_counters_format(&perf_values, num_runs * num_bytes, counters, sizeof(counters));
+            printf("%s: %lf GiB/s, %s\n", name_s, avg_gibs_per_s, counters);
+        } else {
+            printf("%s: %lf GiB/s\n", name_s, avg_gibs_per_s);
+        }
+    }
+    free(input);
+    free(output);
+}
+
+// Measures every generated kernel, so the networks are compared by throughput and not only
+// by their number of commands.
+void benchmark_generated_kernels() {
+    const size_t num_bytes = 1024 * 1024;
+    const size_t num_runs = 1024;
+    const size_t num_kernels = sizeof(generated_kernels) / sizeof(generated_kernels[0]);
+    printf("Generated kernels of %zu networks, 1 MiB, averaging over %zu runs.\n", num_kernels, num_runs);
+    uint8_t *input = (uint8_t*)malloc(num_bytes);
+    uint8_t *output = (uint8_t*)malloc(num_bytes);
+    srand(1337);
+    for (size_t i = 0; i < num_bytes; ++i) {
+        input[i] = (uint8_t)rand();
+    }
+    for (size_t i = 0; i < num_kernels; ++i) {
+        const GeneratedKernel &kernel = generated_kernels[i];
+        if (kernel.required_level > get_simd_level()) {
+            printf("%s: not supported\n", kernel.name);
+            continue;
+        }
+        const size_t num_elements = num_bytes / kernel.type_size;
+        memcpy(output, input, num_bytes);
+        double total_time = .0;
+        for (size_t r = 0; r < num_runs; ++r) {
+            double t1 = gettime();
+            kernel.kernel(input, num_elements, output);
+            double t2 = gettime();
+            total_time += (t2 - t1);
+        }
+        printf("%s: %zu commands, %lf GiB/s\n", kernel.name, kernel.num_commands,
+               num_runs * num_bytes / total_time / (1024.0 * 1024.0 * 1024.0));
+    }
+    free(input);
+    free(output);
+}
+
+double benchmark_parallel(bool is_encode, size_t type_size, const uint8_t *input, size_t num_bytes, uint8_t *output,
+                          size_t num_threads, size_t num_runs) {
+    const size_t num_elements = num_bytes / type_size;
+    double total_time = .0;
+    for (size_t i = 0; i < num_runs; ++i) {
+        double t1 = gettime();
+        if (is_encode) {
+            byte_stream_split_encode_parallel(input, num_elements, type_size, output, num_threads);
+        } else {
+            byte_stream_split_decode_parallel(input, num_elements, type_size, output, num_threads);
+        }
+        double t2 = gettime();
+        total_time += (t2 - t1);
+    }
+    return num_runs * num_bytes / total_time / (1024.0 * 1024.0 * 1024.0);
+}
+
+// Scales the dispatched kernels from 1 to N threads on a buffer much larger than the caches,
+// to see where DRAM bandwidth saturates.
+void benchmark_scaling() {
+    const size_t size_MiB = 64;
+    const size_t num_bytes = size_MiB * 1024 * 1024;
+    const size_t num_runs = 16;
+    size_t max_threads = std::thread::hardware_concurrency();
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+    printf("Scaling over %zu MiB with 1 to %zu threads.\n", size_MiB, max_threads);
+    printf("Averaging over %zu runs.\n", num_runs);
+    uint8_t *input = (uint8_t*)malloc(num_bytes);
+    uint8_t *output = (uint8_t*)malloc(num_bytes);
+    // Place the pages where the threads of the widest run will access them.
+    byte_stream_split_first_touch(input, num_bytes / 4UL, 4, false, max_threads);
+    byte_stream_split_first_touch(output, num_bytes / 4UL, 4, true, max_threads);
+    srand(1337);
+    for (size_t i = 0; i < num_bytes; ++i) {
+        input[i] = (uint8_t)rand();
+    }
+    double base[4] = {.0};
+    for (size_t num_threads = 1; num_threads <= max_threads; ++num_threads) {
+        // Past 8 threads only the powers of two and the maximum are interesting.
+        if (num_threads > 8 && (num_threads & (num_threads - 1)) != 0 && num_threads != max_threads) {
+            continue;
+        }
+        const double gibs[4] = {
+            benchmark_parallel(true, 4, input, num_bytes, output, num_threads, num_runs),
+            benchmark_parallel(false, 4, input, num_bytes, output, num_threads, num_runs),
+            benchmark_parallel(true, 8, input, num_bytes, output, num_threads, num_runs),
+            benchmark_parallel(false, 8, input, num_bytes, output, num_threads, num_runs),
+        };
+        if (num_threads == 1) {
+            for (size_t i = 0; i < 4; ++i) {
+                base[i] = gibs[i];
+            }
+        }
+        printf("threads %zu: encode_float %lf GiB/s (%.2fx), decode_float %lf GiB/s (%.2fx), "
+               "encode_double %lf GiB/s (%.2fx), decode_double %lf GiB/s (%.2fx)\n",
+               num_threads, gibs[0], gibs[0] / base[0], gibs[1], gibs[1] / base[1],
+               gibs[2], gibs[2] / base[2], gibs[3], gibs[3] / base[3]);
     }
     free(input);
     free(output);
 }
 
-int main() {
+double benchmark_tiled_path(bool is_tiled, bool is_encode, size_t type_size, const uint8_t *input, size_t num_bytes,
+                            uint8_t *output, size_t num_runs) {
+    const size_t num_elements = num_bytes / type_size;
+    double total_time = .0;
+    for (size_t i = 0; i < num_runs; ++i) {
+        double t1 = gettime();
+        if (is_tiled && is_encode) {
+            byte_stream_split_encode_tiled(input, num_elements, type_size, output);
+        } else if (is_tiled) {
+            byte_stream_split_decode_tiled(input, num_elements, type_size, output);
+        } else if (is_encode) {
+            byte_stream_split_encode(input, num_elements, type_size, output);
+        } else {
+            byte_stream_split_decode(input, num_elements, type_size, output);
+        }
+        double t2 = gettime();
+        total_time += (t2 - t1);
+    }
+    return num_runs * num_bytes / total_time / (1024.0 * 1024.0 * 1024.0);
+}
+
+// Compares the dispatched kernels with the tiled ones which use non-temporal stores,
+// from a size which fits into L2 to one which is far larger than L3.
+void benchmark_tiling() {
+    const size_t sizes_MiB[] = {1, 64, 1024};
+    for (size_t s = 0; s < sizeof(sizes_MiB) / sizeof(sizes_MiB[0]); ++s) {
+        const size_t num_bytes = sizes_MiB[s] * 1024 * 1024;
+        // Process 4 GiB per measurement, but at least 4 runs.
+        const size_t num_runs = std::max<size_t>(4, 4 * 1024 / sizes_MiB[s]);
+        printf("Tiling %zu MiB, averaging over %zu runs.\n", sizes_MiB[s], num_runs);
+        uint8_t *input = (uint8_t*)malloc(num_bytes);
+        uint8_t *output = (uint8_t*)malloc(num_bytes);
+        ASSERT(input != NULL && output != NULL);
+        srand(1337);
+        for (size_t i = 0; i < num_bytes; ++i) {
+            input[i] = (uint8_t)rand();
+        }
+        memset(output, 0, num_bytes);
+        double total_time = .0;
+        for (size_t i = 0; i < num_runs; ++i) {
+            double t1 = gettime();
+            memcpy(output, input, num_bytes);
+            total_time += gettime() - t1;
+        }
+        printf("memcpy: %lf GiB/s\n", num_runs * num_bytes / total_time / (1024.0 * 1024.0 * 1024.0));
+        const char *kernel_names[] = {"decode_float", "encode_float", "decode_double", "encode_double"};
+        for (size_t k = 0; k < 4; ++k) {
+            const bool is_encode = k % 2 == 1;
+            const size_t type_size = k < 2 ? 4 : 8;
+            const double current = benchmark_tiled_path(false, is_encode, type_size, input, num_bytes, output, num_runs);
+            const double tiled = benchmark_tiled_path(true, is_encode, type_size, input, num_bytes, output, num_runs);
+            printf("%s: %lf GiB/s, tiled %lf GiB/s\n", kernel_names[k], current, tiled);
+        }
+        free(input);
+        free(output);
+    }
+}
+
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Maps buffers of whole 2 MiB pages. Explicit huge pages need pages reserved in
+// /proc/sys/vm/nr_hugepages, otherwise transparent huge pages are requested for the mapping.
+uint8_t *allocate_huge_buffer(size_t num_bytes, bool *is_hugetlb) {
+    const size_t mapped_bytes = (num_bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    void *buf = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    *is_hugetlb = buf != MAP_FAILED;
+    if (buf == MAP_FAILED) {
+        buf = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        ASSERT(buf != MAP_FAILED);
+        madvise(buf, mapped_bytes, MADV_HUGEPAGE);
+    }
+    return (uint8_t*)buf;
+}
+
+void free_huge_buffer(uint8_t *buf, size_t num_bytes) {
+    const size_t mapped_bytes = (num_bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    munmap(buf, mapped_bytes);
+}
+
+void print_size(size_t num_bytes) {
+    if (num_bytes >= 1024 * 1024 * 1024) {
+        printf("%6zuG", num_bytes / (1024 * 1024 * 1024));
+    } else if (num_bytes >= 1024 * 1024) {
+        printf("%6zuM", num_bytes / (1024 * 1024));
+    } else {
+        printf("%6zuK", num_bytes / 1024);
+    }
+}
+
+// Runs the kernels whose name contains the filter on sizes from 4 KiB to max_bytes, growing by 4x,
+// so the table shows at which cache level each kernel loses its throughput.
+void benchmark_sweep(CacheMode cache_mode, size_t max_bytes, const char *filter) {
+    const size_t min_bytes = 4 * 1024;
+    // Process 256 MiB per measurement, but at least 2 runs.
+    const size_t bytes_per_measurement = 256 * 1024 * 1024;
+    const size_t slack = adaptive_byte_stream_split_encoded_size(max_bytes / 4, 4, kAdaptiveBlockSize) - max_bytes;
+    bool is_hugetlb_input = false;
+    bool is_hugetlb_output = false;
+    uint8_t *input = allocate_huge_buffer(max_bytes + slack, &is_hugetlb_input);
+    uint8_t *output = allocate_huge_buffer(max_bytes + slack, &is_hugetlb_output);
+    srand(1337);
+    for (size_t i = 0; i < max_bytes; ++i) {
+        input[i] = (uint8_t)rand();
+    }
+    memset(output, 0, max_bytes + slack);
+    printf("Sweeping from 4 KiB to %zu KiB with %s caches, buffers on %s.\n", max_bytes / 1024,
+           cache_mode == CacheCold ? "cold" : "warm",
+           is_hugetlb_input && is_hugetlb_output ? "explicit huge pages" : "transparent huge pages");
+    printf("Dispatching to %s kernels, throughput in GiB/s.\n", simd_level_to_string(get_simd_level()));
+    printf("%-28s", "size");
+    for (size_t num_bytes = min_bytes; num_bytes <= max_bytes; num_bytes *= 4) {
+        print_size(num_bytes);
+    }
+    printf("\n");
+    for (size_t i = RnStart; i < RnEnd; ++i) {
+        RunName name = (RunName)i;
+        const char *name_s = CovertRnNameToString(name);
+        if (filter != NULL && strstr(name_s, filter) == NULL) {
+            continue;
+        }
+        if (RequiredSimdLevel(name) > get_simd_level()) {
+            printf("%-28s not supported\n", name_s);
+            continue;
+        }
+        printf("%-28s", name_s);
+        for (size_t num_bytes = min_bytes; num_bytes <= max_bytes; num_bytes *= 4) {
+            const size_t num_runs = std::max<size_t>(2, bytes_per_measurement / num_bytes);
+            printf(" %6.2f", benchmark_path(name, input, num_bytes, output, num_runs, cache_mode));
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+    free_huge_buffer(input, max_bytes + slack);
+    free_huge_buffer(output, max_bytes + slack);
+}
+
+int main(int argc, char **argv) {
+    bool tiling = false;
+    bool generated_only = false;
+    bool sweep = false;
+    CacheMode cache_mode = CacheWarm;
+    size_t sweep_max_MiB = 1024;
+    const char *filter = NULL;
+    bool use_perf_counters = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-tiled") == 0) {
+            tiling = true;
+        } else if (strcmp(argv[i], "-generated") == 0) {
+            generated_only = true;
+        } else if (strcmp(argv[i], "-sweep") == 0) {
+            sweep = true;
+        } else if (strcmp(argv[i], "-cold") == 0) {
+            cache_mode = CacheCold;
+        } else if (strcmp(argv[i], "-max_size") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            sweep_max_MiB = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "-perf") == 0) {
+            use_perf_counters = true;
+        } else {
+            printf("Usage: %s [-tiled] [-generated] [-sweep [-cold] [-max_size MIB] [-filter NAME]] [-perf]\n", argv[0]);
+            printf("  -tiled  Compare the tiled kernels at 1 MiB, 64 MiB and 1 GiB instead of the default benchmarks.\n");
+            printf("  -generated  Benchmark only the kernels generated from the search_space networks.\n");
+            printf("  -sweep  Benchmark the kernels on sizes from 4 KiB to 1 GiB on huge page buffers.\n");
+            printf("  -cold  Flush both buffers from the caches before every run of the sweep.\n");
+            printf("  -max_size  Largest size of the sweep in MiB, default 1024.\n");
+            printf("  -filter  Sweep only the kernels whose name contains NAME.\n");
+            printf("  -perf  Report the hardware counters of every kernel of the default benchmark.\n");
+            return -1;
+        }
+    }
+    PerfCounters counters;
+    if (use_perf_counters) {
+        if (perf_counters_open(&counters)) {
+            perf_counters = &counters;
+        } else {
+            printf("Hardware counters are not available, e.g. in a container or with perf_event_paranoid > 2.\n");
+        }
+    }
     test_all_encodings();
-    benchmark_all_encodings();
+    if (sweep) {
+        benchmark_sweep(cache_mode, sweep_max_MiB * 1024 * 1024, filter);
+    } else if (tiling) {
+        benchmark_tiling();
+    } else if (generated_only) {
+        benchmark_generated_kernels();
+    } else {
+        benchmark_all_encodings();
+        benchmark_generated_kernels();
+        benchmark_scaling();
+    }
+    if (perf_counters != NULL) {
+        perf_counters_close(perf_counters);
+        perf_counters = NULL;
+    }
     return 0;
 }
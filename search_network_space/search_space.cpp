@@ -1,4 +1,6 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <emmintrin.h>
 #include <immintrin.h>
 #include <set>
@@ -8,6 +10,10 @@
 #include <string.h>
 #include <assert.h>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unordered_map>
 
 enum Command {
     cmd_start = 0,
@@ -35,7 +41,36 @@ enum Command {
     avx2_permute64_self,
     avx2_shuffle32_self,
 
-    cmd_end_avx2
+    cmd_end_avx2,
+
+    cmd_start_avx512,
+    avx512_unpack8_next = cmd_start_avx512,
+    avx512_unpack8_skip,
+    avx512_unpack16_next,
+    avx512_unpack16_skip,
+    avx512_unpack32_next,
+    avx512_unpack32_skip,
+    avx512_unpack64_next,
+    avx512_unpack64_skip,
+    avx512_unpack128_next,
+    avx512_unpack128_skip,
+    avx512_unpack256_next,
+    avx512_unpack256_skip,
+    avx512_permute128_self,
+    avx512_permute64_self,
+    avx512_shuffle32_self,
+    cmd_end_avx512,
+
+    // The VBMI byte permutes follow the AVX-512 commands, so that a search can use
+    // either [cmd_start_avx512, cmd_end_avx512) or [cmd_start_avx512, cmd_end_avx512_vbmi).
+    cmd_start_avx512_vbmi = cmd_end_avx512,
+    // Gathers the 16 bytes of each stream of 16 4-byte values.
+    avx512_vbmi_gather4_self = cmd_start_avx512_vbmi,
+    // Inverse of avx512_vbmi_gather4_self.
+    avx512_vbmi_scatter4_self,
+    // Gathers the 8 bytes of each stream of 8 8-byte values. It is its own inverse.
+    avx512_vbmi_gather8_self,
+    cmd_end_avx512_vbmi
 };
 
 template<size_t SIZE, typename VTYPE>
@@ -44,6 +79,20 @@ struct State {
     std::vector<Command> cmds;
 };
 
+// 8 registers of 64 bytes hold more bytes than a uint8_t label can tell apart.
+// The AVX-512 state thus carries a second plane with the upper bits of every label.
+// Both planes go through the same commands and both have to match.
+// Without AVX-512 in -march the compiler aligns __m512i to 32 bytes only, while the
+// AVX-512 functions load the registers with aligned loads.
+template<size_t SIZE>
+struct alignas(64) State<SIZE, __m512i> {
+    __m512i v[SIZE];
+    __m512i v_hi[SIZE];
+    std::vector<Command> cmds;
+};
+
+#define AVX512_VBMI_TARGET __attribute__((target("avx512f,avx512bw,avx512vbmi")))
+
 void do_simd(__m128i a, __m128i b, Command cmd, __m128i &low, __m128i &high) {
     switch(cmd) {
         case unpack8_next:
@@ -105,14 +154,81 @@ void do_avx2(__m256i a, __m256i b, Command cmd, __m256i &low, __m256i &high) {
     }
 }
 
-template<size_t SIZE, typename VTYPE>
-State<SIZE, VTYPE> apply_command(const State<SIZE, VTYPE> &state, Command cmd);
+// Byte j of the result is byte (j % num_groups) * group_size + j / num_groups of the source.
+AVX512_VBMI_TARGET
+__m512i make_permute_indices(size_t group_size, size_t num_groups) {
+    alignas(64) uint8_t indices[64];
+    for (size_t j = 0; j < 64; ++j) {
+        indices[j] = (uint8_t)((j % num_groups) * group_size + j / num_groups);
+    }
+    return _mm512_load_si512(indices);
+}
 
+AVX512_VBMI_TARGET
+void do_avx512(__m512i a, __m512i b, Command cmd, __m512i &low, __m512i &high) {
+    switch(cmd) {
+        case avx512_unpack8_next:
+        case avx512_unpack8_skip:
+            low = _mm512_unpacklo_epi8(a, b);
+            high = _mm512_unpackhi_epi8(a, b);
+            break;
+        case avx512_unpack16_next:
+        case avx512_unpack16_skip:
+            low = _mm512_unpacklo_epi16(a, b);
+            high = _mm512_unpackhi_epi16(a, b);
+            break;
+        case avx512_unpack32_next:
+        case avx512_unpack32_skip:
+            low = _mm512_unpacklo_epi32(a, b);
+            high = _mm512_unpackhi_epi32(a, b);
+            break;
+        case avx512_unpack64_next:
+        case avx512_unpack64_skip:
+            low = _mm512_unpacklo_epi64(a, b);
+            high = _mm512_unpackhi_epi64(a, b);
+            break;
+        case avx512_unpack128_next:
+        case avx512_unpack128_skip:
+            // Interleave the 128-bit lanes: [a0, b0, a1, b1] and [a2, b2, a3, b3].
+            low = _mm512_permutex2var_epi64(a, _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0), b);
+            high = _mm512_permutex2var_epi64(a, _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4), b);
+            break;
+        case avx512_unpack256_next:
+        case avx512_unpack256_skip:
+            low = _mm512_shuffle_i64x2(a, b, 0x44);
+            high = _mm512_shuffle_i64x2(a, b, 0xEE);
+            break;
+        default:
+            assert(!"Unknown");
+            break;
+    }
+}
+
+AVX512_VBMI_TARGET
+__m512i do_avx512_self(__m512i a, Command cmd) {
+    switch(cmd) {
+        case avx512_permute128_self:
+            return _mm512_shuffle_i64x2(a, a, (3 << 6) | (1 << 4) | (2 << 2) | (0 << 0));
+        case avx512_permute64_self:
+            return _mm512_permutex_epi64(a, (3 << 6) | (1 << 4) | (2 << 2) | (0 << 0));
+        case avx512_shuffle32_self:
+            return _mm512_shuffle_epi32(a, (_MM_PERM_ENUM)((3 << 6) | (1 << 4) | (2 << 2) | (0 << 0)));
+        case avx512_vbmi_gather4_self:
+            return _mm512_permutexvar_epi8(make_permute_indices(4, 16), a);
+        case avx512_vbmi_scatter4_self:
+            return _mm512_permutexvar_epi8(make_permute_indices(16, 4), a);
+        case avx512_vbmi_gather8_self:
+            return _mm512_permutexvar_epi8(make_permute_indices(8, 8), a);
+        default:
+            assert(!"Unknown");
+            return a;
+    }
+}
+
+// Computes the registers of new_state from the ones of state. The commands are left alone,
+// so that the search does not copy them for every node.
 template<size_t SIZE>
-State<SIZE, __m128i> apply_command(const State<SIZE, __m128i> &state, Command cmd) {
-    State<SIZE, __m128i> new_state;
-    new_state.cmds = state.cmds;
-    new_state.cmds.push_back(cmd);
+void apply_registers(const State<SIZE, __m128i> &state, Command cmd, State<SIZE, __m128i> &new_state) {
     switch (cmd) {
         case unpack8_next:
         case unpack16_next:
@@ -134,14 +250,10 @@ State<SIZE, __m128i> apply_command(const State<SIZE, __m128i> &state, Command cm
             assert(!"Unknown");
             break;
     }
-    return new_state;
 }
 
 template<size_t SIZE>
-State<SIZE, __m256i> apply_command(const State<SIZE, __m256i> &state, Command cmd) {
-    State<SIZE, __m256i> new_state;
-    new_state.cmds = state.cmds;
-    new_state.cmds.push_back(cmd);
+void apply_registers(const State<SIZE, __m256i> &state, Command cmd, State<SIZE, __m256i> &new_state) {
     switch (cmd) {
         case avx2_unpack8_next:
         case avx2_unpack16_next:
@@ -175,12 +287,119 @@ State<SIZE, __m256i> apply_command(const State<SIZE, __m256i> &state, Command cm
             assert(!"Unknown");
             break;
     }
+}
+
+template<size_t SIZE>
+AVX512_VBMI_TARGET
+void apply_avx512_plane(const __m512i *v, Command cmd, __m512i *new_v) {
+    switch (cmd) {
+        case avx512_unpack8_next:
+        case avx512_unpack16_next:
+        case avx512_unpack32_next:
+        case avx512_unpack64_next:
+        case avx512_unpack128_next:
+        case avx512_unpack256_next:
+            for (size_t i = 0; i < SIZE / 2; i += 1) {
+                do_avx512(v[i * 2], v[i * 2 + 1], cmd, new_v[i * 2], new_v[i * 2 + 1]);
+            }
+            break;
+        case avx512_unpack8_skip:
+        case avx512_unpack16_skip:
+        case avx512_unpack32_skip:
+        case avx512_unpack64_skip:
+        case avx512_unpack128_skip:
+        case avx512_unpack256_skip:
+            for (size_t i = 0; i < SIZE / 2; i += 1) {
+                do_avx512(v[i], v[i + SIZE / 2], cmd, new_v[i * 2], new_v[i * 2 + 1]);
+            }
+            break;
+        default:
+            for (size_t i = 0; i < SIZE; i += 1) {
+                new_v[i] = do_avx512_self(v[i], cmd);
+            }
+            break;
+    }
+}
+
+template<size_t SIZE>
+AVX512_VBMI_TARGET
+void apply_registers(const State<SIZE, __m512i> &state, Command cmd, State<SIZE, __m512i> &new_state) {
+    apply_avx512_plane<SIZE>(state.v, cmd, new_state.v);
+    apply_avx512_plane<SIZE>(state.v_hi, cmd, new_state.v_hi);
+}
+
+template<size_t SIZE, typename VTYPE>
+State<SIZE, VTYPE> apply_command(const State<SIZE, VTYPE> &state, Command cmd) {
+    State<SIZE, VTYPE> new_state;
+    apply_registers(state, cmd, new_state);
+    new_state.cmds = state.cmds;
+    new_state.cmds.push_back(cmd);
     return new_state;
 }
 
+// Cost of one instruction on Ice Lake. The in-lane shuffles of 128-bit and 256-bit registers
+// issue on ports 1 and 5, the lane crossing and 512-bit shuffles only on port 5.
+// port_cost is in half cycles of the shuffle ports, latency in cycles.
+struct CommandCost {
+    unsigned port_cost;
+    unsigned latency;
+};
+
+CommandCost command_cost(Command cmd) {
+    CommandCost cost = {1, 1};
+    switch (cmd) {
+        case avx2_unpack128_next:
+        case avx2_unpack128_skip:
+        case avx2_permute64_self:
+        case avx512_unpack128_next:
+        case avx512_unpack128_skip:
+        case avx512_unpack256_next:
+        case avx512_unpack256_skip:
+        case avx512_permute128_self:
+        case avx512_permute64_self:
+        case avx512_vbmi_gather4_self:
+        case avx512_vbmi_scatter4_self:
+        case avx512_vbmi_gather8_self:
+            cost.port_cost = 2;
+            cost.latency = 3;
+            break;
+        case avx512_unpack8_next:
+        case avx512_unpack8_skip:
+        case avx512_unpack16_next:
+        case avx512_unpack16_skip:
+        case avx512_unpack32_next:
+        case avx512_unpack32_skip:
+        case avx512_unpack64_next:
+        case avx512_unpack64_skip:
+        case avx512_shuffle32_self:
+            cost.port_cost = 2;
+            break;
+        default:
+            break;
+    }
+    return cost;
+}
+
+// A command issues SIZE independent instructions, which add their port cost to the loop and
+// one latency to the dependency chain of a block. The blocks are independent, so the kernels
+// are bound by the throughput of the shuffle ports. The port cost thus decides and the latency
+// only breaks ties.
+template<size_t SIZE>
+unsigned step_cost(Command cmd) {
+    const CommandCost cost = command_cost(cmd);
+    return ((SIZE * cost.port_cost) << 8) + cost.latency;
+}
+
 template<size_t SIZE, typename VTYPE>
 void print_network(const State<SIZE, VTYPE> &state) {
+    unsigned port_cost = 0;
+    unsigned latency = 0;
+    for (size_t i = 0; i < state.cmds.size(); ++i) {
+        port_cost += SIZE * command_cost(state.cmds[i]).port_cost;
+        latency += command_cost(state.cmds[i]).latency;
+    }
     std::cout << "Num cmds: " << state.cmds.size() << std::endl;
+    std::cout << "Shuffle port cycles: " << port_cost / 2.0 << ", latency: " << latency << std::endl;
     for (size_t i = 0; i < state.cmds.size(); ++i) {
         Command cmd = state.cmds[i];
         std::string name;
@@ -245,6 +464,60 @@ void print_network(const State<SIZE, VTYPE> &state) {
             case avx2_shuffle32_self:
                 name = "avx2_shufle32_self";
                 break;
+            case avx512_unpack8_next:
+                name = "avx512_unpack8_next";
+                break;
+            case avx512_unpack8_skip:
+                name = "avx512_unpack8_skip";
+                break;
+            case avx512_unpack16_next:
+                name = "avx512_unpack16_next";
+                break;
+            case avx512_unpack16_skip:
+                name = "avx512_unpack16_skip";
+                break;
+            case avx512_unpack32_next:
+                name = "avx512_unpack32_next";
+                break;
+            case avx512_unpack32_skip:
+                name = "avx512_unpack32_skip";
+                break;
+            case avx512_unpack64_next:
+                name = "avx512_unpack64_next";
+                break;
+            case avx512_unpack64_skip:
+                name = "avx512_unpack64_skip";
+                break;
+            case avx512_unpack128_next:
+                name = "avx512_unpack128_next";
+                break;
+            case avx512_unpack128_skip:
+                name = "avx512_unpack128_skip";
+                break;
+            case avx512_unpack256_next:
+                name = "avx512_unpack256_next";
+                break;
+            case avx512_unpack256_skip:
+                name = "avx512_unpack256_skip";
+                break;
+            case avx512_permute128_self:
+                name = "avx512_permute128_self";
+                break;
+            case avx512_permute64_self:
+                name = "avx512_permute64_self";
+                break;
+            case avx512_shuffle32_self:
+                name = "avx512_shuffle32_self";
+                break;
+            case avx512_vbmi_gather4_self:
+                name = "avx512_vbmi_gather4_self";
+                break;
+            case avx512_vbmi_scatter4_self:
+                name = "avx512_vbmi_scatter4_self";
+                break;
+            case avx512_vbmi_gather8_self:
+                name = "avx512_vbmi_gather8_self";
+                break;
             default:
                 assert(!"Unknown");
         }
@@ -252,26 +525,523 @@ void print_network(const State<SIZE, VTYPE> &state) {
     }
 }
 
+// Writes every optimal network as a kernel with the SplitKernel signature of the
+// byte_stream_split library, together with a table of all kernels for network_comparison.
+// The expressions below mirror do_simd, do_avx2, do_avx512 and do_avx512_self. The generated
+// kernels are checked against the scalar reference, so a mismatch shows up there.
+class KernelEmitter {
+public:
+    template<size_t SIZE, typename VTYPE>
+    void emit(const std::string &name, const State<SIZE, VTYPE> &state, bool is_encode) {
+        const Isa isa = std::is_same<VTYPE, __m128i>::value ? IsaSSE
+                      : std::is_same<VTYPE, __m256i>::value ? IsaAVX2 : IsaAVX512;
+        emit_kernel(name, isa, SIZE, sizeof(VTYPE), state.cmds, is_encode);
+    }
+
+    void write(const char *file_name) const {
+        std::ofstream out(file_name);
+        out << "// Generated by search_space -emit. Do not edit.\n";
+        out << "#ifndef GENERATED_KERNELS_H\n";
+        out << "#define GENERATED_KERNELS_H\n\n";
+        out << "#include <immintrin.h>\n";
+        out << "#include <stdint.h>\n";
+        out << "#include <stddef.h>\n\n";
+        out << "#include \"../byte_stream_split/byte_stream_split.h\"\n\n";
+        out << "// Byte j of the result is byte (j % num_groups) * group_size + j / num_groups of the source.\n";
+        out << "__attribute__((target(\"avx512f,avx512bw,avx512vbmi\")))\n";
+        out << "static inline __m512i generated_permute_indices(size_t group_size, size_t num_groups) {\n";
+        out << "    alignas(64) uint8_t indices[64];\n";
+        out << "    for (size_t j = 0; j < 64; ++j) {\n";
+        out << "        indices[j] = (uint8_t)((j % num_groups) * group_size + j / num_groups);\n";
+        out << "    }\n";
+        out << "    return _mm512_load_si512(indices);\n";
+        out << "}\n\n";
+        out << functions_.str();
+        out << "struct GeneratedKernel {\n";
+        out << "    const char *name;\n";
+        out << "    size_t type_size;\n";
+        out << "    bool is_encode;\n";
+        out << "    SplitKernel kernel;\n";
+        out << "    SimdLevel required_level;\n";
+        out << "    size_t num_commands;\n";
+        out << "};\n\n";
+        out << "static const GeneratedKernel generated_kernels[] = {\n";
+        out << table_.str();
+        out << "};\n\n";
+        out << "#endif // GENERATED_KERNELS_H\n";
+    }
+
+private:
+    enum Isa { IsaSSE, IsaAVX2, IsaAVX512 };
+
+    static bool is_self_command(Command cmd) {
+        switch (cmd) {
+            case avx2_permute64_self:
+            case avx2_shuffle32_self:
+            case avx512_permute128_self:
+            case avx512_permute64_self:
+            case avx512_shuffle32_self:
+            case avx512_vbmi_gather4_self:
+            case avx512_vbmi_scatter4_self:
+            case avx512_vbmi_gather8_self:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static bool is_skip_command(Command cmd) {
+        switch (cmd) {
+            case unpack8_skip:
+            case unpack16_skip:
+            case unpack32_skip:
+            case unpack64_skip:
+            case avx2_unpack8_skip:
+            case avx2_unpack16_skip:
+            case avx2_unpack32_skip:
+            case avx2_unpack64_skip:
+            case avx2_unpack128_skip:
+            case avx512_unpack8_skip:
+            case avx512_unpack16_skip:
+            case avx512_unpack32_skip:
+            case avx512_unpack64_skip:
+            case avx512_unpack128_skip:
+            case avx512_unpack256_skip:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Returns the expression of the low (or high) result of cmd on a and b.
+    static std::string expression(Command cmd, const std::string &a, const std::string &b, bool high) {
+        const std::string lohi = high ? "hi" : "lo";
+        const std::string args = "(" + a + ", " + b + ")";
+        switch (cmd) {
+            case unpack8_next: case unpack8_skip: return "_mm_unpack" + lohi + "_epi8" + args;
+            case unpack16_next: case unpack16_skip: return "_mm_unpack" + lohi + "_epi16" + args;
+            case unpack32_next: case unpack32_skip: return "_mm_unpack" + lohi + "_epi32" + args;
+            case unpack64_next: case unpack64_skip: return "_mm_unpack" + lohi + "_epi64" + args;
+            case avx2_unpack8_next: case avx2_unpack8_skip: return "_mm256_unpack" + lohi + "_epi8" + args;
+            case avx2_unpack16_next: case avx2_unpack16_skip: return "_mm256_unpack" + lohi + "_epi16" + args;
+            case avx2_unpack32_next: case avx2_unpack32_skip: return "_mm256_unpack" + lohi + "_epi32" + args;
+            case avx2_unpack64_next: case avx2_unpack64_skip: return "_mm256_unpack" + lohi + "_epi64" + args;
+            case avx2_unpack128_next:
+            case avx2_unpack128_skip:
+                return "_mm256_permute2x128_si256(" + a + ", " + b + (high ? ", 1 | (3 << 4))" : ", 2 << 4)");
+            case avx2_permute64_self:
+                return "_mm256_permute4x64_epi64(" + a + ", 0xD8)";
+            case avx2_shuffle32_self:
+                return "_mm256_shuffle_epi32(" + a + ", 0xD8)";
+            case avx512_unpack8_next: case avx512_unpack8_skip: return "_mm512_unpack" + lohi + "_epi8" + args;
+            case avx512_unpack16_next: case avx512_unpack16_skip: return "_mm512_unpack" + lohi + "_epi16" + args;
+            case avx512_unpack32_next: case avx512_unpack32_skip: return "_mm512_unpack" + lohi + "_epi32" + args;
+            case avx512_unpack64_next: case avx512_unpack64_skip: return "_mm512_unpack" + lohi + "_epi64" + args;
+            case avx512_unpack128_next:
+            case avx512_unpack128_skip:
+                return "_mm512_permutex2var_epi64(" + a + (high ? ", _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4), "
+                                                                : ", _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0), ") + b + ")";
+            case avx512_unpack256_next:
+            case avx512_unpack256_skip:
+                return "_mm512_shuffle_i64x2(" + a + ", " + b + (high ? ", 0xEE)" : ", 0x44)");
+            case avx512_permute128_self:
+                return "_mm512_shuffle_i64x2(" + a + ", " + a + ", 0xD8)";
+            case avx512_permute64_self:
+                return "_mm512_permutex_epi64(" + a + ", 0xD8)";
+            case avx512_shuffle32_self:
+                return "_mm512_shuffle_epi32(" + a + ", (_MM_PERM_ENUM)0xD8)";
+            case avx512_vbmi_gather4_self:
+                return "_mm512_permutexvar_epi8(gather4, " + a + ")";
+            case avx512_vbmi_scatter4_self:
+                return "_mm512_permutexvar_epi8(scatter4, " + a + ")";
+            case avx512_vbmi_gather8_self:
+                return "_mm512_permutexvar_epi8(gather8, " + a + ")";
+            default:
+                assert(!"Unknown");
+                return "";
+        }
+    }
+
+    static std::string var(size_t stage, size_t i) {
+        return "v" + std::to_string(stage) + "_" + std::to_string(i);
+    }
+
+    void emit_kernel(const std::string &name, Isa isa, size_t size, size_t width, const std::vector<Command> &cmds,
+                     bool is_encode) {
+        const char *vtype = isa == IsaSSE ? "__m128i" : isa == IsaAVX2 ? "__m256i" : "__m512i";
+        std::set<Command> used(cmds.begin(), cmds.end());
+        const bool uses_vbmi = used.count(avx512_vbmi_gather4_self) || used.count(avx512_vbmi_scatter4_self) ||
+                               used.count(avx512_vbmi_gather8_self);
+        const char *level = isa == IsaSSE ? "SimdSSE" : isa == IsaAVX2 ? "SimdAVX2"
+                          : uses_vbmi ? "SimdAVX512" : "SimdAVX512BW";
+        const size_t type_size = size;
+        const std::string block_bytes = std::to_string(size * width);
+        const std::string w = std::to_string(width);
+
+        std::ostringstream &o = functions_;
+        if (isa == IsaAVX2) {
+            o << "__attribute__((target(\"avx2\")))\n";
+        } else if (isa == IsaAVX512) {
+            o << (uses_vbmi ? "__attribute__((target(\"avx512f,avx512bw,avx512vbmi\")))\n"
+                            : "__attribute__((target(\"avx512f,avx512bw\")))\n");
+        }
+        o << "static void " << name << "(const uint8_t *input_data, size_t num_elements, uint8_t *output_data) {\n";
+        // The permute indices are loop invariant.
+        if (used.count(avx512_vbmi_gather4_self)) {
+            o << "    const __m512i gather4 = generated_permute_indices(4, 16);\n";
+        }
+        if (used.count(avx512_vbmi_scatter4_self)) {
+            o << "    const __m512i scatter4 = generated_permute_indices(16, 4);\n";
+        }
+        if (used.count(avx512_vbmi_gather8_self)) {
+            o << "    const __m512i gather8 = generated_permute_indices(8, 8);\n";
+        }
+        o << "    const size_t num_blocks = num_elements / " << w << ";\n";
+        o << "    for (size_t block = 0; block < num_blocks; ++block) {\n";
+        for (size_t i = 0; i < size; ++i) {
+            const std::string address = is_encode
+                ? "input_data + block * " + block_bytes + " + " + std::to_string(i * width)
+                : "input_data + " + std::to_string(i) + " * num_elements + block * " + w;
+            o << "        const " << vtype << " " << var(0, i) << " = " << load(isa, address) << ";\n";
+        }
+        for (size_t c = 0; c < cmds.size(); ++c) {
+            const Command cmd = cmds[c];
+            for (size_t i = 0; i < size; ++i) {
+                std::string e;
+                if (is_self_command(cmd)) {
+                    e = expression(cmd, var(c, i), "", false);
+                } else if (is_skip_command(cmd)) {
+                    e = expression(cmd, var(c, i / 2), var(c, i / 2 + size / 2), i % 2 == 1);
+                } else {
+                    e = expression(cmd, var(c, i & ~(size_t)1), var(c, i | 1), i % 2 == 1);
+                }
+                o << "        const " << vtype << " " << var(c + 1, i) << " = " << e << ";\n";
+            }
+        }
+        for (size_t i = 0; i < size; ++i) {
+            const std::string address = is_encode
+                ? "output_data + " + std::to_string(i) + " * num_elements + block * " + w
+                : "output_data + block * " + block_bytes + " + " + std::to_string(i * width);
+            o << "        " << store(isa, address, var(cmds.size(), i)) << ";\n";
+        }
+        o << "    }\n";
+        o << "    " << (is_encode ? "encode" : "decode") << "_scalar_range<" << type_size
+          << ">(input_data, num_elements, num_blocks * " << w << ", num_elements, output_data);\n";
+        o << "}\n\n";
+
+        table_ << "    {\"" << name << "\", " << type_size << ", " << (is_encode ? "true" : "false") << ", "
+               << name << ", " << level << ", " << cmds.size() << "},\n";
+    }
+
+    static std::string load(Isa isa, const std::string &address) {
+        switch (isa) {
+            case IsaSSE: return "_mm_loadu_si128((const __m128i*)(" + address + "))";
+            case IsaAVX2: return "_mm256_loadu_si256((const __m256i*)(" + address + "))";
+            default: return "_mm512_loadu_si512((const void*)(" + address + "))";
+        }
+    }
+
+    static std::string store(Isa isa, const std::string &address, const std::string &value) {
+        switch (isa) {
+            case IsaSSE: return "_mm_storeu_si128((__m128i*)(" + address + "), " + value + ")";
+            case IsaAVX2: return "_mm256_storeu_si256((__m256i*)(" + address + "), " + value + ")";
+            default: return "_mm512_storeu_si512((void*)(" + address + "), " + value + ")";
+        }
+    }
+
+    std::ostringstream functions_;
+    std::ostringstream table_;
+};
+
+// Set by -emit. Every search then also writes its optimal networks as kernels.
+KernelEmitter *emitter = NULL;
+
+// Prints the networks and hands them to the emitter. prefix names the kernels,
+// e.g. gen_avx2_float_encode gives gen_avx2_float_encode_0, gen_avx2_float_encode_1, ...
+template<size_t SIZE, typename VTYPE>
+void report_networks(const std::vector<State<SIZE, VTYPE>> &best_networks, const std::string &prefix, bool is_encode) {
+    for (size_t i = 0; i < best_networks.size(); ++i) {
+        print_network<SIZE>(best_networks[i]);
+        std::cout << std::endl;
+        if (emitter != NULL) {
+            emitter->emit(prefix + "_" + std::to_string(i), best_networks[i], is_encode);
+        }
+    }
+}
+
 template<size_t SIZE, typename VTYPE>
 bool states_are_equal(const State<SIZE, VTYPE>& a, const State<SIZE, VTYPE>& b) {
     return memcmp(&a.v[0], &b.v[0], SIZE * sizeof(VTYPE)) == 0;
 }
 
+template<size_t SIZE>
+bool states_are_equal(const State<SIZE, __m512i>& a, const State<SIZE, __m512i>& b) {
+    return memcmp(&a.v[0], &b.v[0], SIZE * sizeof(__m512i)) == 0 &&
+           memcmp(&a.v_hi[0], &b.v_hi[0], SIZE * sizeof(__m512i)) == 0;
+}
+
+// Two independent 64-bit hashes of the registers. The search keeps only the fingerprints of the
+// states it visits, a collision of both hashes is not expected.
+struct Fingerprint {
+    uint64_t a;
+    uint64_t b;
+
+    bool operator==(const Fingerprint &other) const {
+        return a == other.a && b == other.b;
+    }
+};
+
+struct FingerprintHash {
+    size_t operator()(const Fingerprint &fingerprint) const {
+        return fingerprint.a;
+    }
+};
+
+void add_to_fingerprint(const void *data, size_t size, Fingerprint &fingerprint) {
+    const uint8_t *raw = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t word;
+        memcpy(&word, raw + i, 8);
+        fingerprint.a = (fingerprint.a ^ word) * 0x9E3779B97F4A7C15ULL;
+        fingerprint.a ^= fingerprint.a >> 29;
+        fingerprint.b = (fingerprint.b + word) * 0xC2B2AE3D27D4EB4FULL;
+        fingerprint.b ^= fingerprint.b >> 31;
+    }
+}
+
 template<size_t SIZE, typename VTYPE>
-void traverse(const State<SIZE, VTYPE> &state, State<SIZE, VTYPE> &expected_state, std::vector<State<SIZE, VTYPE>> &best_networks) {
-    if (state.cmds.size() > expected_state.cmds.size()) {
-        return;
+Fingerprint fingerprint_of(const State<SIZE, VTYPE> &state) {
+    Fingerprint fingerprint = {0, 0};
+    add_to_fingerprint(&state.v[0], SIZE * sizeof(VTYPE), fingerprint);
+    return fingerprint;
+}
+
+template<size_t SIZE>
+Fingerprint fingerprint_of(const State<SIZE, __m512i> &state) {
+    Fingerprint fingerprint = {0, 0};
+    add_to_fingerprint(&state.v[0], SIZE * sizeof(__m512i), fingerprint);
+    add_to_fingerprint(&state.v_hi[0], SIZE * sizeof(__m512i), fingerprint);
+    return fingerprint;
+}
+
+// Number of threads of a search, set by -j.
+size_t num_search_threads = 1;
+
+// Branch and bound search for the cheapest networks with at most max_depth commands.
+//
+// A network costs the sum of the step costs of its commands (see step_cost). Every state is
+// remembered per depth with the cheapest cost it was reached at and the commands leading to it at
+// that cost. A state reached again at the same depth is not searched again, only the command is
+// added, and a state is not searched at all if it was reached at a lower depth for no more cost.
+// The commands are tried from the cheapest, so that the cost of the first network found bounds
+// the rest of the search early.
+//
+// The first commands are distributed over num_search_threads threads. Each thread keeps its
+// own states and only the bound is shared.
+template<size_t SIZE, typename VTYPE>
+class NetworkSearch {
+public:
+    NetworkSearch(const State<SIZE, VTYPE> &initial_state, const State<SIZE, VTYPE> &expected_state,
+                  size_t max_depth, Command start, Command end)
+        : initial_state_(initial_state), max_depth_(max_depth), best_cost_(~0u), next_first_command_(0) {
+        expected_ = fingerprint_of(expected_state);
+        for (int i = start; i < end; ++i) {
+            commands_.push_back((Command)i);
+        }
+        std::stable_sort(commands_.begin(), commands_.end(), [](Command a, Command b) {
+            return step_cost<SIZE>(a) < step_cost<SIZE>(b);
+        });
     }
-    if (states_are_equal(state, expected_state) && state.cmds.size() <= expected_state.cmds.size()) {
-        if (state.cmds.size() == expected_state.cmds.size()) {
-            // NOP
-        } else {
-            expected_state = state;
-            best_networks.clear();
+
+    // Returns the cheapest networks, and of those only the ones with the fewest commands.
+    std::vector<std::vector<Command>> run() {
+        std::vector<Worker> workers(std::max<size_t>(num_search_threads, 1));
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < workers.size(); ++i) {
+            threads.push_back(std::thread(&NetworkSearch::work, this, std::ref(workers[i])));
+        }
+        work(workers[0]);
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+
+        std::vector<std::vector<Command>> networks;
+        std::vector<Command> suffix;
+        for (size_t i = 0; i < workers.size(); ++i) {
+            for (size_t depth = 0; depth < workers[i].visits.size(); ++depth) {
+                auto it = workers[i].visits[depth].find(expected_);
+                if (it != workers[i].visits[depth].end() && it->second.cost == best_cost_) {
+                    collect(workers[i], depth, expected_, suffix, networks);
+                }
+            }
+        }
+        size_t min_length = ~(size_t)0;
+        for (size_t i = 0; i < networks.size(); ++i) {
+            min_length = std::min(min_length, networks[i].size());
+        }
+        networks.erase(std::remove_if(networks.begin(), networks.end(), [min_length](const std::vector<Command> &network) {
+            return network.size() != min_length;
+        }), networks.end());
+        std::sort(networks.begin(), networks.end());
+        networks.erase(std::unique(networks.begin(), networks.end()), networks.end());
+        return networks;
+    }
+
+private:
+    struct Edge {
+        Fingerprint parent;
+        Command cmd;
+    };
+
+    struct Visit {
+        unsigned cost;
+        std::vector<Edge> edges;
+    };
+
+    typedef std::unordered_map<Fingerprint, Visit, FingerprintHash> Visits;
+
+    struct Worker {
+        // The registers at every depth of the current path.
+        std::vector<State<SIZE, VTYPE>> stack;
+        std::vector<Visits> visits;
+    };
+
+    void work(Worker &worker) {
+        worker.stack.resize(max_depth_ + 1);
+        worker.visits.resize(max_depth_ + 1);
+        worker.stack[0] = initial_state_;
+        const Fingerprint initial = fingerprint_of(initial_state_);
+        worker.visits[0][initial].cost = 0;
+        if (initial == expected_) {
+            best_cost_ = 0;
+            return;
+        }
+        if (max_depth_ == 0) {
+            return;
+        }
+        for (;;) {
+            const size_t i = next_first_command_++;
+            if (i >= commands_.size()) {
+                break;
+            }
+            expand(worker, 0, 0, initial, commands_[i]);
+        }
+    }
+
+    // Applies cmd to the state at depth and searches on from the result.
+    void expand(Worker &worker, size_t depth, unsigned cost, const Fingerprint &parent, Command cmd) {
+        const unsigned new_cost = cost + step_cost<SIZE>(cmd);
+        if (new_cost > best_cost_) {
+            return;
+        }
+        State<SIZE, VTYPE> &next = worker.stack[depth + 1];
+        apply_registers(worker.stack[depth], cmd, next);
+        const Fingerprint fingerprint = fingerprint_of(next);
+        const bool is_expected = fingerprint == expected_;
+        if (!is_expected && (depth + 1 == max_depth_ || new_cost + step_cost<SIZE>(commands_[0]) > best_cost_)) {
+            return;
+        }
+        if (!record(worker, depth + 1, fingerprint, new_cost, parent, cmd)) {
+            return;
+        }
+        if (is_expected) {
+            unsigned best = best_cost_;
+            while (new_cost < best && !best_cost_.compare_exchange_weak(best, new_cost)) {
+            }
+            return;
+        }
+        for (size_t i = 0; i < commands_.size(); ++i) {
+            if (new_cost + step_cost<SIZE>(commands_[i]) > best_cost_) {
+                break;
+            }
+            expand(worker, depth + 1, new_cost, fingerprint, commands_[i]);
         }
-        best_networks.push_back(state);
-        return;
     }
+
+    // Returns true if the state has to be searched from.
+    bool record(Worker &worker, size_t depth, const Fingerprint &fingerprint, unsigned cost,
+                const Fingerprint &parent, Command cmd) {
+        for (size_t d = 0; d < depth; ++d) {
+            auto it = worker.visits[d].find(fingerprint);
+            if (it != worker.visits[d].end() && it->second.cost <= cost) {
+                return false;
+            }
+        }
+        auto inserted = worker.visits[depth].emplace(fingerprint, Visit());
+        Visit &visit = inserted.first->second;
+        const Edge edge = {parent, cmd};
+        if (!inserted.second) {
+            if (cost > visit.cost) {
+                return false;
+            }
+            if (cost == visit.cost) {
+                for (size_t i = 0; i < visit.edges.size(); ++i) {
+                    if (visit.edges[i].parent == parent && visit.edges[i].cmd == cmd) {
+                        return false;
+                    }
+                }
+                visit.edges.push_back(edge);
+                return false;
+            }
+            visit.edges.clear();
+        }
+        visit.cost = cost;
+        visit.edges.push_back(edge);
+        return true;
+    }
+
+    // Walks the edges back to the initial state. An edge only counts if it is still on a cheapest
+    // path, the parent may have been reached for less after the edge was added.
+    void collect(const Worker &worker, size_t depth, const Fingerprint &fingerprint, std::vector<Command> &suffix,
+                 std::vector<std::vector<Command>> &networks) {
+        if (depth == 0) {
+            networks.push_back(std::vector<Command>(suffix.rbegin(), suffix.rend()));
+            return;
+        }
+        const Visit &visit = worker.visits[depth].find(fingerprint)->second;
+        for (size_t i = 0; i < visit.edges.size(); ++i) {
+            const Edge &edge = visit.edges[i];
+            auto parent = worker.visits[depth - 1].find(edge.parent);
+            if (parent == worker.visits[depth - 1].end() || parent->second.cost + step_cost<SIZE>(edge.cmd) != visit.cost) {
+                continue;
+            }
+            suffix.push_back(edge.cmd);
+            collect(worker, depth - 1, edge.parent, suffix, networks);
+            suffix.pop_back();
+        }
+    }
+
+    const State<SIZE, VTYPE> &initial_state_;
+    Fingerprint expected_;
+    size_t max_depth_;
+    std::vector<Command> commands_;
+    std::atomic<unsigned> best_cost_;
+    std::atomic<size_t> next_first_command_;
+};
+
+// Searches the commands in [start, end) for the cheapest networks with at most as many commands
+// as expected_state has. The commands of expected_state are then shortened to the networks found.
+template<size_t SIZE, typename VTYPE>
+void traverse(const State<SIZE, VTYPE> &state, State<SIZE, VTYPE> &expected_state, std::vector<State<SIZE, VTYPE>> &best_networks,
+              Command start, Command end) {
+    NetworkSearch<SIZE, VTYPE> search(state, expected_state, expected_state.cmds.size(), start, end);
+    std::vector<std::vector<Command>> networks = search.run();
+    for (size_t i = 0; i < networks.size(); ++i) {
+        State<SIZE, VTYPE> network = state;
+        network.cmds.clear();
+        for (size_t c = 0; c < networks[i].size(); ++c) {
+            network = apply_command(network, networks[i][c]);
+        }
+        assert(states_are_equal(network, expected_state));
+        best_networks.push_back(network);
+    }
+    if (!networks.empty()) {
+        expected_state.cmds.resize(networks[0].size());
+    }
+}
+
+template<size_t SIZE, typename VTYPE>
+void traverse(const State<SIZE, VTYPE> &state, State<SIZE, VTYPE> &expected_state, std::vector<State<SIZE, VTYPE>> &best_networks) {
     Command start, end;
     if (std::is_same<VTYPE, __m128i>::value) {
         start = cmd_start;
@@ -279,16 +1049,93 @@ void traverse(const State<SIZE, VTYPE> &state, State<SIZE, VTYPE> &expected_stat
     } else if (std::is_same<VTYPE, __m256i>::value) {
         start = cmd_start_avx2;
         end = cmd_end_avx2;
+    } else if (std::is_same<VTYPE, __m512i>::value) {
+        start = cmd_start_avx512;
+        end = cmd_end_avx512;
     } else {
         assert(!"Unknown input type");
     }
-    for (int i = start; i < end; ++i) {
-        State<SIZE, VTYPE> new_state = apply_command(state, (Command)i);
-        traverse(new_state, expected_state, best_networks);
+    traverse(state, expected_state, best_networks, start, end);
+}
+
+// Labels byte i of the state with i, using v_hi for the bits that do not fit into v.
+template<size_t SIZE>
+void set_labels(State<SIZE, __m512i> &state, size_t (*label)(size_t)) {
+    uint8_t *raw = (uint8_t*)&state.v[0];
+    uint8_t *raw_hi = (uint8_t*)&state.v_hi[0];
+    for (size_t i = 0; i < SIZE * 64; ++i) {
+        raw[i] = (uint8_t)label(i);
+        raw_hi[i] = (uint8_t)(label(i) >> 8);
+    }
+}
+
+template<size_t SIZE>
+size_t identity_label(size_t i) {
+    return i;
+}
+
+// Output byte i is byte j of element k, where the element k has SIZE bytes.
+template<size_t SIZE>
+size_t split_label(size_t i) {
+    const size_t num_elements = 64;
+    return (i % num_elements) * SIZE + i / num_elements;
+}
+
+template<size_t SIZE>
+void search_avx512(const char *name, const std::string &prefix, size_t max_depth, Command start, Command end) {
+    State<SIZE, __m512i> initial_state;
+    State<SIZE, __m512i> expected_state;
+    set_labels<SIZE>(initial_state, identity_label<SIZE>);
+    set_labels<SIZE>(expected_state, split_label<SIZE>);
+    for (size_t i = 0; i < max_depth; ++i) {
+        expected_state.cmds.push_back(cmd_end_avx512_vbmi);
+    }
+    {
+        std::cout << name << " encode networks" << std::endl;
+        std::vector<State<SIZE, __m512i>> best_networks;
+        traverse(initial_state, expected_state, best_networks, start, end);
+        report_networks<SIZE>(best_networks, prefix + "_encode", true);
+    }
+    {
+        std::cout << name << " decode networks" << std::endl;
+        std::swap(initial_state.v, expected_state.v); // Quick hack.
+        std::swap(initial_state.v_hi, expected_state.v_hi);
+        expected_state.cmds.assign(max_depth, cmd_end_avx512_vbmi);
+        std::vector<State<SIZE, __m512i>> best_networks;
+        traverse(initial_state, expected_state, best_networks, start, end);
+        report_networks<SIZE>(best_networks, prefix + "_decode", false);
     }
 }
 
-int main() {
+void search_avx512_networks() {
+    if (!__builtin_cpu_supports("avx512f") || !__builtin_cpu_supports("avx512bw") ||
+        !__builtin_cpu_supports("avx512vbmi")) {
+        std::cout << "Skipping the AVX-512 searches, the CPU does not support AVX-512 VBMI" << std::endl;
+        return;
+    }
+    // The searches limited to the unpack commands give the kernels for AVX-512 without VBMI.
+    search_avx512<4>("Float AVX-512", "gen_avx512bw_float", 8, cmd_start_avx512, cmd_end_avx512);
+    search_avx512<8>("Double AVX-512", "gen_avx512bw_double", 9, cmd_start_avx512, cmd_end_avx512);
+    search_avx512<4>("Float AVX-512 VBMI", "gen_avx512_float", 4, cmd_start_avx512, cmd_end_avx512_vbmi);
+    search_avx512<8>("Double AVX-512 VBMI", "gen_avx512_double", 5, cmd_start_avx512, cmd_end_avx512_vbmi);
+}
+
+int main(int argc, char **argv) {
+    KernelEmitter kernel_emitter;
+    const char *emit_file = NULL;
+    num_search_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-emit") == 0 && i + 1 < argc) {
+            emit_file = argv[++i];
+            emitter = &kernel_emitter;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            num_search_threads = atoi(argv[++i]);
+        } else {
+            std::cerr << "Run as: search_space [-emit FILE] [-j THREADS]" << std::endl;
+            return -1;
+        }
+    }
+
     {
         // Search for the best networks for float types.
         State<4, __m128i> initial_state;
@@ -311,20 +1158,14 @@ int main() {
             std::cout << "Float encode networks" << std::endl;
             std::vector<State<4, __m128i>> best_networks;
             traverse(initial_state, expected_state, best_networks);
-            for (size_t i = 0; i < best_networks.size(); ++i) {
-                print_network<4>(best_networks[i]);
-                std::cout << std::endl;
-            }
+            report_networks<4>(best_networks, "gen_sse_float_encode", true);
         }
         {
             std::cout << "Float decode  networks" << std::endl;
             std::swap(initial_state.v, expected_state.v); // Quick hack.
             std::vector<State<4, __m128i>> best_networks;
             traverse(initial_state, expected_state, best_networks);
-            for (size_t i = 0; i < best_networks.size(); ++i) {
-                print_network<4>(best_networks[i]);
-                std::cout << std::endl;
-            }
+            report_networks<4>(best_networks, "gen_sse_float_decode", false);
         }
     }
 
@@ -349,20 +1190,14 @@ int main() {
             std::cout << "Double encode networks" << std::endl;
             std::vector<State<8, __m128i>> best_networks;
             traverse(initial_state, expected_state, best_networks);
-            for (size_t i = 0; i < best_networks.size(); ++i) {
-                print_network<8>(best_networks[i]);
-                std::cout << std::endl;
-            }
+            report_networks<8>(best_networks, "gen_sse_double_encode", true);
         }
         {
             std::cout << "Double decode networks" << std::endl;
             std::vector<State<8, __m128i>> best_networks;
             std::swap(initial_state.v, expected_state.v); // Quick hack.
             traverse(initial_state, expected_state, best_networks);
-            for (size_t i = 0; i < best_networks.size(); ++i) {
-                print_network<8>(best_networks[i]);
-                std::cout << std::endl;
-            }
+            report_networks<8>(best_networks, "gen_sse_double_decode", false);
         }
 
     }
@@ -389,20 +1224,14 @@ int main() {
             std::cout << "Float AVX2 encode networks" << std::endl;
             std::vector<State<4, __m256i>> best_networks;
             traverse(initial_state, expected_state, best_networks);
-            for (size_t i = 0; i < best_networks.size(); ++i) {
-                print_network<4>(best_networks[i]);
-                std::cout << std::endl;
-            }
+            report_networks<4>(best_networks, "gen_avx2_float_encode", true);
         }
         {
             std::cout << "Float AVX2 decode networks" << std::endl;
             std::swap(initial_state.v, expected_state.v); // Quick hack.
             std::vector<State<4, __m256i>> best_networks;
             traverse(initial_state, expected_state, best_networks);
-            for (size_t i = 0; i < best_networks.size(); ++i) {
-                print_network<4>(best_networks[i]);
-                std::cout << std::endl;
-            }
+            report_networks<4>(best_networks, "gen_avx2_float_decode", false);
         }
     }
 
@@ -428,21 +1257,20 @@ int main() {
             std::cout << "Double AVX2 encode networks" << std::endl;
             std::vector<State<8, __m256i>> best_networks;
             traverse(initial_state, expected_state, best_networks);
-            for (size_t i = 0; i < best_networks.size(); ++i) {
-                print_network<8>(best_networks[i]);
-                std::cout << std::endl;
-            }
+            report_networks<8>(best_networks, "gen_avx2_double_encode", true);
         }
         {
             std::cout << "Double AVX2 decode networks" << std::endl;
             std::swap(initial_state.v, expected_state.v); // Quick hack.
             std::vector<State<8, __m256i>> best_networks;
             traverse(initial_state, expected_state, best_networks);
-            for (size_t i = 0; i < best_networks.size(); ++i) {
-                print_network<8>(best_networks[i]);
-                std::cout << std::endl;
-            }
+            report_networks<8>(best_networks, "gen_avx2_double_decode", false);
         }
     }
+
+    search_avx512_networks();
+    if (emitter != NULL) {
+        emitter->write(emit_file);
+    }
     return 0;
 }